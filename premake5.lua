@@ -5,6 +5,12 @@ workspace "ModelViewer"
 
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
+newoption
+{
+    trigger = "avx2",
+    description = "Build with AVX2 code generation (8-wide transform kernels; SSE is used otherwise)"
+}
+
 IncludeDir = {}
 IncludeDir["GLM"] = "external/glm"
 IncludeDir["GLFW"] = "external/glfw/include"
@@ -37,6 +43,12 @@ project "ModelViewer"
         "src/**.cpp"
     }
 
+    -- Compiles the GLSL in src/shaders into the SPIR-V headers embedded in the executable.
+    prebuildcommands
+    {
+        "call \"%{wks.location}\\scripts\\CompileShaders.bat\" nopause"
+    }
+
     includedirs
     {
         "src",
@@ -65,6 +77,9 @@ project "ModelViewer"
         defines { "PLATFORM_WINDOWS" }
         linkoptions { "/NODEFAULTLIB:LIBCMTD" }
 
+    filter "options:avx2"
+        vectorextensions "AVX2"
+
     filter "configurations:Debug"
         defines "DEBUG"
         runtime "Debug"
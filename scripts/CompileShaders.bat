@@ -1,9 +1,19 @@
-@echo off
-
-set SHADER_DIR=%~dp0..\src\shaders
-
-echo Compiling shaders...
-"%VULKAN_SDK%\Bin\glslc.exe" %SHADER_DIR%\simple_shader.vert -o %SHADER_DIR%\simple_shader.vert.spv
-"%VULKAN_SDK%\Bin\glslc.exe" %SHADER_DIR%\simple_shader.frag -o %SHADER_DIR%\simple_shader.frag.spv
-echo Finished compiling shaders.
-pause
\ No newline at end of file
+@echo off
+setlocal
+
+set SHADER_DIR=%~dp0..\src\shaders
+set GENERATED_DIR=%SHADER_DIR%\generated
+
+if not exist "%GENERATED_DIR%" mkdir "%GENERATED_DIR%"
+
+echo Compiling shaders...
+for %%s in (simple_shader.vert simple_shader.frag cull.comp cluster_cull.comp) do (
+	rem Embedded into the executable by ModelViewerShaderRegistry.cpp.
+	"%VULKAN_SDK%\Bin\glslc.exe" "%SHADER_DIR%\%%s" -mfmt=num -o "%GENERATED_DIR%\%%s.inc" || exit /b 1
+	rem Loose copy for MODELVIEWER_SHADER_DIR=src\shaders during shader development.
+	"%VULKAN_SDK%\Bin\glslc.exe" "%SHADER_DIR%\%%s" -o "%SHADER_DIR%\%%s.spv" || exit /b 1
+)
+echo Finished compiling shaders.
+
+rem The build runs this as a prebuild step and must not wait for input.
+if /i not "%~1"=="nopause" pause
@@ -0,0 +1,237 @@
+#include "ModelViewerJobSystem.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		// Queue owned by the calling thread, valid while localSystem is the system asking.
+		thread_local const ModelViewerJobSystem* localSystem = nullptr;
+		thread_local uint32_t localQueue = 0;
+	}
+
+	ModelViewerJobSystem* ModelViewerJobSystem::instance = nullptr;
+
+	ModelViewerJobSystem::ModelViewerJobSystem(uint32_t workerCount)
+	{
+		if (instance != nullptr)
+		{
+			throw std::runtime_error("Only one job system may exist at a time!");
+		}
+		instance = this;
+
+		queues.reserve(workerCount + 1);
+		for (uint32_t i = 0; i <= workerCount; i++)
+		{
+			queues.push_back(std::make_unique<WorkerQueue>());
+		}
+
+		localSystem = this;
+		localQueue = workerCount;
+
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back([this, i]() { workerLoop(i); });
+		}
+	}
+
+	ModelViewerJobSystem::~ModelViewerJobSystem()
+	{
+		// Workers only leave once the queues are empty, so every queued job still runs and
+		// its group's count reaches zero.
+		{
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+			stopping = true;
+		}
+		wakeCondition.notify_all();
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		assert(queuedJobs == 0 && queuedBackgroundJobs == 0 && "Jobs queued while the job system shut down!");
+
+		localSystem = nullptr;
+		instance = nullptr;
+	}
+
+	void ModelViewerJobSystem::run(TaskGroup& group, std::function<void()> job)
+	{
+		group.pending.fetch_add(1, std::memory_order_relaxed);
+		push({ std::move(job), &group });
+	}
+
+	void ModelViewerJobSystem::runBackground(TaskGroup& group, std::function<void()> job)
+	{
+		group.pending.fetch_add(1, std::memory_order_relaxed);
+		queuedBackgroundJobs.fetch_add(1, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock{ backgroundMutex };
+			backgroundJobs.push_back({ std::move(job), &group });
+		}
+		{
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+		}
+		wakeCondition.notify_one();
+	}
+
+	void ModelViewerJobSystem::wait(TaskGroup& group)
+	{
+		Job job;
+		while (!group.isDone())
+		{
+			if (tryPop(job))
+			{
+				execute(job);
+			}
+			else
+			{
+				// The remaining jobs are running on other threads.
+				std::this_thread::yield();
+			}
+		}
+
+		// Taking the lock makes sure the thread that finished the last job has let go of the
+		// group, which the caller is free to destroy once this returns.
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> lock{ group.mutex };
+			error = std::exchange(group.error, nullptr);
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	void ModelViewerJobSystem::push(Job job)
+	{
+		// Counted before it becomes visible so queuedJobs never undercounts the queues.
+		queuedJobs.fetch_add(1, std::memory_order_release);
+		const uint32_t queueIndex = localSystem == this ? localQueue : static_cast<uint32_t>(queues.size() - 1);
+		{
+			std::lock_guard<std::mutex> lock{ queues[queueIndex]->mutex };
+			queues[queueIndex]->jobs.push_back(std::move(job));
+		}
+
+		// An empty critical section keeps a worker from missing the wakeup between checking
+		// queuedJobs and going to sleep.
+		{
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+		}
+		wakeCondition.notify_one();
+	}
+
+	bool ModelViewerJobSystem::tryPop(Job& job)
+	{
+		if (queuedJobs.load(std::memory_order_acquire) == 0)
+		{
+			return false;
+		}
+
+		const uint32_t queueCount = static_cast<uint32_t>(queues.size());
+		const uint32_t self = localSystem == this ? localQueue : queueCount - 1;
+
+		// Newest first from our own queue keeps the working set warm ...
+		{
+			WorkerQueue& queue = *queues[self];
+			std::lock_guard<std::mutex> lock{ queue.mutex };
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		// ... while thieves take the oldest, usually largest, jobs of the others.
+		for (uint32_t offset = 1; offset < queueCount; offset++)
+		{
+			WorkerQueue& queue = *queues[(self + offset) % queueCount];
+			std::lock_guard<std::mutex> lock{ queue.mutex };
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool ModelViewerJobSystem::tryPopBackground(Job& job)
+	{
+		if (queuedBackgroundJobs.load(std::memory_order_acquire) == 0)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock{ backgroundMutex };
+		if (backgroundJobs.empty())
+		{
+			return false;
+		}
+		job = std::move(backgroundJobs.front());
+		backgroundJobs.pop_front();
+		queuedBackgroundJobs.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void ModelViewerJobSystem::execute(Job& job)
+	{
+		TaskGroup& group = *job.group;
+		try
+		{
+			job.function();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock{ group.mutex };
+			if (!group.error)
+			{
+				group.error = std::current_exception();
+			}
+		}
+		job.function = nullptr;
+		finish(group);
+	}
+
+	void ModelViewerJobSystem::finish(TaskGroup& group)
+	{
+		std::lock_guard<std::mutex> lock{ group.mutex };
+		group.pending.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	void ModelViewerJobSystem::workerLoop(uint32_t queueIndex)
+	{
+		localSystem = this;
+		localQueue = queueIndex;
+
+		Job job;
+		while (true)
+		{
+			// Short jobs first: they are usually part of something the frame is waiting on.
+			if (tryPop(job) || tryPopBackground(job))
+			{
+				execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ sleepMutex };
+			wakeCondition.wait(lock, [this]()
+			{
+				return stopping || queuedJobs.load(std::memory_order_acquire) != 0 || queuedBackgroundJobs.load(std::memory_order_acquire) != 0;
+			});
+			if (stopping && queuedJobs.load(std::memory_order_acquire) == 0 && queuedBackgroundJobs.load(std::memory_order_acquire) == 0)
+			{
+				return;
+			}
+		}
+	}
+} // namespace ModelViewer
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Work-stealing scheduler shared by every subsystem. Each worker owns a deque: it pushes
+	// and pops its own jobs at the back and steals from the front of the others when it runs
+	// dry. The thread that creates the system is the main thread; it runs jobs while it waits.
+	// Jobs never touch GLFW or the window, which stay with the main thread.
+	//
+	// ModelViewer owns the one instance; code below it reaches it through current().
+	class ModelViewerJobSystem
+	{
+	public:
+		// Counts the outstanding jobs of one batch of work. Waiting on a group runs other jobs
+		// meanwhile, so a job may wait on a group of its own without deadlocking.
+		class TaskGroup
+		{
+		public:
+			TaskGroup() = default;
+
+			TaskGroup(const TaskGroup&) = delete;
+			TaskGroup& operator=(const TaskGroup&) = delete;
+
+			bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+		private:
+			friend class ModelViewerJobSystem;
+
+			std::atomic<uint32_t> pending{ 0 };
+			std::mutex mutex;
+			std::exception_ptr error;
+		};
+
+		// Defaults to one worker per hardware thread besides the calling one, and at least one
+		// so background jobs always make progress.
+		explicit ModelViewerJobSystem(uint32_t workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1);
+		// Runs every job still queued before the workers exit.
+		~ModelViewerJobSystem();
+
+		ModelViewerJobSystem(const ModelViewerJobSystem&) = delete;
+		ModelViewerJobSystem& operator=(const ModelViewerJobSystem&) = delete;
+
+		static ModelViewerJobSystem* current() { return instance; }
+
+		// Workers plus the main thread.
+		uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+		void run(TaskGroup& group, std::function<void()> job);
+		// Queues a long-running job, such as loading a file, in first-in first-out order.
+		// Only idle workers pick these up: never the main thread and never a thread that is
+		// waiting on a group, so a frame can not get stuck behind one.
+		void runBackground(TaskGroup& group, std::function<void()> job);
+		// Returns once group is empty, running queued jobs in the meantime. Rethrows the
+		// first exception thrown by any of the group's jobs.
+		void wait(TaskGroup& group);
+
+		// Runs func(i) for every i in [0, count) and returns when all calls have finished.
+		template<typename Func>
+		void parallelFor(size_t count, Func&& func);
+
+	private:
+		struct Job
+		{
+			std::function<void()> function;
+			TaskGroup* group;
+		};
+
+		struct WorkerQueue
+		{
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void push(Job job);
+		bool tryPop(Job& job);
+		bool tryPopBackground(Job& job);
+		void execute(Job& job);
+		void finish(TaskGroup& group);
+		void workerLoop(uint32_t queueIndex);
+
+		static ModelViewerJobSystem* instance;
+
+		// One queue per worker; the last one belongs to the main thread and to any thread
+		// outside the system that submits work.
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		std::vector<std::thread> workers;
+
+		std::mutex backgroundMutex;
+		std::deque<Job> backgroundJobs;
+
+		// Jobs in the worker queues plus background jobs; workers sleep while it is zero.
+		std::atomic<uint32_t> queuedJobs{ 0 };
+		std::atomic<uint32_t> queuedBackgroundJobs{ 0 };
+		std::atomic<bool> stopping{ false };
+		std::mutex sleepMutex;
+		std::condition_variable wakeCondition;
+	};
+
+	template<typename Func>
+	void ModelViewerJobSystem::parallelFor(size_t count, Func&& func)
+	{
+		// A few batches per thread leave room for stealing to even out uneven work.
+		const size_t batchCount = std::min<size_t>(count, static_cast<size_t>(getThreadCount()) * 4);
+		if (batchCount <= 1)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		TaskGroup group;
+		for (size_t batch = 0; batch < batchCount; batch++)
+		{
+			run(group, [&func, batch, batchCount, count]()
+			{
+				const size_t end = count * (batch + 1) / batchCount;
+				for (size_t i = count * batch / batchCount; i < end; i++)
+				{
+					func(i);
+				}
+			});
+		}
+		wait(group);
+	}
+
+	// Threads a parallelFor spreads across; 1 when no job system is running.
+	inline uint32_t jobThreadCount()
+	{
+		ModelViewerJobSystem* jobSystem = ModelViewerJobSystem::current();
+		return jobSystem ? jobSystem->getThreadCount() : 1;
+	}
+
+	// parallelFor on the current job system, or a plain loop when there is none.
+	template<typename Func>
+	void parallelFor(size_t count, Func&& func)
+	{
+		if (ModelViewerJobSystem* jobSystem = ModelViewerJobSystem::current())
+		{
+			jobSystem->parallelFor(count, std::forward<Func>(func));
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			func(i);
+		}
+	}
+} // namespace ModelViewer
@@ -0,0 +1,136 @@
+#include "ModelViewerMappedFile.h"
+
+#ifdef PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+
+namespace ModelViewer
+{
+	ModelViewerMappedFile::ModelViewerMappedFile(const std::string& filepath) : filepath{ filepath }
+	{
+		map();
+	}
+
+	ModelViewerMappedFile::~ModelViewerMappedFile()
+	{
+		unmap();
+	}
+
+#ifdef PLATFORM_WINDOWS
+	void ModelViewerMappedFile::map()
+	{
+		HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+		fileHandle = file;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize))
+		{
+			unmap();
+			throw std::runtime_error("Failed to query file size: " + filepath);
+		}
+
+		size_ = static_cast<size_t>(fileSize.QuadPart);
+		if (size_ == 0)
+		{
+			return;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			unmap();
+			throw std::runtime_error("Failed to create file mapping: " + filepath);
+		}
+		mappingHandle = mapping;
+
+		data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (data_ == nullptr)
+		{
+			unmap();
+			throw std::runtime_error("Failed to map file: " + filepath);
+		}
+	}
+
+	void ModelViewerMappedFile::unmap()
+	{
+		if (data_ != nullptr)
+		{
+			UnmapViewOfFile(data_);
+			data_ = nullptr;
+		}
+
+		if (mappingHandle != nullptr)
+		{
+			CloseHandle(mappingHandle);
+			mappingHandle = nullptr;
+		}
+
+		if (fileHandle != nullptr)
+		{
+			CloseHandle(fileHandle);
+			fileHandle = nullptr;
+		}
+	}
+#else
+	void ModelViewerMappedFile::map()
+	{
+		fileDescriptor = open(filepath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+
+		struct stat fileStat{};
+		if (fstat(fileDescriptor, &fileStat) != 0)
+		{
+			unmap();
+			throw std::runtime_error("Failed to query file size: " + filepath);
+		}
+
+		size_ = static_cast<size_t>(fileStat.st_size);
+		if (size_ == 0)
+		{
+			return;
+		}
+
+		void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (mapped == MAP_FAILED)
+		{
+			unmap();
+			throw std::runtime_error("Failed to map file: " + filepath);
+		}
+
+		madvise(mapped, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(mapped);
+	}
+
+	void ModelViewerMappedFile::unmap()
+	{
+		if (data_ != nullptr)
+		{
+			munmap(const_cast<char*>(data_), size_);
+			data_ = nullptr;
+		}
+
+		if (fileDescriptor >= 0)
+		{
+			close(fileDescriptor);
+			fileDescriptor = -1;
+		}
+	}
+#endif
+} // namespace ModelViewer
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ModelViewer
+{
+	// Read-only memory mapping of a whole file. The mapping stays valid for the lifetime
+	// of the object; an empty file maps to a null data pointer with size 0.
+	class ModelViewerMappedFile
+	{
+	public:
+		ModelViewerMappedFile(const std::string& filepath);
+		~ModelViewerMappedFile();
+
+		ModelViewerMappedFile(const ModelViewerMappedFile&) = delete;
+		ModelViewerMappedFile& operator=(const ModelViewerMappedFile&) = delete;
+
+		const char* data() const { return data_; }
+		size_t size() const { return size_; }
+		const std::string& path() const { return filepath; }
+
+	private:
+		void map();
+		void unmap();
+
+		std::string filepath;
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+
+#ifdef PLATFORM_WINDOWS
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+	};
+} // namespace ModelViewer
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace ModelViewer
+{
+	// Bounded lock-free multi-producer multi-consumer queue (Vyukov). Every cell carries a
+	// sequence number that tells producers and consumers whether it is theirs to use, so
+	// the only contended operation is one compare-exchange on the head or tail position.
+	template<typename T>
+	class ModelViewerMpmcQueue
+	{
+	public:
+		// Capacity is rounded up to a power of two.
+		explicit ModelViewerMpmcQueue(size_t capacity) :
+			mask{ std::bit_ceil(std::max<size_t>(capacity, 2)) - 1 },
+			cells{ std::make_unique<Cell[]>(mask + 1) }
+		{
+			for (size_t i = 0; i <= mask; i++)
+			{
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		ModelViewerMpmcQueue(const ModelViewerMpmcQueue&) = delete;
+		ModelViewerMpmcQueue& operator=(const ModelViewerMpmcQueue&) = delete;
+
+		// Returns false without touching value when the queue is full.
+		bool tryPush(T&& value)
+		{
+			size_t position = enqueuePosition.load(std::memory_order_relaxed);
+			Cell* cell;
+			while (true)
+			{
+				cell = &cells[position & mask];
+				const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+				if (difference == 0)
+				{
+					if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false;
+				}
+				else
+				{
+					position = enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+
+			cell->value = std::move(value);
+			cell->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Returns false when the queue is empty.
+		bool tryPop(T& value)
+		{
+			size_t position = dequeuePosition.load(std::memory_order_relaxed);
+			Cell* cell;
+			while (true)
+			{
+				cell = &cells[position & mask];
+				const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+				if (difference == 0)
+				{
+					if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false;
+				}
+				else
+				{
+					position = dequeuePosition.load(std::memory_order_relaxed);
+				}
+			}
+
+			value = std::move(cell->value);
+			cell->value = T{};
+			cell->sequence.store(position + mask + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			T value{};
+		};
+
+		// Producers and consumers hammer different positions; keep them off one cache line.
+		static constexpr size_t kCacheLine = 64;
+
+		const size_t mask;
+		std::unique_ptr<Cell[]> cells;
+		alignas(kCacheLine) std::atomic<size_t> enqueuePosition{ 0 };
+		alignas(kCacheLine) std::atomic<size_t> dequeuePosition{ 0 };
+	};
+} // namespace ModelViewer
@@ -0,0 +1,36 @@
+#include "ModelViewerSystemMemory.h"
+
+#ifdef PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ModelViewer
+{
+#ifdef PLATFORM_WINDOWS
+	uint64_t availableSystemMemory()
+	{
+		MEMORYSTATUSEX status{};
+		status.dwLength = sizeof(status);
+		if (!GlobalMemoryStatusEx(&status))
+		{
+			return 0;
+		}
+		return status.ullAvailPhys;
+	}
+#else
+	uint64_t availableSystemMemory()
+	{
+		const long pages = sysconf(_SC_AVPHYS_PAGES);
+		const long pageSize = sysconf(_SC_PAGESIZE);
+		if (pages < 0 || pageSize < 0)
+		{
+			return 0;
+		}
+		return static_cast<uint64_t>(pages) * static_cast<uint64_t>(pageSize);
+	}
+#endif
+} // namespace ModelViewer
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ModelViewer
+{
+	// Physical memory currently available to the process without paging, in bytes; 0 when
+	// the platform cannot tell.
+	uint64_t availableSystemMemory();
+} // namespace ModelViewer
@@ -1,10 +1,12 @@
 #include "ModelViewerKeyboardController.h"
 
+#include <glm/gtc/constants.hpp>
+
 #include <limits>
 
 namespace ModelViewer
 {
-	void ModelViewerKeyboardController::moveInPlaneXZ(GLFWwindow* window, float dt, ModelViewerObject& modelObject)
+	void ModelViewerKeyboardController::moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform)
 	{
 		glm::vec3 rotate{ 0 };
 
@@ -30,13 +32,13 @@ namespace ModelViewer
 
 		if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon())
 		{
-			modelObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+			transform.rotation += lookSpeed * dt * glm::normalize(rotate);
 		}
 
-		modelObject.transform.rotation.x = glm::clamp(modelObject.transform.rotation.x, -1.5f, 1.5f);
-		modelObject.transform.rotation.y = glm::mod(modelObject.transform.rotation.y, glm::two_pi<float>());
+		transform.rotation.x = glm::clamp(transform.rotation.x, -1.5f, 1.5f);
+		transform.rotation.y = glm::mod(transform.rotation.y, glm::two_pi<float>());
 
-		float yaw = modelObject.transform.rotation.y;
+		float yaw = transform.rotation.y;
 		const glm::vec3 forwardDir{ sin(yaw), 0.0f, cos(yaw) };
 		const glm::vec3 rightDir{ forwardDir.z, 0.0f, -forwardDir.x };
 		const glm::vec3 upDir{ 0.0f, -1.0f, 0.0f };
@@ -75,7 +77,7 @@ namespace ModelViewer
 
 		if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon())
 		{
-			modelObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+			transform.translation += moveSpeed * dt * glm::normalize(moveDir);
 		}
 	}
 
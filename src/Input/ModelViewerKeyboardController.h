@@ -1,6 +1,6 @@
 #pragma once
 
-#include "ModelViewerObject.h"
+#include "Scene/ModelViewerTransformSystem.h"
 #include "ModelViewerWindow.h"
 
 namespace ModelViewer
@@ -22,7 +22,7 @@ namespace ModelViewer
 			int lookDown = GLFW_KEY_DOWN;
 		};
 
-		void moveInPlaneXZ(GLFWwindow* window, float dt, ModelViewerObject& modelObject);
+		void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform);
 
 		KeyMappings keys{};
 		float moveSpeed{ 3.0f };
@@ -0,0 +1,400 @@
+#include "ModelViewerMeshCache.h"
+#include "ModelViewerMeshletBuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr uint64_t kSectionAlignment = 16;
+
+		constexpr uint64_t kHashPrime1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t kHashPrime2 = 0xC2B2AE3D27D4EB4Full;
+
+		// The source stamp hashes this many evenly spaced blocks, the first and last included,
+		// so validating a cache costs the same for any source size.
+		constexpr size_t kHashSampleCount = 16;
+		constexpr size_t kHashSampleSize = 64 * 1024;
+
+		using Vertex = ModelViewerModel::Vertex;
+		using PackedVertex = ModelViewerModel::PackedVertex;
+
+		constexpr ModelViewerMeshCache::VertexAttribute kVertexLayout[] = {
+			{ VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) },
+			{ VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) },
+			{ VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) },
+			{ VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) },
+		};
+		constexpr uint32_t kVertexAttributeCount = static_cast<uint32_t>(std::size(kVertexLayout));
+
+		uint64_t alignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+		uint64_t rotateLeft(uint64_t value, int bits)
+		{
+			return (value << bits) | (value >> (64 - bits));
+		}
+
+		// Four independent multiply-rotate lanes over 8 byte words, folded together at the
+		// end. Not cryptographic; it only needs to notice edited source files, and it runs
+		// far faster than the OBJ parse it saves.
+		uint64_t hashBytes(const char* data, size_t size)
+		{
+			uint64_t lanes[4] = { kHashPrime1, kHashPrime2, ~kHashPrime1, ~kHashPrime2 };
+
+			size_t offset = 0;
+			for (; offset + 32 <= size; offset += 32)
+			{
+				for (int lane = 0; lane < 4; lane++)
+				{
+					uint64_t word;
+					std::memcpy(&word, data + offset + lane * 8, sizeof(word));
+					lanes[lane] = rotateLeft(lanes[lane] + word * kHashPrime2, 31) * kHashPrime1;
+				}
+			}
+
+			uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+			for (; offset < size; offset++)
+			{
+				hash = (hash ^ static_cast<unsigned char>(data[offset])) * kHashPrime1;
+			}
+
+			hash ^= static_cast<uint64_t>(size);
+			hash ^= hash >> 33;
+			hash *= kHashPrime2;
+			hash ^= hash >> 29;
+			return hash;
+		}
+
+		uint64_t hashSamples(const char* data, size_t size)
+		{
+			if (size <= kHashSampleCount * kHashSampleSize)
+			{
+				return hashBytes(data, size);
+			}
+
+			uint64_t hash = static_cast<uint64_t>(size);
+			const size_t stride = (size - kHashSampleSize) / (kHashSampleCount - 1);
+			for (size_t sample = 0; sample < kHashSampleCount; sample++)
+			{
+				const size_t offset = sample == kHashSampleCount - 1 ? size - kHashSampleSize : sample * stride;
+				hash = rotateLeft(hash, 23) ^ hashBytes(data + offset, kHashSampleSize);
+			}
+			return hash;
+		}
+
+		int64_t modifiedTime(const std::string& filepath)
+		{
+			return static_cast<int64_t>(std::filesystem::last_write_time(filepath).time_since_epoch().count());
+		}
+	}
+
+	ModelViewerMeshCache::ModelViewerMeshCache(const std::string& cachePath) : file{ cachePath }
+	{
+	}
+
+	std::string ModelViewerMeshCache::cachePathFor(const std::string& sourcePath)
+	{
+		return std::filesystem::path{ sourcePath }.replace_extension(".mvmesh").string();
+	}
+
+	ModelViewerMeshCache::SourceStamp ModelViewerMeshCache::stampSource(const std::string& sourcePath)
+	{
+		ModelViewerMappedFile source{ sourcePath };
+
+		SourceStamp stamp{};
+		stamp.size = source.size();
+		stamp.modifiedTime = modifiedTime(sourcePath);
+		stamp.hash = hashSamples(source.data(), source.size());
+		return stamp;
+	}
+
+	std::unique_ptr<ModelViewerMeshCache> ModelViewerMeshCache::open(const std::string& sourcePath, uint32_t requiredFlags)
+	{
+		const std::string cachePath = cachePathFor(sourcePath);
+
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(cachePath, error))
+		{
+			return nullptr;
+		}
+
+		try
+		{
+			std::unique_ptr<ModelViewerMeshCache> cache{ new ModelViewerMeshCache(cachePath) };
+			if (!cache->validate(sourcePath, requiredFlags))
+			{
+				return nullptr;
+			}
+			return cache;
+		}
+		catch (const std::exception&)
+		{
+			return nullptr;
+		}
+	}
+
+	bool ModelViewerMeshCache::validate(const std::string& sourcePath, uint32_t requiredFlags)
+	{
+		if (file.size() < sizeof(Header))
+		{
+			return false;
+		}
+
+		header_ = reinterpret_cast<const Header*>(file.data());
+		if (header_->magic != kMagic || header_->version != kVersion || (header_->flags & requiredFlags) != requiredFlags)
+		{
+			return false;
+		}
+
+		// Size and mtime are checked before mapping the source for the sampled hash, which
+		// still runs so that most edits preserving both (copies, restored timestamps) are caught.
+		if (header_->source.size != std::filesystem::file_size(sourcePath) || header_->source.modifiedTime != modifiedTime(sourcePath)
+			|| header_->source != stampSource(sourcePath))
+		{
+			return false;
+		}
+
+		if (header_->vertexStride != sizeof(PackedVertex) || header_->attributeCount != kVertexAttributeCount
+			|| std::memcmp(header_->attributes, kVertexLayout, sizeof(kVertexLayout)) != 0)
+		{
+			return false;
+		}
+
+		const uint64_t sectionTableEnd = sizeof(Header) + static_cast<uint64_t>(header_->sectionCount) * sizeof(Section);
+		if (sectionTableEnd > file.size())
+		{
+			return false;
+		}
+
+		const Section* sections = reinterpret_cast<const Section*>(file.data() + sizeof(Header));
+		bool hasVertices = false;
+		bool hasIndices = false;
+		for (uint32_t i = 0; i < header_->sectionCount; i++)
+		{
+			const Section& section = sections[i];
+			if (section.offset % kSectionAlignment != 0 || section.offset > file.size() || section.size > file.size() - section.offset)
+			{
+				return false;
+			}
+
+			const char* payload = file.data() + section.offset;
+			switch (section.type)
+			{
+			case SectionType::Vertices:
+				if (section.size != header_->vertexCount * sizeof(PackedVertex))
+				{
+					return false;
+				}
+				vertices_ = { reinterpret_cast<const PackedVertex*>(payload), static_cast<size_t>(header_->vertexCount) };
+				hasVertices = true;
+				break;
+			case SectionType::Indices:
+				if (section.size != header_->indexCount * sizeof(uint32_t))
+				{
+					return false;
+				}
+				indices_ = { reinterpret_cast<const uint32_t*>(payload), static_cast<size_t>(header_->indexCount) };
+				hasIndices = true;
+				break;
+			case SectionType::OptimizerStats:
+				if (section.size != sizeof(ModelViewerMeshOptimizer::Stats))
+				{
+					return false;
+				}
+				optimizerStats_ = reinterpret_cast<const ModelViewerMeshOptimizer::Stats*>(payload);
+				break;
+			case SectionType::Meshlets:
+			{
+				if (section.size % sizeof(ModelViewerModel::Meshlet) != 0)
+				{
+					return false;
+				}
+				meshlets_ = { reinterpret_cast<const ModelViewerModel::Meshlet*>(payload), static_cast<size_t>(section.size / sizeof(ModelViewerModel::Meshlet)) };
+				const bool inRange = std::all_of(meshlets_.begin(), meshlets_.end(), [this](const ModelViewerModel::Meshlet& meshlet)
+					{
+						return meshlet.firstIndex <= header_->indexCount && meshlet.indexCount <= header_->indexCount - meshlet.firstIndex;
+					});
+				if (!inRange)
+				{
+					return false;
+				}
+				break;
+			}
+			case SectionType::Lods:
+			{
+				if (section.size % sizeof(ModelViewerModel::Lod) != 0 || section.size / sizeof(ModelViewerModel::Lod) > ModelViewerModel::kMaxLods)
+				{
+					return false;
+				}
+				lods_ = { reinterpret_cast<const ModelViewerModel::Lod*>(payload), static_cast<size_t>(section.size / sizeof(ModelViewerModel::Lod)) };
+				const bool inRange = std::all_of(lods_.begin(), lods_.end(), [this](const ModelViewerModel::Lod& lod)
+					{
+						return lod.firstIndex <= header_->indexCount && lod.indexCount <= header_->indexCount - lod.firstIndex;
+					});
+				if (!inRange)
+				{
+					return false;
+				}
+				break;
+			}
+			case SectionType::PageTable:
+				if (section.size % sizeof(ModelViewerModel::ClusterPage) != 0)
+				{
+					return false;
+				}
+				pages_ = { reinterpret_cast<const ModelViewerModel::ClusterPage*>(payload), static_cast<size_t>(section.size / sizeof(ModelViewerModel::ClusterPage)) };
+				break;
+			case SectionType::PageData:
+				pageData_ = { reinterpret_cast<const uint8_t*>(payload), static_cast<size_t>(section.size) };
+				break;
+			default:
+				// Unknown sections are skipped so that optional data can be added without a
+				// version bump.
+				break;
+			}
+		}
+
+		// Pages are checked once both page sections and the meshlets are known, since the
+		// section order is not fixed. Renderers find a meshlet's page by division, and the
+		// residency pool assumes every page fits one of its slots.
+		constexpr uint32_t kPageMeshlets = ModelViewerMeshletBuilder::kPageMeshlets;
+		if (!pages_.empty() && pages_.size() != (meshlets_.size() + kPageMeshlets - 1) / kPageMeshlets)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < pages_.size(); i++)
+		{
+			const ModelViewerModel::ClusterPage& page = pages_[i];
+			const uint64_t size = sizeof(ModelViewerModel::PackedVertex) * static_cast<uint64_t>(page.vertexCount) + sizeof(uint16_t) * static_cast<uint64_t>(page.indexCount);
+			if (page.firstMeshlet != i * kPageMeshlets || page.meshletCount > kPageMeshlets
+				|| page.vertexCount > ModelViewerMeshletBuilder::kPageVertices || page.indexCount > ModelViewerMeshletBuilder::kPageIndices
+				|| page.offset > pageData_.size() || size > pageData_.size() - page.offset)
+			{
+				return false;
+			}
+		}
+
+		return hasVertices && hasIndices && ((header_->flags & Optimized) == 0 || optimizerStats_ != nullptr);
+	}
+
+	void ModelViewerMeshCache::write(const std::string& sourcePath, const ModelViewerModel::Builder& builder,
+		const ModelViewerMeshOptimizer::Stats* optimizerStats, uint32_t passFlags)
+	{
+		const std::string cachePath = cachePathFor(sourcePath);
+		const std::string tempPath = cachePath + ".tmp";
+
+		Header header{};
+		header.magic = kMagic;
+		header.version = kVersion;
+		header.source = stampSource(sourcePath);
+		header.vertexStride = sizeof(PackedVertex);
+		header.attributeCount = kVertexAttributeCount;
+		std::memcpy(header.attributes, kVertexLayout, sizeof(kVertexLayout));
+		header.vertexCount = builder.vertices.size();
+		header.indexCount = builder.indices.size();
+		header.flags = (optimizerStats ? Optimized : 0) | (passFlags & (Stripified | Clustered | Simplified | Paged))
+			| (builder.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP ? TriangleStrips : 0);
+
+		glm::vec3 boundsMin{ builder.vertices.empty() ? 0.0f : std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ builder.vertices.empty() ? 0.0f : std::numeric_limits<float>::lowest() };
+		for (const Vertex& vertex : builder.vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		for (const Vertex& vertex : builder.vertices)
+		{
+			header.boundingRadius = std::max(header.boundingRadius, glm::length(vertex.position - center));
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			header.boundsMin[axis] = boundsMin[axis];
+			header.boundsMax[axis] = boundsMax[axis];
+		}
+
+		// Packed with the same origin and scale as buildPages, so the model can share one
+		// dequantization between the cached vertices and the streamed pages.
+		std::vector<PackedVertex> packedVertices(builder.vertices.size());
+		ModelViewerModel::packVertices(builder.vertices, boundsMin, ModelViewerModel::quantizationScaleFor(boundsMin, boundsMax), packedVertices);
+
+		struct Payload
+		{
+			SectionType type;
+			const void* data;
+			uint64_t size;
+		};
+		std::vector<Payload> payloads{
+			{ SectionType::Vertices, packedVertices.data(), packedVertices.size() * sizeof(PackedVertex) },
+			{ SectionType::Indices, builder.indices.data(), builder.indices.size() * sizeof(uint32_t) },
+		};
+		if (optimizerStats)
+		{
+			payloads.push_back({ SectionType::OptimizerStats, optimizerStats, sizeof(ModelViewerMeshOptimizer::Stats) });
+		}
+		if (!builder.meshlets.empty())
+		{
+			payloads.push_back({ SectionType::Meshlets, builder.meshlets.data(), builder.meshlets.size() * sizeof(ModelViewerModel::Meshlet) });
+		}
+		if (builder.lods.size() > 1)
+		{
+			payloads.push_back({ SectionType::Lods, builder.lods.data(), builder.lods.size() * sizeof(ModelViewerModel::Lod) });
+		}
+		if (!builder.pages.empty())
+		{
+			payloads.push_back({ SectionType::PageTable, builder.pages.data(), builder.pages.size() * sizeof(ModelViewerModel::ClusterPage) });
+			payloads.push_back({ SectionType::PageData, builder.pageData.data(), builder.pageData.size() });
+		}
+		header.sectionCount = static_cast<uint32_t>(payloads.size());
+
+		std::vector<Section> sections(payloads.size());
+		const uint64_t sectionTableSize = sizeof(Section) * sections.size();
+		uint64_t offset = sizeof(Header) + sectionTableSize;
+		for (size_t i = 0; i < payloads.size(); i++)
+		{
+			sections[i].type = payloads[i].type;
+			sections[i].offset = alignUp(offset, kSectionAlignment);
+			sections[i].size = payloads[i].size;
+			offset = sections[i].offset + sections[i].size;
+		}
+
+		{
+			std::ofstream out{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!out.is_open())
+			{
+				throw std::runtime_error("Failed to open mesh cache for writing: " + tempPath);
+			}
+
+			const char padding[kSectionAlignment]{};
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(sections.data()), static_cast<std::streamsize>(sectionTableSize));
+			uint64_t written = sizeof(Header) + sectionTableSize;
+			for (size_t i = 0; i < payloads.size(); i++)
+			{
+				out.write(padding, static_cast<std::streamsize>(sections[i].offset - written));
+				out.write(static_cast<const char*>(payloads[i].data), static_cast<std::streamsize>(sections[i].size));
+				written = sections[i].offset + sections[i].size;
+			}
+
+			if (!out.good())
+			{
+				out.close();
+				std::filesystem::remove(tempPath);
+				throw std::runtime_error("Failed to write mesh cache: " + tempPath);
+			}
+		}
+
+		// Publish with a rename so a concurrently starting viewer never maps a half written cache.
+		std::filesystem::rename(tempPath, cachePath);
+	}
+} // namespace ModelViewer
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ModelViewerModel.h"
+#include "ModelViewerMeshOptimizer.h"
+#include "Core/ModelViewerMappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace ModelViewer
+{
+	// Binary .mvmesh cache written next to an imported source file. The file is a fixed
+	// header, a section table and 16 byte aligned section payloads, so an opened cache is
+	// only a memory mapping and the vertex/index spans point straight into it. Vertices are
+	// stored as ModelViewerModel::PackedVertex, quantized against the header's bounds, so
+	// they are uploaded without being touched on the CPU. A cache is
+	// rejected when the source size, mtime or sampled content hash, the format version or the
+	// vertex layout no longer match. Meshes run through ModelViewerMeshOptimizer are cached
+	// in their optimized order together with the optimizer's statistics, and split or
+	// simplified meshes together with their meshlets and LOD ranges. Meshes imported for
+	// streaming also carry their meshlets packed into pages, which are read straight from
+	// the mapping while the model is drawn.
+	class ModelViewerMeshCache
+	{
+	public:
+		static constexpr uint32_t kMagic = 0x48534D4D; // "MMSH"
+		static constexpr uint32_t kVersion = 4;
+
+		enum Flags : uint32_t
+		{
+			Optimized = 1 << 0,
+			// Strip conversion was tried; TriangleStrips says whether it was kept.
+			Stripified = 1 << 1,
+			TriangleStrips = 1 << 2,
+			// Meshlet building was tried; the Meshlets section is absent for small meshes.
+			Clustered = 1 << 3,
+			// LOD generation was tried; the Lods section is absent when it found none.
+			Simplified = 1 << 4,
+			// Streaming pages were built; the page sections are absent without meshlets.
+			Paged = 1 << 5,
+		};
+
+		enum class SectionType : uint32_t
+		{
+			Vertices = 1,
+			Indices = 2,
+			// ModelViewerMeshOptimizer::Stats, present when the Optimized flag is set.
+			OptimizerStats = 3,
+			// ModelViewerModel::Meshlet array.
+			Meshlets = 4,
+			// ModelViewerModel::Lod array, LOD 0 first.
+			Lods = 5,
+			// ModelViewerModel::ClusterPage array, covering the meshlets in order.
+			PageTable = 6,
+			// The pages' packed vertices and indices, addressed by ClusterPage::offset.
+			PageData = 7,
+		};
+
+		struct SourceStamp
+		{
+			uint64_t size = 0;
+			int64_t modifiedTime = 0;
+			uint64_t hash = 0;
+
+			bool operator==(const SourceStamp& other) const = default;
+		};
+
+		struct VertexAttribute
+		{
+			uint32_t format;
+			uint32_t offset;
+		};
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			SourceStamp source;
+			uint32_t vertexStride;
+			uint32_t attributeCount;
+			VertexAttribute attributes[4];
+			uint64_t vertexCount;
+			uint64_t indexCount;
+			float boundsMin[3];
+			float boundsMax[3];
+			// Of the sphere around the bounds' centre enclosing every vertex.
+			float boundingRadius;
+			uint32_t sectionCount;
+			uint32_t flags;
+		};
+
+		struct Section
+		{
+			SectionType type;
+			uint32_t reserved;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		// Returns the cache for sourcePath, or nullptr if it is missing, corrupt, stale or
+		// lacks any of requiredFlags.
+		static std::unique_ptr<ModelViewerMeshCache> open(const std::string& sourcePath, uint32_t requiredFlags = 0);
+		// Pass the optimizer's stats if builder has been optimized, and in passFlags the
+		// Stripified, Clustered, Simplified and Paged passes that were tried on it.
+		static void write(const std::string& sourcePath, const ModelViewerModel::Builder& builder,
+			const ModelViewerMeshOptimizer::Stats* optimizerStats = nullptr, uint32_t passFlags = 0);
+		static std::string cachePathFor(const std::string& sourcePath);
+		static SourceStamp stampSource(const std::string& sourcePath);
+
+		ModelViewerMeshCache(const ModelViewerMeshCache&) = delete;
+		ModelViewerMeshCache& operator=(const ModelViewerMeshCache&) = delete;
+
+		const Header& header() const { return *header_; }
+		// Quantized against the header's bounds.
+		std::span<const ModelViewerModel::PackedVertex> vertices() const { return vertices_; }
+		std::span<const uint32_t> indices() const { return indices_; }
+		// Null unless the cached mesh was optimized.
+		const ModelViewerMeshOptimizer::Stats* optimizerStats() const { return optimizerStats_; }
+		std::span<const ModelViewerModel::Meshlet> meshlets() const { return meshlets_; }
+		// Empty when the mesh has a single LOD.
+		std::span<const ModelViewerModel::Lod> lods() const { return lods_; }
+		// Empty unless the mesh was imported for streaming.
+		std::span<const ModelViewerModel::ClusterPage> pages() const { return pages_; }
+		const uint8_t* pageData(const ModelViewerModel::ClusterPage& page) const { return pageData_.data() + page.offset; }
+		VkPrimitiveTopology topology() const
+		{
+			return (header_->flags & TriangleStrips) ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		}
+		size_t fileSize() const { return file.size(); }
+
+	private:
+		explicit ModelViewerMeshCache(const std::string& cachePath);
+
+		bool validate(const std::string& sourcePath, uint32_t requiredFlags);
+
+		ModelViewerMappedFile file;
+		const Header* header_ = nullptr;
+		std::span<const ModelViewerModel::PackedVertex> vertices_{};
+		std::span<const uint32_t> indices_{};
+		const ModelViewerMeshOptimizer::Stats* optimizerStats_ = nullptr;
+		std::span<const ModelViewerModel::Meshlet> meshlets_{};
+		std::span<const ModelViewerModel::Lod> lods_{};
+		std::span<const ModelViewerModel::ClusterPage> pages_{};
+		std::span<const uint8_t> pageData_{};
+	};
+} // namespace ModelViewer
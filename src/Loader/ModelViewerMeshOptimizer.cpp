@@ -0,0 +1,478 @@
+#include "ModelViewerMeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		using Vertex = ModelViewerModel::Vertex;
+
+		constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+		// Forsyth's tuning constants. The cache modelled while ordering is larger than the
+		// analysis cache so the order holds up on GPUs with bigger caches too.
+		constexpr uint32_t kCacheSize = 32;
+		constexpr float kCacheDecayPower = 1.5f;
+		constexpr float kLastTriangleScore = 0.75f;
+		constexpr float kValenceBoostScale = 2.0f;
+		constexpr float kValenceBoostPower = 0.5f;
+		constexpr uint32_t kMaxValence = 32;
+
+		// Pending triangles the stripifier may pick the next strip triangle from.
+		constexpr size_t kStripWindow = 16;
+
+		struct ScoreTables
+		{
+			std::array<float, kCacheSize> cache{};
+			std::array<float, kMaxValence + 1> valence{};
+
+			ScoreTables()
+			{
+				for (uint32_t position = 0; position < kCacheSize; position++)
+				{
+					// The last triangle's vertices score a fixed amount so the next triangle does
+					// not simply reuse the same edge and strip along one direction.
+					cache[position] = position < 3 ? kLastTriangleScore
+						: std::pow(1.0f - static_cast<float>(position - 3) / (kCacheSize - 3), kCacheDecayPower);
+				}
+
+				// Vertices with few triangles left are boosted so they get finished off instead
+				// of becoming lone stragglers that are fetched again later.
+				for (uint32_t count = 1; count <= kMaxValence; count++)
+				{
+					valence[count] = kValenceBoostScale * std::pow(static_cast<float>(count), -kValenceBoostPower);
+				}
+			}
+
+			float score(int32_t cachePosition, uint32_t activeTriangles) const
+			{
+				if (activeTriangles == 0)
+				{
+					return -1.0f;
+				}
+				const float cacheScore = cachePosition < 0 ? 0.0f : cache[cachePosition];
+				return cacheScore + valence[std::min(activeTriangles, kMaxValence)];
+			}
+		};
+
+		struct Cluster
+		{
+			uint32_t firstTriangle;
+			uint32_t endTriangle;
+			float sortKey;
+		};
+	}
+
+	ModelViewerMeshOptimizer::Stats ModelViewerMeshOptimizer::optimize(ModelViewerModel::Builder& builder)
+	{
+		Stats stats{};
+		if (builder.indices.empty() || builder.indices.size() % 3 != 0)
+		{
+			return stats;
+		}
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		stats.before = analyzeVertexCache(builder.indices, builder.vertices.size());
+		optimizeVertexCache(builder.indices, builder.vertices.size());
+		optimizeOverdraw(builder.indices, builder.vertices);
+		optimizeVertexFetch(builder.vertices, builder.indices);
+		stats.after = analyzeVertexCache(builder.indices, builder.vertices.size());
+
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		return stats;
+	}
+
+	ModelViewerMeshOptimizer::CacheStats ModelViewerMeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		CacheStats stats{};
+		if (indices.empty())
+		{
+			return stats;
+		}
+
+		// A vertex is still cached if fewer than cacheSize misses happened since it was loaded.
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+		size_t misses = 0;
+		size_t uniqueVertices = 0;
+
+		for (uint32_t index : indices)
+		{
+			if (timestamps[index] == 0)
+			{
+				uniqueVertices++;
+			}
+			if (time - timestamps[index] > cacheSize)
+			{
+				timestamps[index] = time++;
+				misses++;
+			}
+		}
+
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+		stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+		return stats;
+	}
+
+	void ModelViewerMeshOptimizer::optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		const ScoreTables& tables = []() -> const ScoreTables& { static const ScoreTables scoreTables; return scoreTables; }();
+
+		// Triangles using each vertex; the first activeCounts[v] entries are not emitted yet.
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (uint32_t index : indices)
+		{
+			offsets[index + 1]++;
+		}
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> activeCounts(vertexCount, 0);
+		for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+				adjacency[offsets[vertex] + activeCounts[vertex]++] = triangle;
+			}
+		}
+
+		std::vector<int32_t> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			vertexScores[vertex] = tables.score(-1, activeCounts[vertex]);
+		}
+
+		auto triangleScore = [&](uint32_t triangle)
+		{
+			const uint32_t* corners = &indices[triangle * 3];
+			return vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+		};
+
+		std::vector<float> triangleScores(triangleCount);
+		uint32_t best = 0;
+		for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			triangleScores[triangle] = triangleScore(triangle);
+			if (triangleScores[triangle] > triangleScores[best])
+			{
+				best = triangle;
+			}
+		}
+
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		std::vector<uint32_t> output(indices.size());
+
+		// LRU order, most recent first. Holds up to three evicted entries between steps.
+		std::array<uint32_t, kCacheSize + 3> cache{};
+		std::array<uint32_t, kCacheSize + 3> nextCache{};
+		size_t cacheCount = 0;
+		uint32_t deadEndCursor = 0;
+
+		for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+		{
+			if (best == kNone)
+			{
+				// Nothing in the cache has triangles left; continue with the next one in input order.
+				while (emitted[deadEndCursor])
+				{
+					deadEndCursor++;
+				}
+				best = deadEndCursor;
+			}
+
+			const uint32_t* corners = &indices[best * 3];
+			std::copy(corners, corners + 3, output.begin() + emittedCount * 3);
+			emitted[best] = 1;
+
+			size_t nextCount = 0;
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t vertex = corners[corner];
+
+				uint32_t* triangles = &adjacency[offsets[vertex]];
+				uint32_t* last = triangles + activeCounts[vertex] - 1;
+				std::iter_swap(std::find(triangles, last, best), last);
+				activeCounts[vertex]--;
+
+				if (std::find(nextCache.begin(), nextCache.begin() + nextCount, vertex) == nextCache.begin() + nextCount)
+				{
+					nextCache[nextCount++] = vertex;
+				}
+			}
+			for (size_t i = 0; i < cacheCount; i++)
+			{
+				const uint32_t vertex = cache[i];
+				if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+				{
+					nextCache[nextCount++] = vertex;
+				}
+			}
+
+			for (size_t i = 0; i < nextCount; i++)
+			{
+				const uint32_t vertex = nextCache[i];
+				cachePositions[vertex] = i < kCacheSize ? static_cast<int32_t>(i) : -1;
+				vertexScores[vertex] = tables.score(cachePositions[vertex], activeCounts[vertex]);
+			}
+
+			// Only triangles of vertices whose score changed can have a new score, and the next
+			// triangle is picked among those still touching the cache.
+			best = kNone;
+			float bestScore = -std::numeric_limits<float>::max();
+			for (size_t i = 0; i < nextCount; i++)
+			{
+				const uint32_t vertex = nextCache[i];
+				const uint32_t* triangles = &adjacency[offsets[vertex]];
+				for (uint32_t j = 0; j < activeCounts[vertex]; j++)
+				{
+					const uint32_t triangle = triangles[j];
+					triangleScores[triangle] = triangleScore(triangle);
+					if (i < kCacheSize && triangleScores[triangle] > bestScore)
+					{
+						bestScore = triangleScores[triangle];
+						best = triangle;
+					}
+				}
+			}
+
+			std::swap(cache, nextCache);
+			cacheCount = std::min<size_t>(nextCount, kCacheSize);
+		}
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void ModelViewerMeshOptimizer::optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Hard boundaries are triangles where all three vertices miss: the cache order starts
+		// over there anyway, so moving the run after it costs nothing.
+		std::vector<uint32_t> timestamps(vertices.size(), 0);
+		uint32_t time = kAnalysisCacheSize + 1;
+		auto countMisses = [&](uint32_t triangle)
+		{
+			uint32_t misses = 0;
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+				if (time - timestamps[vertex] > kAnalysisCacheSize)
+				{
+					timestamps[vertex] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		};
+
+		std::vector<uint32_t> hardStarts;
+		size_t meshMisses = 0;
+		for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			const uint32_t misses = countMisses(triangle);
+			if (triangle == 0 || misses == 3)
+			{
+				hardStarts.push_back(triangle);
+			}
+			meshMisses += misses;
+		}
+		hardStarts.push_back(triangleCount);
+		const float maxAcmr = threshold * static_cast<float>(meshMisses) / static_cast<float>(triangleCount);
+
+		// Soft boundaries split long runs once, starting from a cold cache, they have become
+		// cheap enough that cutting there keeps the whole mesh within the threshold.
+		std::vector<Cluster> clusters;
+		for (size_t hard = 0; hard + 1 < hardStarts.size(); hard++)
+		{
+			uint32_t clusterStart = hardStarts[hard];
+			size_t clusterMisses = 0;
+			time += kAnalysisCacheSize + 1;
+
+			for (uint32_t triangle = hardStarts[hard]; triangle < hardStarts[hard + 1]; triangle++)
+			{
+				clusterMisses += countMisses(triangle);
+				const float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(triangle + 1 - clusterStart);
+				if (clusterAcmr <= maxAcmr && triangle + 1 < hardStarts[hard + 1])
+				{
+					clusters.push_back({ clusterStart, triangle + 1, 0.0f });
+					clusterStart = triangle + 1;
+					clusterMisses = 0;
+					time += kAnalysisCacheSize + 1;
+				}
+			}
+			clusters.push_back({ clusterStart, hardStarts[hard + 1], 0.0f });
+		}
+
+		// Clusters facing away from the mesh centre are likely on the outside and drawn first.
+		std::vector<glm::vec3> centroids(clusters.size());
+		std::vector<glm::vec3> normals(clusters.size());
+		glm::vec3 meshCentroid{ 0.0f };
+		float meshArea = 0.0f;
+		for (size_t i = 0; i < clusters.size(); i++)
+		{
+			glm::vec3 centroid{ 0.0f };
+			glm::vec3 normal{ 0.0f };
+			float area = 0.0f;
+			for (uint32_t triangle = clusters[i].firstTriangle; triangle < clusters[i].endTriangle; triangle++)
+			{
+				const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].position;
+				const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].position;
+				const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].position;
+
+				const glm::vec3 scaledNormal = glm::cross(p1 - p0, p2 - p0);
+				const float triangleArea = glm::length(scaledNormal);
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal += scaledNormal;
+				area += triangleArea;
+			}
+
+			meshCentroid += centroid;
+			meshArea += area;
+			centroids[i] = area > 0.0f ? centroid / area : centroid;
+			const float normalLength = glm::length(normal);
+			normals[i] = normalLength > 0.0f ? normal / normalLength : normal;
+		}
+		if (meshArea > 0.0f)
+		{
+			meshCentroid /= meshArea;
+		}
+
+		for (size_t i = 0; i < clusters.size(); i++)
+		{
+			clusters[i].sortKey = glm::dot(centroids[i] - meshCentroid, normals[i]);
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		for (const Cluster& cluster : clusters)
+		{
+			output.insert(output.end(), indices.begin() + cluster.firstTriangle * 3, indices.begin() + cluster.endTriangle * 3);
+		}
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void ModelViewerMeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices)
+	{
+		std::vector<uint32_t> remap(vertices.size(), kNone);
+		std::vector<Vertex> reordered;
+		reordered.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == kNone)
+			{
+				remap[index] = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices = std::move(reordered);
+	}
+
+	std::vector<uint32_t> ModelViewerMeshOptimizer::stripify(std::span<const uint32_t> indices)
+	{
+		using Triangle = std::array<uint32_t, 3>;
+
+		const size_t triangleCount = indices.size() / 3;
+		std::vector<uint32_t> strips;
+		strips.reserve(indices.size());
+
+		std::vector<Triangle> window;
+		size_t nextTriangle = 0;
+		auto refill = [&]()
+		{
+			while (window.size() < kStripWindow && nextTriangle < triangleCount)
+			{
+				const Triangle triangle{ indices[nextTriangle * 3], indices[nextTriangle * 3 + 1], indices[nextTriangle * 3 + 2] };
+				nextTriangle++;
+				if (triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[2] != triangle[0])
+				{
+					window.push_back(triangle);
+				}
+			}
+		};
+
+		// Finds a pending triangle with the directed edge from -> to and its third vertex.
+		auto findContinuation = [&](uint32_t from, uint32_t to, uint32_t& third) -> size_t
+		{
+			for (size_t i = 0; i < window.size(); i++)
+			{
+				for (uint32_t edge = 0; edge < 3; edge++)
+				{
+					if (window[i][edge] == from && window[i][(edge + 1) % 3] == to)
+					{
+						third = window[i][(edge + 2) % 3];
+						return i;
+					}
+				}
+			}
+			return kNone;
+		};
+
+		refill();
+		while (!window.empty())
+		{
+			Triangle first = window.front();
+			window.erase(window.begin());
+			refill();
+
+			// The second triangle of a strip is odd, so it needs the first one's last edge
+			// reversed; start from the rotation that has such a neighbour.
+			uint32_t third;
+			for (uint32_t rotation = 0; rotation < 3; rotation++)
+			{
+				if (findContinuation(first[2], first[1], third) != kNone)
+				{
+					break;
+				}
+				std::rotate(first.begin(), first.begin() + 1, first.end());
+			}
+
+			if (!strips.empty())
+			{
+				strips.push_back(kRestartIndex);
+			}
+			strips.insert(strips.end(), first.begin(), first.end());
+
+			// Triangle k of a strip is (v[k], v[k+1], v[k+2]) for even k and (v[k+1], v[k], v[k+2])
+			// for odd k, so each new vertex needs an edge through the last two in that order.
+			for (size_t k = 1;; k++)
+			{
+				const uint32_t previous = strips[strips.size() - 2];
+				const uint32_t last = strips[strips.size() - 1];
+				const size_t found = k % 2 == 0 ? findContinuation(previous, last, third) : findContinuation(last, previous, third);
+				if (found == kNone)
+				{
+					break;
+				}
+
+				strips.push_back(third);
+				window.erase(window.begin() + found);
+				refill();
+			}
+		}
+
+		return strips;
+	}
+} // namespace ModelViewer
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ModelViewerModel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Reorders an indexed triangle list for the GPU. Triangles are first sorted for the
+	// post-transform vertex cache (Forsyth's linear-speed algorithm), then runs of them are
+	// reordered so outward facing clusters draw first and occlude the rest (Sander, Nehab
+	// and Barczak's overdraw pass, limited so the cache efficiency barely drops), and finally
+	// vertices are renumbered in first-use order so vertex fetch walks memory linearly.
+	class ModelViewerMeshOptimizer
+	{
+	public:
+		// FIFO cache size the analysis simulates; close to what current GPUs behave like.
+		static constexpr uint32_t kAnalysisCacheSize = 16;
+		// Separates the strips returned by stripify; narrowed to 0xFFFF for 16-bit indices.
+		static constexpr uint32_t kRestartIndex = 0xFFFFFFFF;
+
+		struct CacheStats
+		{
+			// Average cache misses per triangle: 3 is no reuse, 0.5 the ideal for a grid.
+			float acmr = 0.0f;
+			// Average cache misses per referenced vertex: 1 means every vertex is shaded once.
+			float atvr = 0.0f;
+		};
+
+		struct Stats
+		{
+			CacheStats before{};
+			CacheStats after{};
+			double milliseconds = 0.0;
+		};
+
+		// Runs every pass over builder in place.
+		static Stats optimize(ModelViewerModel::Builder& builder);
+
+		static CacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = kAnalysisCacheSize);
+
+		static void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+		// Expects cache optimized input. threshold is the ACMR increase a cluster may cost.
+		static void optimizeOverdraw(std::span<uint32_t> indices, std::span<const ModelViewerModel::Vertex> vertices, float threshold = 1.05f);
+		// Renumbers vertices by first use and drops unreferenced ones.
+		static void optimizeVertexFetch(std::vector<ModelViewerModel::Vertex>& vertices, std::span<uint32_t> indices);
+
+		// Converts a triangle list into triangle strips separated by kRestartIndex, keeping
+		// the winding and roughly the cache order. Degenerate triangles are dropped. The
+		// result is only smaller than the list when the strips are long, so compare sizes.
+		static std::vector<uint32_t> stripify(std::span<const uint32_t> indices);
+	};
+} // namespace ModelViewer
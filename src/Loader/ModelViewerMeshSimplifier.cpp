@@ -0,0 +1,468 @@
+#include "ModelViewerMeshSimplifier.h"
+#include "ModelViewerMeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		using Vertex = ModelViewerModel::Vertex;
+
+		// Border planes weigh more than surface planes so open edges stay in place.
+		constexpr double kBorderWeight = 10.0;
+		// Collapses may turn a triangle by at most about 75 degrees.
+		constexpr float kMinNormalDot = 0.25f;
+		// A LOD that removes less than this share of the previous one's indices ends the chain.
+		constexpr float kMinLodReduction = 0.15f;
+
+		enum class VertexKind : uint8_t
+		{
+			Manifold,
+			// On an open border; only collapses along the border.
+			Border,
+			// Has several attribute sets at one position; only collapses onto another seam vertex.
+			Seam,
+			// Corner of several borders or on a non-manifold edge; never collapses.
+			Locked,
+		};
+
+		// Sum of squared distances to a set of weighted planes, as the symmetric 4x4 matrix.
+		struct Quadric
+		{
+			double a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0, ad = 0, bd = 0, cd = 0, d2 = 0;
+			double weight = 0;
+
+			void addPlane(const glm::vec3& normal, float distance, double planeWeight)
+			{
+				const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+				a2 += a * a * planeWeight; b2 += b * b * planeWeight; c2 += c * c * planeWeight;
+				ab += a * b * planeWeight; ac += a * c * planeWeight; bc += b * c * planeWeight;
+				ad += a * d * planeWeight; bd += b * d * planeWeight; cd += c * d * planeWeight;
+				d2 += d * d * planeWeight;
+				weight += planeWeight;
+			}
+
+			Quadric& operator+=(const Quadric& other)
+			{
+				a2 += other.a2; b2 += other.b2; c2 += other.c2;
+				ab += other.ab; ac += other.ac; bc += other.bc;
+				ad += other.ad; bd += other.bd; cd += other.cd;
+				d2 += other.d2;
+				weight += other.weight;
+				return *this;
+			}
+
+			// Weighted mean squared distance of point to the planes.
+			double evaluate(const glm::vec3& point) const
+			{
+				const double x = point.x, y = point.y, z = point.z;
+				const double sum = a2 * x * x + b2 * y * y + c2 * z * z
+					+ 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+					+ 2.0 * (ad * x + bd * y + cd * z) + d2;
+				return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+
+		uint64_t edgeKey(uint32_t a, uint32_t b)
+		{
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		float attributeDistance(const Vertex& a, const Vertex& b)
+		{
+			const glm::vec3 normal = a.normal - b.normal;
+			const glm::vec3 color = a.color - b.color;
+			const float du = a.uv.x - b.uv.x;
+			const float dv = a.uv.y - b.uv.y;
+			return glm::dot(normal, normal) + glm::dot(color, color) + du * du + dv * dv;
+		}
+	}
+
+	std::vector<uint32_t> ModelViewerMeshSimplifier::simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+		size_t targetIndexCount, float maxError, float& error)
+	{
+		error = 0.0f;
+		std::vector<uint32_t> result(indices.begin(), indices.end());
+		if (result.size() <= targetIndexCount || vertices.empty())
+		{
+			return result;
+		}
+
+		// Vertices sharing a position act as one; the lowest index represents them and the
+		// rest are chained into a ring so a collapse can pick the closest attribute set.
+		const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+		std::vector<uint32_t> byPosition(vertexCount);
+		std::iota(byPosition.begin(), byPosition.end(), 0u);
+		std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b)
+		{
+			const glm::vec3& pa = vertices[a].position;
+			const glm::vec3& pb = vertices[b].position;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		});
+
+		std::vector<uint32_t> canonical(vertexCount);
+		std::vector<uint32_t> nextWedge(vertexCount);
+		std::vector<uint32_t> wedgeCount(vertexCount, 0);
+		for (size_t begin = 0; begin < byPosition.size();)
+		{
+			size_t end = begin + 1;
+			while (end < byPosition.size() && vertices[byPosition[end]].position == vertices[byPosition[begin]].position)
+			{
+				end++;
+			}
+			const uint32_t representative = byPosition[begin];
+			for (size_t i = begin; i < end; i++)
+			{
+				canonical[byPosition[i]] = representative;
+				nextWedge[byPosition[i]] = byPosition[i + 1 < end ? i + 1 : begin];
+			}
+			wedgeCount[representative] = static_cast<uint32_t>(end - begin);
+			begin = end;
+		}
+
+		auto position = [&](uint32_t index) -> const glm::vec3& { return vertices[index].position; };
+
+		std::vector<Quadric> quadrics(vertexCount);
+		std::vector<uint8_t> sticky(vertexCount, 0);
+		std::unordered_map<uint64_t, uint32_t> edgeUse;
+
+		// Edge use counts decide borders, non-manifold edges and border planes.
+		auto countEdges = [&]()
+		{
+			edgeUse.clear();
+			edgeUse.reserve(result.size());
+			for (size_t i = 0; i < result.size(); i++)
+			{
+				const uint32_t a = canonical[result[i]];
+				const uint32_t b = canonical[result[i - i % 3 + (i + 1) % 3]];
+				edgeUse[edgeKey(a, b)]++;
+			}
+		};
+
+		countEdges();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const uint32_t corners[3] = { canonical[result[i]], canonical[result[i + 1]], canonical[result[i + 2]] };
+			glm::vec3 normal = glm::cross(position(corners[1]) - position(corners[0]), position(corners[2]) - position(corners[0]));
+			const float doubleArea = glm::length(normal);
+			if (doubleArea == 0.0f)
+			{
+				continue;
+			}
+			normal /= doubleArea;
+
+			Quadric plane{};
+			plane.addPlane(normal, -glm::dot(normal, position(corners[0])), doubleArea * 0.5);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				quadrics[corners[corner]] += plane;
+
+				const uint32_t a = corners[corner];
+				const uint32_t b = corners[(corner + 1) % 3];
+				if (edgeUse[edgeKey(a, b)] == 1)
+				{
+					// A plane through the border edge, perpendicular to the surface.
+					const glm::vec3 edge = position(b) - position(a);
+					const glm::vec3 borderNormal = glm::cross(edge, normal);
+					const float borderLength = glm::length(borderNormal);
+					if (borderLength > 0.0f)
+					{
+						Quadric border{};
+						border.addPlane(borderNormal / borderLength, -glm::dot(borderNormal / borderLength, position(a)), glm::dot(edge, edge) * kBorderWeight);
+						quadrics[a] += border;
+						quadrics[b] += border;
+					}
+				}
+			}
+		}
+
+		std::vector<VertexKind> kinds(vertexCount);
+		std::vector<uint32_t> borderEdges(vertexCount);
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+		std::vector<uint32_t> vertexTriangles;
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<uint32_t> collapseTo(vertexCount);
+		std::vector<Collapse> candidates;
+		std::vector<uint32_t> neighbours;
+		const double maxCost = static_cast<double>(maxError) * maxError;
+		double worstCost = 0.0;
+
+		while (result.size() > targetIndexCount)
+		{
+			const size_t triangleCount = result.size() / 3;
+			countEdges();
+
+			// Classify against the current topology; locks from non-manifold edges stay.
+			std::fill(borderEdges.begin(), borderEdges.end(), 0u);
+			for (const auto& [key, uses] : edgeUse)
+			{
+				const uint32_t a = static_cast<uint32_t>(key >> 32);
+				const uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFFu);
+				if (uses == 1)
+				{
+					borderEdges[a]++;
+					borderEdges[b]++;
+				}
+				else if (uses > 2)
+				{
+					sticky[a] = sticky[b] = 1;
+				}
+			}
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				if (sticky[v] || (borderEdges[v] != 0 && borderEdges[v] != 2))
+				{
+					kinds[v] = VertexKind::Locked;
+				}
+				else if (borderEdges[v] == 2)
+				{
+					kinds[v] = VertexKind::Border;
+				}
+				else
+				{
+					kinds[v] = wedgeCount[v] > 1 ? VertexKind::Seam : VertexKind::Manifold;
+				}
+			}
+
+			// Triangles around each position, as offsets into vertexTriangles.
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0u);
+			for (uint32_t index : result)
+			{
+				triangleOffsets[canonical[index] + 1]++;
+			}
+			std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+			vertexTriangles.resize(result.size());
+			{
+				std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); i++)
+				{
+					vertexTriangles[cursor[canonical[result[i]]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			auto allowed = [&](uint32_t from, uint32_t to, bool borderEdge)
+			{
+				switch (kinds[from])
+				{
+				case VertexKind::Manifold: return true;
+				case VertexKind::Border: return borderEdge;
+				case VertexKind::Seam: return wedgeCount[to] > 1;
+				default: return false;
+				}
+			};
+
+			candidates.clear();
+			for (size_t i = 0; i < result.size(); i++)
+			{
+				const uint32_t a = canonical[result[i]];
+				const uint32_t b = canonical[result[i - i % 3 + (i + 1) % 3]];
+				const uint32_t uses = edgeUse[edgeKey(a, b)];
+				// Interior edges appear twice; keep one of them.
+				if (uses != 1 && a > b)
+				{
+					continue;
+				}
+
+				Quadric merged = quadrics[a];
+				merged += quadrics[b];
+				const double costAB = allowed(a, b, uses == 1) ? merged.evaluate(position(b)) : std::numeric_limits<double>::infinity();
+				const double costBA = allowed(b, a, uses == 1) ? merged.evaluate(position(a)) : std::numeric_limits<double>::infinity();
+				if (std::isinf(costAB) && std::isinf(costBA))
+				{
+					continue;
+				}
+				candidates.push_back(costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA });
+			}
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+			std::fill(touched.begin(), touched.end(), uint8_t{ 0 });
+			std::iota(collapseTo.begin(), collapseTo.end(), 0u);
+			const size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+			size_t removed = 0;
+
+			for (const Collapse& collapse : candidates)
+			{
+				if (removed >= trianglesToRemove || collapse.cost > maxCost)
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to])
+				{
+					continue;
+				}
+
+				// Link condition: the two ends may only share the neighbours opposite their
+				// common triangles, or the collapse pinches the surface.
+				neighbours.clear();
+				uint32_t sharedTriangles = 0;
+				bool flips = false;
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+				{
+					const uint32_t triangle = vertexTriangles[t];
+					uint32_t corners[3];
+					bool hasTo = false;
+					for (int corner = 0; corner < 3; corner++)
+					{
+						corners[corner] = canonical[result[triangle * 3 + corner]];
+						hasTo |= corners[corner] == collapse.to;
+						if (corners[corner] != collapse.from)
+						{
+							neighbours.push_back(corners[corner]);
+						}
+					}
+					if (hasTo)
+					{
+						sharedTriangles++;
+						continue;
+					}
+
+					const glm::vec3 before = glm::cross(position(corners[1]) - position(corners[0]), position(corners[2]) - position(corners[0]));
+					glm::vec3 moved[3];
+					for (int corner = 0; corner < 3; corner++)
+					{
+						moved[corner] = position(corners[corner] == collapse.from ? collapse.to : corners[corner]);
+					}
+					const glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+					if (glm::dot(before, after) <= kMinNormalDot * glm::length(before) * glm::length(after))
+					{
+						flips = true;
+						break;
+					}
+				}
+				if (flips)
+				{
+					continue;
+				}
+
+				std::sort(neighbours.begin(), neighbours.end());
+				neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+				uint32_t commonNeighbours = 0;
+				for (uint32_t t = triangleOffsets[collapse.to]; t < triangleOffsets[collapse.to + 1]; t++)
+				{
+					const uint32_t triangle = vertexTriangles[t];
+					for (int corner = 0; corner < 3; corner++)
+					{
+						const uint32_t v = canonical[result[triangle * 3 + corner]];
+						if (v != collapse.to && v != collapse.from && std::binary_search(neighbours.begin(), neighbours.end(), v))
+						{
+							commonNeighbours++;
+						}
+					}
+				}
+				// Each shared neighbour is seen once per triangle of collapse.to containing it;
+				// opposite vertices of shared triangles account for exactly two sightings each
+				// (one triangle with the edge, one without) on a manifold.
+				if (commonNeighbours > sharedTriangles * 2)
+				{
+					continue;
+				}
+
+				collapseTo[collapse.from] = collapse.to;
+				quadrics[collapse.to] += quadrics[collapse.from];
+				worstCost = std::max(worstCost, collapse.cost);
+				removed += sharedTriangles;
+
+				// Lock the whole one-ring so the flip checks above stay valid for this pass.
+				touched[collapse.from] = touched[collapse.to] = 1;
+				for (uint32_t neighbour : neighbours)
+				{
+					touched[neighbour] = 1;
+				}
+			}
+
+			if (removed == 0)
+			{
+				break;
+			}
+
+			// Move the collapsed corners onto the wedge of their target with the closest
+			// attributes and drop the triangles that became degenerate.
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				uint32_t corners[3];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const uint32_t index = result[i + corner];
+					const uint32_t target = collapseTo[canonical[index]];
+					corners[corner] = index;
+					if (target != canonical[index])
+					{
+						uint32_t best = target;
+						float bestDistance = std::numeric_limits<float>::max();
+						uint32_t wedge = target;
+						do
+						{
+							const float distance = attributeDistance(vertices[index], vertices[wedge]);
+							if (distance < bestDistance)
+							{
+								bestDistance = distance;
+								best = wedge;
+							}
+							wedge = nextWedge[wedge];
+						} while (wedge != target);
+						corners[corner] = best;
+					}
+				}
+
+				const uint32_t a = canonical[corners[0]];
+				const uint32_t b = canonical[corners[1]];
+				const uint32_t c = canonical[corners[2]];
+				if (a != b && b != c && a != c)
+				{
+					result[write++] = corners[0];
+					result[write++] = corners[1];
+					result[write++] = corners[2];
+				}
+			}
+			result.resize(write);
+		}
+
+		error = static_cast<float>(std::sqrt(worstCost));
+		return result;
+	}
+
+	void ModelViewerMeshSimplifier::generateLods(ModelViewerModel::Builder& builder)
+	{
+		builder.lods.clear();
+		builder.lods.push_back({ 0, static_cast<uint32_t>(builder.indices.size()), 0.0f });
+		if (builder.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+		{
+			return;
+		}
+
+		// Each LOD is simplified from the previous one, which is much cheaper than starting
+		// over from LOD 0 every time.
+		std::vector<uint32_t> previous = builder.indices;
+		while (builder.lods.size() < ModelViewerModel::kMaxLods && previous.size() / 3 >= 2 * kMinLodTriangles)
+		{
+			const size_t target = previous.size() / 6 * 3;
+			float error = 0.0f;
+			std::vector<uint32_t> lod = simplify(builder.vertices, previous, target, std::numeric_limits<float>::max(), error);
+			if (lod.size() > previous.size() * (1.0f - kMinLodReduction))
+			{
+				break;
+			}
+
+			ModelViewerMeshOptimizer::optimizeVertexCache(lod, builder.vertices.size());
+			builder.lods.push_back({ static_cast<uint32_t>(builder.indices.size()), static_cast<uint32_t>(lod.size()), builder.lods.back().error + error });
+			builder.indices.insert(builder.indices.end(), lod.begin(), lod.end());
+			previous = std::move(lod);
+		}
+	}
+} // namespace ModelViewer
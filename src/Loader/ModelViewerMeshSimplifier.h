@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ModelViewerModel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Quadric error edge collapse (Garland and Heckbert) restricted to collapsing a vertex onto
+	// one of its neighbours, so the simplified index lists keep using the original vertex
+	// buffer and every LOD of a model is just another index range. Vertices that share a
+	// position are collapsed together; open borders and attribute seams only collapse along
+	// themselves, and collapses that would flip a triangle are rejected.
+	class ModelViewerMeshSimplifier
+	{
+	public:
+		// Meshes with fewer triangles than twice this get no further LODs.
+		static constexpr uint32_t kMinLodTriangles = 128;
+
+		// Collapses edges until at most targetIndexCount indices remain or no collapse is
+		// cheaper than maxError. error receives the largest distance error introduced, in
+		// object space units.
+		static std::vector<uint32_t> simplify(std::span<const ModelViewerModel::Vertex> vertices, std::span<const uint32_t> indices,
+			size_t targetIndexCount, float maxError, float& error);
+
+		// Appends up to ModelViewerModel::kMaxLods - 1 cache optimized LODs of the triangle
+		// list in builder, each with about half the triangles of the previous one, and fills
+		// builder.lods. Errors accumulate, so each LOD's error bounds its distance from LOD 0.
+		static void generateLods(ModelViewerModel::Builder& builder);
+	};
+} // namespace ModelViewer
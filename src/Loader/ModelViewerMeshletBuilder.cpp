@@ -0,0 +1,203 @@
+#include "ModelViewerMeshletBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ModelViewer
+{
+	std::vector<ModelViewerModel::Meshlet> ModelViewerMeshletBuilder::build(std::span<const ModelViewerModel::Vertex> vertices, std::span<const uint32_t> indices,
+		uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		std::vector<ModelViewerModel::Meshlet> meshlets;
+		if (indices.size() < 3 || maxVertices < 3 || maxTriangles == 0)
+		{
+			return meshlets;
+		}
+
+		// Meshlet number each vertex was last counted for, so the unique vertex count of the
+		// open meshlet needs no set.
+		std::vector<uint32_t> vertexMeshlet(vertices.size(), std::numeric_limits<uint32_t>::max());
+
+		ModelViewerModel::Meshlet current{};
+		const size_t triangleCount = indices.size() / 3;
+		for (size_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			const uint32_t* corners = &indices[triangle * 3];
+			const uint32_t meshletNumber = static_cast<uint32_t>(meshlets.size());
+
+			uint32_t newVertices = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				// A vertex repeated inside the triangle only counts once.
+				if (vertexMeshlet[corners[corner]] != meshletNumber &&
+					(corner < 1 || corners[corner] != corners[0]) &&
+					(corner < 2 || corners[corner] != corners[1]))
+				{
+					newVertices++;
+				}
+			}
+
+			if (current.indexCount != 0 &&
+				(current.vertexCount + newVertices > maxVertices || current.indexCount / 3 == maxTriangles))
+			{
+				computeBounds(current, vertices, indices);
+				meshlets.push_back(current);
+
+				current = {};
+				current.firstIndex = static_cast<uint32_t>(triangle * 3);
+				// Every vertex is new to the next meshlet.
+				newVertices = 0;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					if ((corner < 1 || corners[corner] != corners[0]) && (corner < 2 || corners[corner] != corners[1]))
+					{
+						newVertices++;
+					}
+				}
+			}
+
+			const uint32_t openMeshlet = static_cast<uint32_t>(meshlets.size());
+			for (int corner = 0; corner < 3; corner++)
+			{
+				vertexMeshlet[corners[corner]] = openMeshlet;
+			}
+			current.vertexCount += newVertices;
+			current.indexCount += 3;
+		}
+
+		computeBounds(current, vertices, indices);
+		meshlets.push_back(current);
+		return meshlets;
+	}
+
+	void ModelViewerMeshletBuilder::buildPages(ModelViewerModel::Builder& builder)
+	{
+		builder.pages.clear();
+		builder.pageData.clear();
+		if (builder.meshlets.empty())
+		{
+			return;
+		}
+
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (const ModelViewerModel::Vertex& vertex : builder.vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		const float quantizationScale = ModelViewerModel::quantizationScaleFor(boundsMin, boundsMax);
+
+		// Page local number of each mesh vertex, reset after every page.
+		constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+		std::vector<uint32_t> localVertex(builder.vertices.size(), kUnused);
+		std::vector<uint32_t> pageVertices;
+		std::vector<uint16_t> pageIndices;
+		std::vector<ModelViewerModel::Vertex> gathered;
+		std::vector<ModelViewerModel::PackedVertex> packed;
+		for (size_t first = 0; first < builder.meshlets.size(); first += kPageMeshlets)
+		{
+			const size_t count = std::min<size_t>(kPageMeshlets, builder.meshlets.size() - first);
+			pageVertices.clear();
+			pageIndices.clear();
+
+			// Meshlets are consecutive runs of the index list, so the page's indices are too
+			// and a meshlet's page local first index is its offset from the page's first.
+			const ModelViewerModel::Meshlet& last = builder.meshlets[first + count - 1];
+			for (uint32_t i = builder.meshlets[first].firstIndex; i < last.firstIndex + last.indexCount; i++)
+			{
+				const uint32_t vertex = builder.indices[i];
+				if (localVertex[vertex] == kUnused)
+				{
+					localVertex[vertex] = static_cast<uint32_t>(pageVertices.size());
+					pageVertices.push_back(vertex);
+				}
+				pageIndices.push_back(static_cast<uint16_t>(localVertex[vertex]));
+			}
+			assert(pageVertices.size() <= kPageVertices && pageIndices.size() <= kPageIndices && "Page exceeds its slot!");
+
+			gathered.clear();
+			for (uint32_t vertex : pageVertices)
+			{
+				gathered.push_back(builder.vertices[vertex]);
+				localVertex[vertex] = kUnused;
+			}
+			packed.resize(gathered.size());
+			ModelViewerModel::packVertices(gathered, boundsMin, quantizationScale, packed);
+
+			ModelViewerModel::ClusterPage& page = builder.pages.emplace_back();
+			page.offset = builder.pageData.size();
+			page.vertexCount = static_cast<uint32_t>(pageVertices.size());
+			page.indexCount = static_cast<uint32_t>(pageIndices.size());
+			page.firstMeshlet = static_cast<uint32_t>(first);
+			page.meshletCount = static_cast<uint32_t>(count);
+
+			const size_t vertexBytes = sizeof(ModelViewerModel::PackedVertex) * packed.size();
+			const size_t indexBytes = sizeof(uint16_t) * pageIndices.size();
+			// Every page starts 16 byte aligned, like the cache sections.
+			builder.pageData.resize((page.offset + vertexBytes + indexBytes + 15) & ~size_t{ 15 });
+			std::memcpy(builder.pageData.data() + page.offset, packed.data(), vertexBytes);
+			std::memcpy(builder.pageData.data() + page.offset + vertexBytes, pageIndices.data(), indexBytes);
+		}
+	}
+
+	void ModelViewerMeshletBuilder::computeBounds(ModelViewerModel::Meshlet& meshlet, std::span<const ModelViewerModel::Vertex> vertices, std::span<const uint32_t> indices)
+	{
+		const std::span<const uint32_t> range = indices.subspan(meshlet.firstIndex, meshlet.indexCount);
+
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (uint32_t index : range)
+		{
+			boundsMin = glm::min(boundsMin, vertices[index].position);
+			boundsMax = glm::max(boundsMax, vertices[index].position);
+		}
+		meshlet.center = (boundsMin + boundsMax) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (uint32_t index : range)
+		{
+			meshlet.radius = std::max(meshlet.radius, glm::length(vertices[index].position - meshlet.center));
+		}
+
+		// The cone axis is the average face direction; its spread is the worst face against it.
+		std::vector<glm::vec3> normals;
+		normals.reserve(range.size() / 3);
+		glm::vec3 axis{ 0.0f };
+		for (size_t i = 0; i + 2 < range.size(); i += 3)
+		{
+			const glm::vec3& a = vertices[range[i]].position;
+			const glm::vec3 normal = glm::cross(vertices[range[i + 1]].position - a, vertices[range[i + 2]].position - a);
+			const float area = glm::length(normal);
+			if (area > 0.0f)
+			{
+				normals.push_back(normal / area);
+				axis += normals.back();
+			}
+		}
+
+		meshlet.coneAxis = { 0.0f, 0.0f, 1.0f };
+		meshlet.coneCutoff = 1.0f;
+		const float axisLength = glm::length(axis);
+		if (normals.empty() || axisLength == 0.0f)
+		{
+			return;
+		}
+		axis /= axisLength;
+
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(axis, normal));
+		}
+		meshlet.coneAxis = axis;
+		// Past about 84 degrees the cone is almost never back-facing as a whole; leaving it
+		// unculled saves the test and guards against precision loss near a half sphere.
+		if (minDot > 0.1f)
+		{
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+} // namespace ModelViewer
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ModelViewerModel.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Splits a triangle list into meshlets: runs of consecutive triangles referencing at most
+	// kMaxVertices unique vertices, each with a bounding sphere and a normal cone so the GPU
+	// can cull it on its own. Triangles are never reordered, so cache optimized input (which
+	// walks the surface in small patches) gives compact clusters and keeps its cache order.
+	class ModelViewerMeshletBuilder
+	{
+	public:
+		static constexpr uint32_t kMaxVertices = 64;
+		static constexpr uint32_t kMaxTriangles = 124;
+		// Smaller meshes are cheap enough to draw whole.
+		static constexpr uint32_t kMinTriangles = 8 * kMaxTriangles;
+
+		// Meshlets per streaming page, and the most vertices and indices a page can hold.
+		static constexpr uint32_t kPageMeshlets = 16;
+		static constexpr uint32_t kPageVertices = kPageMeshlets * kMaxVertices;
+		static constexpr uint32_t kPageIndices = kPageMeshlets * kMaxTriangles * 3;
+
+		static std::vector<ModelViewerModel::Meshlet> build(std::span<const ModelViewerModel::Vertex> vertices, std::span<const uint32_t> indices,
+			uint32_t maxVertices = kMaxVertices, uint32_t maxTriangles = kMaxTriangles);
+
+		// Packs every kPageMeshlets consecutive meshlets of builder into builder.pages and
+		// builder.pageData, with the vertices they use quantized in the whole mesh's cube.
+		static void buildPages(ModelViewerModel::Builder& builder);
+
+	private:
+		static void computeBounds(ModelViewerModel::Meshlet& meshlet, std::span<const ModelViewerModel::Vertex> vertices, std::span<const uint32_t> indices);
+	};
+} // namespace ModelViewer
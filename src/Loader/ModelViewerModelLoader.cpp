@@ -0,0 +1,150 @@
+#include "ModelViewerModelLoader.h"
+#include "ModelViewerDevice.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		// Finished models waiting for the render thread; workers hold on to theirs when full.
+		constexpr size_t kResultCapacity = 256;
+
+		bool isObjFile(const std::filesystem::path& path)
+		{
+			std::string extension = path.extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			return extension == ".obj";
+		}
+
+		ModelViewerJobSystem& currentJobSystem()
+		{
+			ModelViewerJobSystem* jobSystem = ModelViewerJobSystem::current();
+			if (jobSystem == nullptr)
+			{
+				throw std::runtime_error("Model loading needs a running job system!");
+			}
+			return *jobSystem;
+		}
+	}
+
+	ModelViewerModelLoader::ModelViewerModelLoader(std::shared_ptr<ModelViewerDevice> device, ModelImportOptions importOptions) :
+		modelViewerDevice{ device }, importOptions{ importOptions }, jobSystem{ currentJobSystem() }, results{ kResultCapacity }
+	{
+	}
+
+	ModelViewerModelLoader::~ModelViewerModelLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ resultMutex };
+			cancelled = true;
+		}
+		resultSpace.notify_all();
+		jobSystem.wait(loads);
+	}
+
+	void ModelViewerModelLoader::request(const std::string& path)
+	{
+		std::vector<std::pair<std::uintmax_t, std::string>> parts;
+		try
+		{
+			if (std::filesystem::is_directory(path))
+			{
+				for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+				{
+					if (entry.is_regular_file() && isObjFile(entry.path()))
+					{
+						parts.emplace_back(entry.file_size(), entry.path().string());
+					}
+				}
+				std::sort(parts.begin(), parts.end());
+			}
+			else
+			{
+				parts.emplace_back(0, path);
+			}
+		}
+		catch (const std::filesystem::filesystem_error& e)
+		{
+			// Called from the render thread, which must not wait on its own queue.
+			std::cout << "Could not queue " << path << ": " << e.what() << std::endl;
+			requestedCount++;
+			failedCount++;
+			return;
+		}
+
+		// Background jobs start in the order they were queued.
+		requestedCount += static_cast<uint32_t>(parts.size());
+		for (auto& [size, partPath] : parts)
+		{
+			jobSystem.runBackground(loads, [this, partPath = std::move(partPath)]() { load(partPath); });
+		}
+	}
+
+	bool ModelViewerModelLoader::tryPopResult(Result& result)
+	{
+		if (!results.tryPop(result))
+		{
+			return false;
+		}
+
+		// An empty critical section keeps a worker from missing the wakeup between failing
+		// to push and going to sleep.
+		{
+			std::lock_guard<std::mutex> lock{ resultMutex };
+		}
+		resultSpace.notify_one();
+		return true;
+	}
+
+	ModelViewerModelLoader::Progress ModelViewerModelLoader::getProgress() const
+	{
+		Progress progress{};
+		progress.requested = requestedCount.load();
+		progress.loaded = loadedCount.load();
+		progress.failed = failedCount.load();
+		return progress;
+	}
+
+	void ModelViewerModelLoader::load(const std::string& path)
+	{
+		if (cancelled)
+		{
+			return;
+		}
+
+		Result result{ path };
+		try
+		{
+			result.model = ModelViewerModel::createModelFromFile(*modelViewerDevice, path, importOptions);
+			// Starts the copies now rather than with the next frame.
+			result.uploadTicket = modelViewerDevice->submitUploads();
+		}
+		catch (const std::exception& e)
+		{
+			result.error = e.what();
+		}
+		finish(std::move(result));
+	}
+
+	void ModelViewerModelLoader::finish(Result&& result)
+	{
+		// Loaded models are counted by markLoaded() once they are on screen.
+		if (!result.model)
+		{
+			failedCount++;
+		}
+
+		// A finished model is never dropped while the viewer is running; sleep until the
+		// render thread makes room instead.
+		std::unique_lock<std::mutex> lock{ resultMutex };
+		resultSpace.wait(lock, [&]() { return cancelled || results.tryPush(std::move(result)); });
+	}
+} // namespace ModelViewer
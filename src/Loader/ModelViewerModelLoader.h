@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Core/ModelViewerJobSystem.h"
+#include "Core/ModelViewerMpmcQueue.h"
+#include "ModelViewerModel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace ModelViewer
+{
+	class ModelViewerDevice;
+
+	// Loads models on the job system's background workers so the render loop never waits
+	// on a file. Requests return immediately; parsing, processing and the staging upload
+	// run on a worker, which submits the upload itself, and finished models come back
+	// through a lock-free queue that the render thread drains once per frame.
+	class ModelViewerModelLoader
+	{
+	public:
+		struct Result
+		{
+			std::string path;
+			// Null when loading failed, in which case error says why.
+			std::shared_ptr<ModelViewerModel> model;
+			std::string error;
+			// Staging ring ticket of the model's uploads; see ModelViewerDevice::isUploadReady.
+			uint64_t uploadTicket = 0;
+		};
+
+		struct Progress
+		{
+			uint32_t requested = 0;
+			uint32_t loaded = 0;
+			uint32_t failed = 0;
+
+			bool isLoading() const { return loaded + failed < requested; }
+		};
+
+		explicit ModelViewerModelLoader(std::shared_ptr<ModelViewerDevice> device, ModelImportOptions importOptions = {});
+		// Skips requests that have not started yet and waits for the ones that have.
+		~ModelViewerModelLoader();
+
+		ModelViewerModelLoader(const ModelViewerModelLoader&) = delete;
+		ModelViewerModelLoader& operator=(const ModelViewerModelLoader&) = delete;
+
+		// Queues an .obj file, or every .obj file below a directory. A directory's parts are
+		// queued smallest first so the first of them appear almost at once.
+		void request(const std::string& path);
+
+		// Hands over one finished request. Call from the render thread.
+		bool tryPopResult(Result& result);
+		// Counts a handed over model as loaded. Called by the render thread once the model
+		// is in the scene, so that progress never runs ahead of what is on screen.
+		void markLoaded() { loadedCount++; }
+
+		Progress getProgress() const;
+
+	private:
+		void load(const std::string& path);
+		void finish(Result&& result);
+
+		std::shared_ptr<ModelViewerDevice> modelViewerDevice;
+		ModelImportOptions importOptions;
+		ModelViewerJobSystem& jobSystem;
+		ModelViewerJobSystem::TaskGroup loads;
+		ModelViewerMpmcQueue<Result> results;
+		// Workers with a result and a full queue sleep on this until the render thread pops.
+		std::mutex resultMutex;
+		std::condition_variable resultSpace;
+
+		std::atomic<uint32_t> requestedCount{ 0 };
+		std::atomic<uint32_t> loadedCount{ 0 };
+		std::atomic<uint32_t> failedCount{ 0 };
+		std::atomic<bool> cancelled{ false };
+	};
+} // namespace ModelViewer
@@ -0,0 +1,543 @@
+#include "ModelViewerObjLoader.h"
+#include "ModelViewerVertexWelder.h"
+#include "Core/ModelViewerMappedFile.h"
+#include "Core/ModelViewerJobSystem.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr uint32_t kMissingIndex = std::numeric_limits<uint32_t>::max();
+		constexpr size_t kMinChunkSize = 1 << 20;
+
+		using ObjCorner = ModelViewerVertexWelder::Key;
+
+		// Negative (relative) OBJ indices can point into an earlier chunk, so they are
+		// stored relative to the chunk start and patched once the chunk offsets are known.
+		struct ObjFixup
+		{
+			uint32_t corner;
+			uint32_t attribute;
+		};
+
+		struct ObjChunk
+		{
+			const char* begin = nullptr;
+			const char* end = nullptr;
+
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec3> colors;
+			std::vector<glm::vec3> normals;
+			std::vector<glm::vec2> texcoords;
+			std::vector<ObjCorner> corners;
+			std::vector<ObjFixup> fixups;
+
+			size_t positionBase = 0;
+			size_t normalBase = 0;
+			size_t texcoordBase = 0;
+			size_t cornerBase = 0;
+		};
+
+		constexpr double kPowersOfTen[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+		inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+		inline const char* skipBlanks(const char* p, const char* end)
+		{
+			while (p < end && isBlank(*p))
+			{
+				p++;
+			}
+			return p;
+		}
+
+		// Fast path for the plain decimal notation that OBJ exporters write. Anything it
+		// cannot represent exactly enough (very long mantissas, large exponents, inf/nan)
+		// falls back to std::from_chars. Returns nullptr when no number was found.
+		const char* parseFloat(const char* p, const char* end, float& out)
+		{
+			p = skipBlanks(p, end);
+			const char* start = p;
+
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+
+			uint64_t mantissa = 0;
+			int exponent = 0;
+			int significantDigits = 0;
+			bool anyDigits = false;
+
+			while (p < end && isDigit(*p))
+			{
+				anyDigits = true;
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+					significantDigits += mantissa != 0;
+				}
+				else
+				{
+					exponent++;
+				}
+				p++;
+			}
+
+			if (p < end && *p == '.')
+			{
+				p++;
+				while (p < end && isDigit(*p))
+				{
+					anyDigits = true;
+					if (significantDigits < 19)
+					{
+						mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+						significantDigits += mantissa != 0;
+						exponent--;
+					}
+					p++;
+				}
+			}
+
+			if (!anyDigits)
+			{
+				auto result = std::from_chars(start, end, out);
+				return result.ec == std::errc() ? result.ptr : nullptr;
+			}
+
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				const char* exponentStart = p;
+				p++;
+				bool negativeExponent = false;
+				if (p < end && (*p == '-' || *p == '+'))
+				{
+					negativeExponent = *p == '-';
+					p++;
+				}
+
+				if (p < end && isDigit(*p))
+				{
+					int value = 0;
+					while (p < end && isDigit(*p))
+					{
+						if (value < 10000)
+						{
+							value = value * 10 + (*p - '0');
+						}
+						p++;
+					}
+					exponent += negativeExponent ? -value : value;
+				}
+				else
+				{
+					p = exponentStart;
+				}
+			}
+
+			double value = static_cast<double>(mantissa);
+			if (exponent < 0 && exponent >= -22)
+			{
+				value /= kPowersOfTen[-exponent];
+			}
+			else if (exponent > 0 && exponent <= 22)
+			{
+				value *= kPowersOfTen[exponent];
+			}
+			else if (exponent != 0)
+			{
+				auto result = std::from_chars(start, end, out);
+				return result.ec == std::errc() ? result.ptr : nullptr;
+			}
+
+			out = static_cast<float>(negative ? -value : value);
+			return p;
+		}
+
+		const char* parseInt(const char* p, const char* end, int64_t& out)
+		{
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+
+			if (p >= end || !isDigit(*p))
+			{
+				return nullptr;
+			}
+
+			int64_t value = 0;
+			while (p < end && isDigit(*p))
+			{
+				value = value * 10 + (*p - '0');
+				p++;
+			}
+
+			out = negative ? -value : value;
+			return p;
+		}
+
+		[[noreturn]] void throwParseError(const std::string& filepath, const char* fileData, const char* line, const char* what)
+		{
+			throw std::runtime_error("Failed to parse OBJ " + filepath + ": " + what +
+				" at byte offset " + std::to_string(line - fileData));
+		}
+
+		// Parses one v, v/vt, v//vn or v/vt/vn face corner. Positive indices are absolute
+		// and 1-based; negative ones are relative to the elements read so far and are
+		// flagged in relativeMask (bit 0 position, 1 texcoord, 2 normal).
+		const char* parseCorner(const ObjChunk& chunk, const char* p, const char* end, ObjCorner& corner, uint32_t& relativeMask)
+		{
+			corner = { kMissingIndex, kMissingIndex, kMissingIndex };
+			relativeMask = 0;
+
+			auto record = [&](uint32_t& slot, int64_t value, size_t localCount, uint32_t attribute)
+			{
+				if (value > 0)
+				{
+					slot = static_cast<uint32_t>(value - 1);
+				}
+				else
+				{
+					slot = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int64_t>(localCount) + value));
+					relativeMask |= 1u << attribute;
+				}
+			};
+
+			int64_t index = 0;
+			p = parseInt(p, end, index);
+			if (p == nullptr || index == 0)
+			{
+				return nullptr;
+			}
+			record(corner.position, index, chunk.positions.size(), 0);
+
+			if (p < end && *p == '/')
+			{
+				p++;
+				if (p < end && *p != '/')
+				{
+					p = parseInt(p, end, index);
+					if (p == nullptr || index == 0)
+					{
+						return nullptr;
+					}
+					record(corner.texcoord, index, chunk.texcoords.size(), 1);
+				}
+
+				if (p < end && *p == '/')
+				{
+					p = parseInt(p + 1, end, index);
+					if (p == nullptr || index == 0)
+					{
+						return nullptr;
+					}
+					record(corner.normal, index, chunk.normals.size(), 2);
+				}
+			}
+
+			return p;
+		}
+
+		void parseChunk(const std::string& filepath, const char* fileData, ObjChunk& chunk)
+		{
+			const char* p = chunk.begin;
+			const char* end = chunk.end;
+
+			std::vector<ObjCorner> polygon;
+			std::vector<uint32_t> relativeMasks;
+
+			while (p < end)
+			{
+				const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+				if (lineEnd == nullptr)
+				{
+					lineEnd = end;
+				}
+
+				const char* q = skipBlanks(p, lineEnd);
+				if (q + 1 < lineEnd && q[0] == 'v' && isBlank(q[1]))
+				{
+					glm::vec3 position;
+					q = parseFloat(q + 1, lineEnd, position.x);
+					if (q) q = parseFloat(q, lineEnd, position.y);
+					if (q) q = parseFloat(q, lineEnd, position.z);
+					if (q == nullptr)
+					{
+						throwParseError(filepath, fileData, p, "malformed vertex position");
+					}
+
+					glm::vec3 color;
+					const char* c = parseFloat(q, lineEnd, color.x);
+					if (c) c = parseFloat(c, lineEnd, color.y);
+					if (c) c = parseFloat(c, lineEnd, color.z);
+					if (c != nullptr)
+					{
+						if (chunk.colors.size() < chunk.positions.size())
+						{
+							chunk.colors.resize(chunk.positions.size(), glm::vec3{ 1.0f });
+						}
+						chunk.colors.push_back(color);
+					}
+					else if (!chunk.colors.empty())
+					{
+						chunk.colors.push_back(glm::vec3{ 1.0f });
+					}
+
+					chunk.positions.push_back(position);
+				}
+				else if (q + 2 < lineEnd && q[0] == 'v' && q[1] == 'n' && isBlank(q[2]))
+				{
+					glm::vec3 normal;
+					q = parseFloat(q + 2, lineEnd, normal.x);
+					if (q) q = parseFloat(q, lineEnd, normal.y);
+					if (q) q = parseFloat(q, lineEnd, normal.z);
+					if (q == nullptr)
+					{
+						throwParseError(filepath, fileData, p, "malformed vertex normal");
+					}
+					chunk.normals.push_back(normal);
+				}
+				else if (q + 2 < lineEnd && q[0] == 'v' && q[1] == 't' && isBlank(q[2]))
+				{
+					glm::vec2 texcoord{ 0.0f, 0.0f };
+					q = parseFloat(q + 2, lineEnd, texcoord.x);
+					if (q == nullptr)
+					{
+						throwParseError(filepath, fileData, p, "malformed texture coordinate");
+					}
+					parseFloat(q, lineEnd, texcoord.y);
+					chunk.texcoords.push_back(texcoord);
+				}
+				else if (q + 1 < lineEnd && q[0] == 'f' && isBlank(q[1]))
+				{
+					polygon.clear();
+					relativeMasks.clear();
+					q = skipBlanks(q + 1, lineEnd);
+					while (q < lineEnd && *q != '\r' && *q != '#')
+					{
+						ObjCorner corner;
+						uint32_t relativeMask;
+						q = parseCorner(chunk, q, lineEnd, corner, relativeMask);
+						if (q == nullptr)
+						{
+							throwParseError(filepath, fileData, p, "malformed face");
+						}
+						polygon.push_back(corner);
+						relativeMasks.push_back(relativeMask);
+						q = skipBlanks(q, lineEnd);
+					}
+
+					if (polygon.size() < 3)
+					{
+						throwParseError(filepath, fileData, p, "face with fewer than three vertices");
+					}
+
+					for (size_t i = 1; i + 1 < polygon.size(); i++)
+					{
+						for (size_t k : { size_t{ 0 }, i, i + 1 })
+						{
+							for (uint32_t attribute = 0; attribute < 3; attribute++)
+							{
+								if (relativeMasks[k] & (1u << attribute))
+								{
+									chunk.fixups.push_back({ static_cast<uint32_t>(chunk.corners.size()), attribute });
+								}
+							}
+							chunk.corners.push_back(polygon[k]);
+						}
+					}
+				}
+
+				p = lineEnd + 1;
+			}
+
+			if (!chunk.colors.empty() && chunk.colors.size() < chunk.positions.size())
+			{
+				chunk.colors.resize(chunk.positions.size(), glm::vec3{ 1.0f });
+			}
+		}
+
+		std::vector<ObjChunk> splitIntoChunks(const char* data, size_t size)
+		{
+			size_t chunkCount = std::min<size_t>(jobThreadCount() * 4, std::max<size_t>(1, size / kMinChunkSize));
+			size_t chunkSize = size / chunkCount;
+
+			std::vector<ObjChunk> chunks;
+			chunks.reserve(chunkCount);
+
+			const char* end = data + size;
+			const char* begin = data;
+			for (size_t i = 0; i < chunkCount && begin < end; i++)
+			{
+				const char* chunkEnd = (i + 1 == chunkCount) ? end : std::min(end, begin + chunkSize);
+				if (chunkEnd < end)
+				{
+					const char* newline = static_cast<const char*>(memchr(chunkEnd, '\n', static_cast<size_t>(end - chunkEnd)));
+					chunkEnd = newline ? newline + 1 : end;
+				}
+
+				ObjChunk chunk;
+				chunk.begin = begin;
+				chunk.end = chunkEnd;
+				chunks.push_back(std::move(chunk));
+				begin = chunkEnd;
+			}
+
+			return chunks;
+		}
+
+		void resolveCorners(const std::string& filepath, ObjChunk& chunk, size_t positionCount, size_t texcoordCount, size_t normalCount)
+		{
+			const size_t bases[3] = { chunk.positionBase, chunk.texcoordBase, chunk.normalBase };
+			for (const auto& fixup : chunk.fixups)
+			{
+				ObjCorner& corner = chunk.corners[fixup.corner];
+				uint32_t* slots[3] = { &corner.position, &corner.texcoord, &corner.normal };
+				int64_t resolved = static_cast<int64_t>(bases[fixup.attribute]) + static_cast<int32_t>(*slots[fixup.attribute]);
+				*slots[fixup.attribute] = resolved < 0 ? kMissingIndex - 1 : static_cast<uint32_t>(resolved);
+			}
+
+			for (const auto& corner : chunk.corners)
+			{
+				if (corner.position >= positionCount ||
+					(corner.texcoord != kMissingIndex && corner.texcoord >= texcoordCount) ||
+					(corner.normal != kMissingIndex && corner.normal >= normalCount))
+				{
+					throw std::runtime_error("Failed to parse OBJ " + filepath + ": face index out of range");
+				}
+			}
+		}
+	}
+
+	void ModelViewerObjLoader::load(const std::string& filepath, ModelViewerModel::Builder& builder, Stats* stats)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		ModelViewerMappedFile file{ filepath };
+		std::vector<ObjChunk> chunks = splitIntoChunks(file.data(), file.size());
+
+		const size_t chunkCount = chunks.size();
+		parallelFor(chunkCount, [&](size_t i) { parseChunk(filepath, file.data(), chunks[i]); });
+
+		auto parsedTime = std::chrono::high_resolution_clock::now();
+
+		size_t positionCount = 0;
+		size_t normalCount = 0;
+		size_t texcoordCount = 0;
+		size_t cornerCount = 0;
+		bool hasColors = false;
+		for (auto& chunk : chunks)
+		{
+			chunk.positionBase = positionCount;
+			chunk.normalBase = normalCount;
+			chunk.texcoordBase = texcoordCount;
+			chunk.cornerBase = cornerCount;
+			positionCount += chunk.positions.size();
+			normalCount += chunk.normals.size();
+			texcoordCount += chunk.texcoords.size();
+			cornerCount += chunk.corners.size();
+			hasColors |= !chunk.colors.empty();
+		}
+
+		if (cornerCount > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::runtime_error("Failed to load OBJ " + filepath + ": too many face corners for 32-bit indices");
+		}
+
+		std::vector<glm::vec3> positions(positionCount);
+		std::vector<glm::vec3> colors(hasColors ? positionCount : 0);
+		std::vector<glm::vec3> normals(normalCount);
+		std::vector<glm::vec2> texcoords(texcoordCount);
+
+		parallelFor(chunks.size(), [&](size_t i)
+		{
+			ObjChunk& chunk = chunks[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.texcoordBase);
+			if (hasColors)
+			{
+				if (chunk.colors.empty())
+				{
+					std::fill_n(colors.begin() + chunk.positionBase, chunk.positions.size(), glm::vec3{ 1.0f });
+				}
+				else
+				{
+					std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + chunk.positionBase);
+				}
+			}
+
+			resolveCorners(filepath, chunk, positionCount, texcoordCount, normalCount);
+		});
+
+		auto mergedTime = std::chrono::high_resolution_clock::now();
+
+		std::vector<std::span<const ObjCorner>> cornerChunks;
+		cornerChunks.reserve(chunks.size());
+		for (auto& chunk : chunks)
+		{
+			chunk.positions = {};
+			chunk.colors = {};
+			chunk.normals = {};
+			chunk.texcoords = {};
+			cornerChunks.emplace_back(chunk.corners);
+		}
+
+		std::vector<ObjCorner> uniqueCorners;
+		builder.indices.resize(cornerCount);
+		ModelViewerVertexWelder::Stats weldStats = ModelViewerVertexWelder::weld(cornerChunks, uniqueCorners, builder.indices);
+
+		cornerChunks.clear();
+		chunks.clear();
+
+		builder.vertices.resize(uniqueCorners.size());
+		const size_t vertexBatchSize = 1 << 16;
+		parallelFor((uniqueCorners.size() + vertexBatchSize - 1) / vertexBatchSize, [&](size_t batch)
+		{
+			const size_t begin = batch * vertexBatchSize;
+			const size_t end = std::min(uniqueCorners.size(), begin + vertexBatchSize);
+			for (size_t v = begin; v < end; v++)
+			{
+				const ObjCorner& corner = uniqueCorners[v];
+				ModelViewerModel::Vertex& vertex = builder.vertices[v];
+				vertex.position = positions[corner.position];
+				vertex.color = hasColors ? colors[corner.position] : glm::vec3{ 1.0f };
+				vertex.normal = corner.normal != kMissingIndex ? normals[corner.normal] : glm::vec3{ 0.0f };
+				vertex.uv = corner.texcoord != kMissingIndex ? texcoords[corner.texcoord] : glm::vec2{ 0.0f, 0.0f };
+			}
+		});
+
+		auto weldedTime = std::chrono::high_resolution_clock::now();
+
+		if (stats != nullptr)
+		{
+			stats->fileSize = file.size();
+			stats->chunkCount = chunkCount;
+			stats->positionCount = positionCount;
+			stats->normalCount = normalCount;
+			stats->texcoordCount = texcoordCount;
+			stats->triangleCount = cornerCount / 3;
+			stats->parseMilliseconds = std::chrono::duration<double, std::milli>(parsedTime - startTime).count();
+			stats->mergeMilliseconds = std::chrono::duration<double, std::milli>(mergedTime - parsedTime).count();
+			stats->weldMilliseconds = std::chrono::duration<double, std::milli>(weldedTime - mergedTime).count();
+			stats->weld = weldStats;
+		}
+	}
+} // namespace ModelViewer
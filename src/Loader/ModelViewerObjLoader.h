@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ModelViewerModel.h"
+#include "ModelViewerVertexWelder.h"
+
+#include <cstddef>
+#include <string>
+
+namespace ModelViewer
+{
+	// Wavefront OBJ importer. The file is memory mapped, split into line-aligned chunks
+	// and the chunks are parsed in parallel before being merged into a single Builder.
+	// Supports v (with optional vertex colors), vt, vn and polygonal f records; faces
+	// are fan-triangulated and every other record type is ignored. Identical
+	// (v, vt, vn) corners are welded into a single indexed vertex.
+	class ModelViewerObjLoader
+	{
+	public:
+		struct Stats
+		{
+			size_t fileSize = 0;
+			size_t chunkCount = 0;
+			size_t positionCount = 0;
+			size_t normalCount = 0;
+			size_t texcoordCount = 0;
+			size_t triangleCount = 0;
+			// Corners welded into unique vertices.
+			ModelViewerVertexWelder::Stats weld{};
+			double parseMilliseconds = 0.0;
+			double mergeMilliseconds = 0.0;
+			double weldMilliseconds = 0.0;
+		};
+
+		static void load(const std::string& filepath, ModelViewerModel::Builder& builder, Stats* stats = nullptr);
+	};
+} // namespace ModelViewer
@@ -0,0 +1,156 @@
+#include "ModelViewerVertexWelder.h"
+#include "Core/ModelViewerJobSystem.h"
+
+#include <bit>
+#include <limits>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		using Key = ModelViewerVertexWelder::Key;
+
+		constexpr uint32_t kEmptySlot = std::numeric_limits<uint32_t>::max();
+
+		inline uint64_t hashKey(const Key& key)
+		{
+			uint64_t h = (static_cast<uint64_t>(key.position) << 32) ^ (static_cast<uint64_t>(key.texcoord) * 0x9E3779B97F4A7C15ull) ^ key.normal;
+			h ^= h >> 33;
+			h *= 0xFF51AFD7ED558CCDull;
+			h ^= h >> 33;
+			h *= 0xC4CEB9FE1A85EC53ull;
+			h ^= h >> 33;
+			return h;
+		}
+
+		// Linear probing table mapping a key to the index of its first occurrence in a
+		// caller-owned key array. Slots only store that index, keeping probes compact.
+		class KeyTable
+		{
+		public:
+			KeyTable(size_t expectedCount)
+			{
+				resize(std::bit_ceil(std::max<size_t>(16, expectedCount * 2)));
+			}
+
+			// Returns the id of key, appending it to keys when it was not seen before.
+			uint32_t findOrInsert(const Key& key, std::vector<Key>& keys)
+			{
+				if ((keys.size() + 1) * 2 > slots.size())
+				{
+					resize(slots.size() * 2, keys);
+				}
+
+				size_t slot = hashKey(key) & mask;
+				while (true)
+				{
+					uint32_t id = slots[slot];
+					if (id == kEmptySlot)
+					{
+						id = static_cast<uint32_t>(keys.size());
+						slots[slot] = id;
+						keys.push_back(key);
+						return id;
+					}
+
+					if (keys[id] == key)
+					{
+						return id;
+					}
+
+					slot = (slot + 1) & mask;
+				}
+			}
+
+		private:
+			void resize(size_t capacity)
+			{
+				slots.assign(capacity, kEmptySlot);
+				mask = capacity - 1;
+			}
+
+			void resize(size_t capacity, const std::vector<Key>& keys)
+			{
+				resize(capacity);
+				for (uint32_t id = 0; id < keys.size(); id++)
+				{
+					size_t slot = hashKey(keys[id]) & mask;
+					while (slots[slot] != kEmptySlot)
+					{
+						slot = (slot + 1) & mask;
+					}
+					slots[slot] = id;
+				}
+			}
+
+			std::vector<uint32_t> slots;
+			size_t mask = 0;
+		};
+
+		struct ChunkWeld
+		{
+			std::vector<Key> uniqueKeys;
+			std::vector<uint32_t> localIndices;
+			std::vector<uint32_t> globalIds;
+			size_t cornerBase = 0;
+		};
+	}
+
+	ModelViewerVertexWelder::Stats ModelViewerVertexWelder::weld(const std::vector<std::span<const Key>>& chunks, std::vector<Key>& uniqueKeys, std::vector<uint32_t>& indices)
+	{
+		std::vector<ChunkWeld> welds(chunks.size());
+
+		size_t cornerCount = 0;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			welds[i].cornerBase = cornerCount;
+			cornerCount += chunks[i].size();
+		}
+
+		parallelFor(chunks.size(), [&](size_t i)
+		{
+			const auto& corners = chunks[i];
+			ChunkWeld& weld = welds[i];
+
+			KeyTable table{ corners.size() / 4 };
+			weld.localIndices.resize(corners.size());
+			for (size_t c = 0; c < corners.size(); c++)
+			{
+				weld.localIndices[c] = table.findOrInsert(corners[c], weld.uniqueKeys);
+			}
+		});
+
+		size_t localUniqueCount = 0;
+		for (const auto& weld : welds)
+		{
+			localUniqueCount += weld.uniqueKeys.size();
+		}
+
+		uniqueKeys.clear();
+		KeyTable globalTable{ localUniqueCount };
+		for (auto& weld : welds)
+		{
+			weld.globalIds.resize(weld.uniqueKeys.size());
+			for (size_t k = 0; k < weld.uniqueKeys.size(); k++)
+			{
+				weld.globalIds[k] = globalTable.findOrInsert(weld.uniqueKeys[k], uniqueKeys);
+			}
+			weld.uniqueKeys = {};
+		}
+
+		parallelFor(chunks.size(), [&](size_t i)
+		{
+			ChunkWeld& weld = welds[i];
+			for (size_t c = 0; c < weld.localIndices.size(); c++)
+			{
+				indices[weld.cornerBase + c] = weld.globalIds[weld.localIndices[c]];
+			}
+			weld.localIndices = {};
+		});
+
+		Stats stats{};
+		stats.cornerCount = cornerCount;
+		stats.uniqueCount = uniqueKeys.size();
+		return stats;
+	}
+} // namespace ModelViewer
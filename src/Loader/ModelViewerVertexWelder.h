@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Deduplicates OBJ style (position, texcoord, normal) index tuples into a list of
+	// unique tuples plus an index buffer referencing them. Chunks are welded in
+	// parallel against chunk-local tables, then the much smaller per-chunk unique
+	// sets are merged in order so the output keeps first-occurrence vertex order.
+	class ModelViewerVertexWelder
+	{
+	public:
+		struct Key
+		{
+			uint32_t position;
+			uint32_t texcoord;
+			uint32_t normal;
+
+			bool operator==(const Key& other) const
+			{
+				return position == other.position && texcoord == other.texcoord && normal == other.normal;
+			}
+		};
+
+		struct Stats
+		{
+			size_t cornerCount = 0;
+			size_t uniqueCount = 0;
+
+			// Fraction of corners that were merged into an existing vertex.
+			double weldRate() const { return cornerCount ? 1.0 - static_cast<double>(uniqueCount) / cornerCount : 0.0; }
+		};
+
+		// Welds every chunk in order. indices receives one entry per input corner and
+		// must be sized to the total corner count by the caller.
+		static Stats weld(const std::vector<std::span<const Key>>& chunks, std::vector<Key>& uniqueKeys, std::vector<uint32_t>& indices);
+	};
+} // namespace ModelViewer
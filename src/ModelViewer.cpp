@@ -1,5 +1,8 @@
 #include "ModelViewer.h"
+#include "Renderer/ModelViewerIndirectRenderSystem.h"
 #include "Renderer/ModelViewerSimpleRenderSystem.h"
+#include "ModelViewerResidencyManager.h"
+#include "Loader/ModelViewerModelLoader.h"
 #include "Camera/ModelViewerCamera.h"
 #include "Input/ModelViewerKeyboardController.h"
 
@@ -7,14 +10,24 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <cassert>
 #include <stdexcept>
 #include <array>
+#include <cmath>
 #include <chrono>
+#include <iostream>
 
 namespace ModelViewer
 {	
+	namespace
+	{
+		// Upper bound on the page memory moved when loading finishes, so the one-off hitch
+		// stays short.
+		constexpr VkDeviceSize kDefragmentationBudget = 256ull * 1024 * 1024;
+	}
+
 	static void check_vk_result(VkResult err)
 	{
 		if (err == 0)
@@ -24,7 +37,7 @@ namespace ModelViewer
 			abort();
 	}
 
-	ModelViewer::ModelViewer()
+	ModelViewer::ModelViewer(std::vector<std::string> modelPaths, ModelImportOptions importOptions, FramePacing framePacing) : modelPaths{ std::move(modelPaths) }
 	{
 		primaryMonitor = glfwGetPrimaryMonitor();
 		if (!primaryMonitor)
@@ -43,7 +56,8 @@ namespace ModelViewer
 
 		modelViewerWindow = std::make_shared<ModelViewerWindow>(WIDTH, HEIGHT, "Vulkan Window");
 		modelViewerDevice = std::make_shared<ModelViewerDevice>(*modelViewerWindow);
-		modelViewerRenderer = std::make_shared<ModelViewerRenderer>(modelViewerWindow, modelViewerDevice);
+		modelViewerRenderer = std::make_shared<ModelViewerRenderer>(modelViewerWindow, modelViewerDevice, framePacing);
+		modelLoader = std::make_unique<ModelViewerModelLoader>(modelViewerDevice, importOptions);
 
 		loadModelObjects();
 
@@ -104,55 +118,241 @@ namespace ModelViewer
 
 	void ModelViewer::loadModelObjects()
 	{
+		// Every loaded model hangs off one root, so the UI moves them as a single assembly.
+		TransformComponent rootTransform{};
+		rootTransform.translation = { 0.0f, 0.0f, 2.5f };
+		rootTransform.scale = { 0.5f, 0.5f, 0.5f };
+		sceneRoot = transformSystem.create(rootTransform);
+
+		// Models stream in on background threads and are picked up by collectLoadedModels().
+		loading = !modelPaths.empty();
+		for (const auto& modelPath : modelPaths)
+		{
+			modelLoader->request(modelPath);
+		}
+
+		if (!modelPaths.empty())
+		{
+			return;
+		}
+
 		std::shared_ptr<ModelViewerModel> cubeModel = createCubeModel(*modelViewerDevice, { 0.0f, 0.0f, 0.0f });
 
 		auto cube = ModelViewerObject::createObject();
 		cube.model = cubeModel;
+		cube.transform = transformSystem.create({}, sceneRoot);
 
-		cube.transform.translation = { 0.0f, 0.0f, 2.5f };
-		cube.transform.scale = { 0.5f, 0.5f, 0.5f };
-	
 		modelObjects.push_back(std::move(cube));
 	}
 
+	bool ModelViewer::collectLoadedModels()
+	{
+		ModelViewerModelLoader::Result result;
+		while (modelLoader->tryPopResult(result))
+		{
+			if (!result.model)
+			{
+				std::cout << "Failed to load " << result.path << ": " << result.error << std::endl;
+				continue;
+			}
+			uploadingModels.push_back(std::move(result));
+		}
+
+		// Models join the scene once their uploads finished, so no frame waits for them.
+		bool added = false;
+		for (auto it = uploadingModels.begin(); it != uploadingModels.end();)
+		{
+			if (!modelViewerDevice->isUploadReady(it->uploadTicket))
+			{
+				++it;
+				continue;
+			}
+
+			auto object = ModelViewerObject::createObject();
+			object.model = std::move(it->model);
+			object.transform = transformSystem.create({}, sceneRoot);
+			modelObjects.push_back(std::move(object));
+			modelLoader->markLoaded();
+			added = true;
+			it = uploadingModels.erase(it);
+		}
+
+		const bool wasLoading = loading;
+		loading = modelLoader->getProgress().isLoading();
+		if (wasLoading && !loading)
+		{
+			// Buffers replaced while loading leave holes behind; compacting the geometry pages
+			// once here costs a single hitch instead of one per loaded model.
+			const VkDeviceSize movedBytes = modelViewerDevice->getGeometryPool().defragment(kDefragmentationBudget);
+			if (movedBytes > 0)
+			{
+				std::cout << "Defragmented " << movedBytes << " bytes of geometry" << std::endl;
+			}
+			printMemoryStats();
+		}
+		return added;
+	}
+
+	void ModelViewer::printMemoryStats()
+	{
+		ModelViewerAllocator::Stats stats = modelViewerDevice->getAllocator().stats();
+		std::cout << "GPU memory: " << stats.bytesUsed << " bytes used of " << stats.bytesAllocated << " allocated in "
+			<< stats.blockCount << " blocks and " << stats.dedicatedCount << " dedicated allocations ("
+			<< stats.fragmentation() * 100.0 << "% fragmented)" << std::endl;
+
+		ModelViewerGeometryPool::Stats geometryStats = modelViewerDevice->getGeometryPool().stats();
+		std::cout << "Geometry pool: " << geometryStats.rangeCount << " meshes in " << geometryStats.pageCount << " pages, "
+			<< geometryStats.vertexBytesUsed + geometryStats.indexBytesUsed << " of "
+			<< geometryStats.vertexBytesCapacity + geometryStats.indexBytesCapacity << " bytes used" << std::endl;
+	}
+
 	void ModelViewer::run()
 	{
 		ImGuiRenderer imguiRenderer{ modelViewerDevice, modelViewerWindow, modelViewerRenderer };
 		ModelViewerSimpleRenderSystem simpleRenderSystem{ modelViewerDevice, modelViewerRenderer->getSwapChainRenderPass() };
 		ModelViewerCamera camera{};
 
+		RenderSettings renderSettings{};
+
+		std::unique_ptr<ModelViewerIndirectRenderSystem> indirectRenderSystem;
+		if (ModelViewerIndirectRenderSystem::isSupported(*modelViewerDevice))
+		{
+			indirectRenderSystem = std::make_unique<ModelViewerIndirectRenderSystem>(modelViewerDevice, modelViewerRenderer->getSwapChainRenderPass());
+			transformSystem.update();
+			indirectRenderSystem->setObjects(modelObjects);
+			renderSettings.gpuCullingSupported = true;
+			renderSettings.gpuCulling = true;
+		}
+		renderSettings.wireframeSupported = modelViewerDevice->getCapabilities().fillModeNonSolid;
+		renderSettings.framePacing = modelViewerRenderer->getFramePacing();
+
 		//camera.setViewDirection(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
 
-		auto viewerObject = ModelViewerObject::createObject();
+		TransformComponent viewerTransform{};
 		ModelViewerKeyboardController cameraController{};
 
 		auto currentTime = std::chrono::high_resolution_clock::now();
+		bool objectsChanged = false;
 
 		while (!modelViewerWindow->shouldClose())
 		{
+			// Under low-latency pacing this waits for the display, so input is sampled late.
+			modelViewerRenderer->waitForFramePacing();
 			glfwPollEvents();
+
+			objectsChanged |= collectLoadedModels();
+			const ModelViewerModelLoader::Progress progress = modelLoader->getProgress();
+			renderSettings.modelsRequested = progress.requested;
+			renderSettings.modelsLoaded = progress.loaded;
+			renderSettings.modelsFailed = progress.failed;
+			renderSettings.totalObjects = static_cast<uint32_t>(modelObjects.size());
+
+			const std::shared_ptr<ModelViewerSwapChain> swapChain = modelViewerRenderer->getSwapChain();
+			renderSettings.framesInFlight = swapChain->framesInFlight();
+			renderSettings.presentMode = ModelViewerSwapChain::presentModeName(swapChain->getPresentMode());
+			renderSettings.latency = swapChain->getLatency();
+			renderSettings.latencyToDisplay = swapChain->measuresDisplayLatency();
+
 			auto newTime = std::chrono::high_resolution_clock::now();
 			float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
 
 			currentTime = newTime;
 
-			//cameraController.moveInPlaneXZ(modelViewerWindow->getGLFWWindow(), frameTime, viewerObject);
-			//camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+			//cameraController.moveInPlaneXZ(modelViewerWindow->getGLFWWindow(), frameTime, viewerTransform);
+			//camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
 			//float aspect = modelViewerRenderer->getAspectRatio();
 			//camera.setPerspectiveProjection(glm::radians(50.0f), modelViewerWindow->getWidth(), modelViewerWindow->getHeight(), 0.1f, 10.0f);
 
-			ImGui_ImplVulkan_NewFrame();
+			{
+				// The backend may upload its font texture here.
+				auto queueLock = modelViewerDevice->lockQueue();
+				ImGui_ImplVulkan_NewFrame();
+			}
 			ImGui_ImplGlfw_NewFrame();
 			ImGui::NewFrame();
 
-			ModelViewerObject* objectptr = &modelObjects[0];
-
 			if (auto commandBuffer = modelViewerRenderer->beginFrame())
 			{
+				float width = (float)modelViewerWindow->getWidth();
+				float height = (float)modelViewerWindow->getHeight();
+				glm::mat4 cameraTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10));
+
+				FrameInfo frameInfo{ modelViewerRenderer->getFrameIndex(), frameTime, commandBuffer, camera };
+				frameInfo.commandRecorder = &modelViewerRenderer->getCommandRecorder();
+				frameInfo.viewProjection = glm::perspectiveFov(glm::radians(45.f), width, height, 0.1f, 100.0f)
+					* glm::inverse(cameraTransform);
+				frameInfo.cameraPosition = glm::vec3(cameraTransform[3]);
+				if (renderSettings.lods)
+				{
+					const float pixelsPerUnit = height / (2.0f * std::tan(glm::radians(45.f) * 0.5f));
+					frameInfo.lodErrorScale = pixelsPerUnit / renderSettings.lodPixelError;
+				}
+				frameInfo.lodCrossFade = renderSettings.lodCrossFade;
+				frameInfo.renderMode = renderSettings.renderMode;
+
+				TransformComponent transform = transformSystem.get(sceneRoot);
+				if (imguiRenderer.renderUI(transform, renderSettings))
+				{
+					transformSystem.set(sceneRoot, transform);
+				}
+
+				// Only subtrees edited since the last frame are recomputed and re-uploaded.
+				transformSystem.update();
+				if (indirectRenderSystem && objectsChanged)
+				{
+					// New models arrived; the object list is rebuilt with every current matrix.
+					indirectRenderSystem->setObjects(modelObjects);
+				}
+				else if (indirectRenderSystem)
+				{
+					for (ModelViewerTransformSystem::Handle changed : transformSystem.getChangedHandles())
+					{
+						indirectRenderSystem->markTransformDirty(changed);
+					}
+				}
+				objectsChanged = false;
+
+				// Culling runs in compute, so it is recorded before the render pass begins.
+				const bool gpuCulling = indirectRenderSystem && renderSettings.gpuCulling;
+				if (gpuCulling)
+				{
+					indirectRenderSystem->cull(frameInfo, transformSystem);
+					renderSettings.visibleObjects = indirectRenderSystem->getVisibleCount();
+					renderSettings.visibleClusters = indirectRenderSystem->getVisibleClusterCount();
+					renderSettings.totalClusters = indirectRenderSystem->getClusterCount();
+				}
+				else
+				{
+					renderSettings.visibleObjects = renderSettings.totalObjects;
+					renderSettings.visibleClusters = 0;
+					renderSettings.totalClusters = 0;
+				}
+
+				const ModelViewerResidencyManager::Stats residencyStats = modelViewerDevice->getResidencyManager().stats();
+				renderSettings.streamedPages = residencyStats.pageCount;
+				renderSettings.residentPages = residencyStats.residentPages;
+				renderSettings.pageSlots = residencyStats.slotCount;
+				renderSettings.pageFaultsPerSecond = residencyStats.faultsPerSecond;
+				renderSettings.uploadBytesPerSecond = residencyStats.uploadBytesPerSecond;
+
 				modelViewerRenderer->beginSwapChainRenderPass(commandBuffer);
-				simpleRenderSystem.renderModelObjects(commandBuffer, modelObjects, camera);
-				imguiRenderer.renderUI(objectptr);
+				if (gpuCulling)
+				{
+					indirectRenderSystem->render(frameInfo);
+				}
+				else
+				{
+					simpleRenderSystem.renderModelObjects(frameInfo, modelObjects, transformSystem);
+				}
+
+				renderSettings.pipelinesCompiling = simpleRenderSystem.getCompilingPipelineCount()
+					+ (indirectRenderSystem ? indirectRenderSystem->getCompilingPipelineCount() : 0);
+				renderSettings.pipelinesFailed = simpleRenderSystem.getFailedPipelineCount()
+					+ (indirectRenderSystem ? indirectRenderSystem->getFailedPipelineCount() : 0);
+
+				modelViewerRenderer->setFramePacing(renderSettings.framePacing);
+
 				imguiRenderer.drawUI();
 				modelViewerRenderer->endSwapChainRenderPass(commandBuffer);
 				modelViewerRenderer->endFrame();
@@ -161,11 +361,12 @@ namespace ModelViewer
 			// Update and Render additional Platform Windows
 			if (imguiRenderer.getImGuiIO()->ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
 			{
+				auto queueLock = modelViewerDevice->lockQueue();
 				ImGui::UpdatePlatformWindows();
 				ImGui::RenderPlatformWindowsDefault();
 			}
 		}
 
-		vkDeviceWaitIdle(modelViewerDevice->device());
+		modelViewerDevice->waitIdle();
 	}
 }
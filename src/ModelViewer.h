@@ -1,16 +1,20 @@
 #pragma once
 
+#include "Core/ModelViewerJobSystem.h"
 #include "ModelViewerDevice.h"
 #include "ModelViewerWindow.h"
 #include "Renderer/ModelViewerRenderer.h"
 #include "ModelViewerObject.h"
+#include "Scene/ModelViewerTransformSystem.h"
 #include "Renderer/ImGuiRenderer.h"
+#include "Loader/ModelViewerModelLoader.h"
 
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_vulkan.h"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace ModelViewer
@@ -18,7 +22,7 @@ namespace ModelViewer
 	class ModelViewer
 	{
 	public:
-		ModelViewer();
+		ModelViewer(std::vector<std::string> modelPaths = {}, ModelImportOptions importOptions = {}, FramePacing framePacing = FramePacing::Throughput);
 		~ModelViewer();
 
 		ModelViewer(const ModelViewer&) = delete;
@@ -28,16 +32,30 @@ namespace ModelViewer
 	private:
 
 		void loadModelObjects();
+		// Moves models finished by the loader into modelObjects; true if any were added.
+		bool collectLoadedModels();
+		void printMemoryStats();
 		
+		// Declared first so it outlives everything that schedules work on it.
+		ModelViewerJobSystem jobSystem;
+
 		int WIDTH;
 		int HEIGHT;
 
 		GLFWmonitor* primaryMonitor;
 		const GLFWvidmode* mode;
 
+		std::vector<std::string> modelPaths;
+
 		std::shared_ptr<ModelViewerWindow> modelViewerWindow;
 		std::shared_ptr<ModelViewerDevice> modelViewerDevice;
 		std::shared_ptr<ModelViewerRenderer> modelViewerRenderer;
+		std::unique_ptr<ModelViewerModelLoader> modelLoader;
+		// Loaded models whose uploads are still running on the transfer queue.
+		std::vector<ModelViewerModelLoader::Result> uploadingModels;
+		bool loading = false;
+		ModelViewerTransformSystem transformSystem;
+		ModelViewerTransformSystem::Handle sceneRoot = ModelViewerTransformSystem::INVALID_HANDLE;
 		std::vector<ModelViewerObject> modelObjects;
 	};
 }
\ No newline at end of file
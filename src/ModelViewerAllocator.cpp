@@ -0,0 +1,567 @@
+#include "ModelViewerAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr VkDeviceSize kDefaultBlockSize = 64ull * 1024 * 1024;
+		constexpr VkDeviceSize kMinBlockSize = 1ull * 1024 * 1024;
+		constexpr VkDeviceSize kTransientBlockSize = 16ull * 1024 * 1024;
+		// Whatever a frame's transient data ends up being used as.
+		constexpr VkBufferUsageFlags kTransientUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	ModelViewerAllocator::ModelViewerAllocator(VkPhysicalDevice physicalDevice, VkDevice device) : device{ device }
+	{
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	}
+
+	ModelViewerAllocator::~ModelViewerAllocator()
+	{
+		for (auto& [key, blocks] : pools)
+		{
+			for (auto& block : blocks)
+			{
+				destroyBlock(block.get());
+			}
+		}
+
+		for (auto& framePools : transientPools)
+		{
+			for (auto& [key, blocks] : framePools)
+			{
+				for (auto& block : blocks)
+				{
+					destroyBlock(block.get());
+				}
+			}
+		}
+
+		for (auto& block : dedicatedBlocks)
+		{
+			destroyBlock(block.get());
+		}
+	}
+
+	uint32_t ModelViewerAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) &&
+				(memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	VkDeviceSize ModelViewerAllocator::preferredBlockSize(uint32_t memoryType) const
+	{
+		// Small heaps (integrated GPUs, the BAR window) would be exhausted by a few
+		// default sized blocks, so scale the block down to an eighth of the heap.
+		const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+		return std::max(kMinBlockSize, std::min(kDefaultBlockSize, alignUp(heapSize / 8, kMinBlockSize)));
+	}
+
+	ModelViewerAllocator::Block* ModelViewerAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, ResourceKind kind, Strategy strategy)
+	{
+		auto block = std::make_unique<Block>();
+		block->size = size;
+		block->memoryType = memoryType;
+		block->kind = kind;
+		block->strategy = strategy;
+		allocateMemory(*block, size);
+
+		Block* result = block.get();
+		if (strategy == Strategy::Default)
+		{
+			block->freeRanges.emplace(0, size);
+			pools[PoolKey{ memoryType, kind }].push_back(std::move(block));
+		}
+		else
+		{
+			dedicatedBlocks.push_back(std::move(block));
+		}
+		return result;
+	}
+
+	ModelViewerAllocator::Block* ModelViewerAllocator::createTransientBlock(VkDeviceSize size, VkMemoryPropertyFlags properties)
+	{
+		auto block = std::make_unique<Block>();
+		block->transient = true;
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = kTransientUsage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &block->buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create transient buffer!");
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, block->buffer, &requirements);
+		block->size = size;
+		block->memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+
+		try
+		{
+			allocateMemory(*block, requirements.size);
+		}
+		catch (...)
+		{
+			vkDestroyBuffer(device, block->buffer, nullptr);
+			throw;
+		}
+		vkBindBufferMemory(device, block->buffer, block->memory, 0);
+
+		Block* result = block.get();
+		transientPools[transientFrame][properties].push_back(std::move(block));
+		return result;
+	}
+
+	void ModelViewerAllocator::allocateMemory(Block& block, VkDeviceSize size)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = block.memoryType;
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate device memory block!");
+		}
+
+		if (memoryProperties.memoryTypes[block.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			void* data;
+			if (vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+			{
+				vkFreeMemory(device, block.memory, nullptr);
+				throw std::runtime_error("Failed to map device memory block!");
+			}
+			block.mapped = static_cast<char*>(data);
+		}
+	}
+
+	void ModelViewerAllocator::destroyBlock(Block* block)
+	{
+		if (block->buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, block->buffer, nullptr);
+		}
+		if (block->mapped != nullptr)
+		{
+			vkUnmapMemory(device, block->memory);
+		}
+		vkFreeMemory(device, block->memory, nullptr);
+	}
+
+	bool ModelViewerAllocator::allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, void* userData, VkDeviceSize& offset)
+	{
+		if (block.transient)
+		{
+			const VkDeviceSize alignedOffset = alignUp(block.linearHead, alignment);
+			if (alignedOffset + size > block.size)
+			{
+				return false;
+			}
+
+			offset = alignedOffset;
+			block.linearHead = alignedOffset + size;
+			block.used += size;
+			return true;
+		}
+		else
+		{
+			// Best fit over the block's free ranges.
+			auto best = block.freeRanges.end();
+			VkDeviceSize bestLeftover = ~VkDeviceSize{ 0 };
+			for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it)
+			{
+				const VkDeviceSize alignedOffset = alignUp(it->first, alignment);
+				const VkDeviceSize rangeEnd = it->first + it->second;
+				if (alignedOffset + size <= rangeEnd && rangeEnd - alignedOffset - size < bestLeftover)
+				{
+					best = it;
+					bestLeftover = rangeEnd - alignedOffset - size;
+				}
+			}
+
+			if (best == block.freeRanges.end())
+			{
+				return false;
+			}
+
+			const VkDeviceSize rangeOffset = best->first;
+			const VkDeviceSize rangeEnd = best->first + best->second;
+			offset = alignUp(rangeOffset, alignment);
+			block.freeRanges.erase(best);
+
+			if (offset > rangeOffset)
+			{
+				block.freeRanges.emplace(rangeOffset, offset - rangeOffset);
+			}
+			if (offset + size < rangeEnd)
+			{
+				block.freeRanges.emplace(offset + size, rangeEnd - offset - size);
+			}
+		}
+
+		block.allocations.emplace(offset, Range{ size, alignment, userData });
+		block.used += size;
+		return true;
+	}
+
+	void ModelViewerAllocator::releaseRange(Block& block, VkDeviceSize offset, VkDeviceSize size)
+	{
+		block.allocations.erase(offset);
+		block.used -= size;
+
+		auto next = block.freeRanges.lower_bound(offset);
+		if (next != block.freeRanges.end() && next->first == offset + size)
+		{
+			size += next->second;
+			next = block.freeRanges.erase(next);
+		}
+		if (next != block.freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				size += previous->second;
+				block.freeRanges.erase(previous);
+			}
+		}
+		block.freeRanges.emplace(offset, size);
+	}
+
+	ModelViewerAllocation ModelViewerAllocator::makeAllocation(Block& block, VkDeviceSize offset, VkDeviceSize size) const
+	{
+		ModelViewerAllocation allocation{};
+		allocation.memory = block.memory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.mapped = block.mapped != nullptr ? block.mapped + offset : nullptr;
+		allocation.block = &block;
+		allocation.buffer = block.buffer;
+		return allocation;
+	}
+
+	ModelViewerAllocation ModelViewerAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+		ResourceKind kind, Strategy strategy, void* userData)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+		const VkDeviceSize blockSize = preferredBlockSize(memoryType);
+		const VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+		if (strategy == Strategy::Dedicated || requirements.size > blockSize / 2)
+		{
+			Block* block = createBlock(memoryType, requirements.size, kind, Strategy::Dedicated);
+			block->allocations.emplace(0, Range{ requirements.size, alignment, userData });
+			block->used = requirements.size;
+			return makeAllocation(*block, 0, requirements.size);
+		}
+
+		auto& blocks = pools[PoolKey{ memoryType, kind }];
+
+		VkDeviceSize offset = 0;
+		for (auto& block : blocks)
+		{
+			if (allocateFromBlock(*block, requirements.size, alignment, userData, offset))
+			{
+				return makeAllocation(*block, offset, requirements.size);
+			}
+		}
+
+		Block* block = createBlock(memoryType, std::max(blockSize, requirements.size), kind, strategy);
+		allocateFromBlock(*block, requirements.size, alignment, userData, offset);
+		return makeAllocation(*block, offset, requirements.size);
+	}
+
+	void ModelViewerAllocator::free(ModelViewerAllocation& allocation)
+	{
+		if (allocation.block == nullptr)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		// Transient memory is only handed back by resetTransient(), which may already have
+		// reused this range.
+		Block* block = static_cast<Block*>(allocation.block);
+		if (block->transient)
+		{
+			allocation = {};
+			return;
+		}
+
+		switch (block->strategy)
+		{
+		case Strategy::Dedicated:
+		{
+			destroyBlock(block);
+			auto it = std::find_if(dedicatedBlocks.begin(), dedicatedBlocks.end(), [&](const auto& b) { return b.get() == block; });
+			dedicatedBlocks.erase(it);
+			break;
+		}
+		case Strategy::Default:
+		{
+			releaseRange(*block, allocation.offset, allocation.size);
+
+			// Keep one empty block per pool around so that a load/unload cycle does not
+			// bounce between vkAllocateMemory and vkFreeMemory.
+			if (block->used == 0)
+			{
+				auto& blocks = pools[PoolKey{ block->memoryType, block->kind }];
+				const bool hasOtherEmptyBlock = std::any_of(blocks.begin(), blocks.end(),
+					[&](const auto& b) { return b.get() != block && b->used == 0; });
+				if (hasOtherEmptyBlock)
+				{
+					destroyBlock(block);
+					blocks.erase(std::find_if(blocks.begin(), blocks.end(), [&](const auto& b) { return b.get() == block; }));
+				}
+			}
+			break;
+		}
+		}
+
+		allocation = {};
+	}
+
+	ModelViewerAllocation ModelViewerAllocator::allocateTransient(VkDeviceSize size, VkDeviceSize alignment, VkMemoryPropertyFlags properties)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		if (transientPools.size() <= transientFrame)
+		{
+			transientPools.resize(transientFrame + 1);
+		}
+		alignment = std::max<VkDeviceSize>(alignment, 1);
+
+		VkDeviceSize offset = 0;
+		for (auto& block : transientPools[transientFrame][properties])
+		{
+			if (allocateFromBlock(*block, size, alignment, nullptr, offset))
+			{
+				return makeAllocation(*block, offset, size);
+			}
+		}
+
+		Block* block = createTransientBlock(std::max(kTransientBlockSize, size), properties);
+		allocateFromBlock(*block, size, alignment, nullptr, offset);
+		return makeAllocation(*block, offset, size);
+	}
+
+	void ModelViewerAllocator::resetTransient(uint32_t frameIndex)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		transientFrame = frameIndex;
+		if (transientPools.size() <= frameIndex)
+		{
+			transientPools.resize(frameIndex + 1);
+		}
+
+		for (auto& [key, blocks] : transientPools[frameIndex])
+		{
+			for (auto& block : blocks)
+			{
+				block->used = 0;
+				block->linearHead = 0;
+			}
+		}
+	}
+
+	std::vector<ModelViewerAllocator::DefragmentationMove> ModelViewerAllocator::planDefragmentation(VkDeviceSize maxBytes)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		std::vector<DefragmentationMove> moves;
+		VkDeviceSize plannedBytes = 0;
+
+		for (auto& [key, blocks] : pools)
+		{
+			if (blocks.size() < 2)
+			{
+				continue;
+			}
+
+			auto source = std::min_element(blocks.begin(), blocks.end(), [](const auto& a, const auto& b)
+			{
+				const VkDeviceSize usedA = a->used == 0 ? ~VkDeviceSize{ 0 } : a->used;
+				const VkDeviceSize usedB = b->used == 0 ? ~VkDeviceSize{ 0 } : b->used;
+				return usedA < usedB;
+			});
+			Block& sourceBlock = **source;
+			if (sourceBlock.used == 0)
+			{
+				continue;
+			}
+
+			// Destinations are reserved while planning so that moves never overlap, and handed
+			// back below; copying the map keeps the iteration clear of those reservations.
+			const std::map<VkDeviceSize, Range> sourceAllocations = sourceBlock.allocations;
+			for (const auto& [offset, range] : sourceAllocations)
+			{
+				if (range.userData == nullptr)
+				{
+					continue;
+				}
+				if (plannedBytes + range.size > maxBytes)
+				{
+					break;
+				}
+
+				for (auto& target : blocks)
+				{
+					VkDeviceSize targetOffset = 0;
+					if (target.get() != &sourceBlock && allocateFromBlock(*target, range.size, range.alignment, range.userData, targetOffset))
+					{
+						moves.push_back({ makeAllocation(sourceBlock, offset, range.size), makeAllocation(*target, targetOffset, range.size), range.userData });
+						plannedBytes += range.size;
+						break;
+					}
+				}
+			}
+		}
+
+		for (const DefragmentationMove& move : moves)
+		{
+			releaseRange(*static_cast<Block*>(move.destination.block), move.destination.offset, move.destination.size);
+		}
+		return moves;
+	}
+
+	ModelViewerAllocation ModelViewerAllocator::claimDestination(const DefragmentationMove& move)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		// The block may have been released since planning, and the range taken.
+		Block* block = static_cast<Block*>(move.destination.block);
+		if (!ownsBlock(block))
+		{
+			return {};
+		}
+
+		// Moves out of released source ranges have nothing left to carry over.
+		Block* sourceBlock = static_cast<Block*>(move.source.block);
+		if (!ownsBlock(sourceBlock))
+		{
+			return {};
+		}
+		auto source = sourceBlock->allocations.find(move.source.offset);
+		if (source == sourceBlock->allocations.end())
+		{
+			return {};
+		}
+
+		const VkDeviceSize offset = move.destination.offset;
+		const VkDeviceSize size = move.destination.size;
+		auto range = block->freeRanges.upper_bound(offset);
+		if (range == block->freeRanges.begin())
+		{
+			return {};
+		}
+		--range;
+		const VkDeviceSize rangeOffset = range->first;
+		const VkDeviceSize rangeEnd = range->first + range->second;
+		if (offset + size > rangeEnd)
+		{
+			return {};
+		}
+
+		block->freeRanges.erase(range);
+		if (offset > rangeOffset)
+		{
+			block->freeRanges.emplace(rangeOffset, offset - rangeOffset);
+		}
+		if (offset + size < rangeEnd)
+		{
+			block->freeRanges.emplace(offset + size, rangeEnd - offset - size);
+		}
+
+		block->allocations.emplace(offset, Range{ size, source->second.alignment, move.userData });
+		block->used += size;
+		return makeAllocation(*block, offset, size);
+	}
+
+	bool ModelViewerAllocator::ownsBlock(const Block* block) const
+	{
+		for (const auto& [key, blocks] : pools)
+		{
+			if (std::any_of(blocks.begin(), blocks.end(), [&](const auto& b) { return b.get() == block; }))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	ModelViewerAllocator::Stats ModelViewerAllocator::stats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Stats stats{};
+		for (const auto& [key, blocks] : pools)
+		{
+			for (const auto& block : blocks)
+			{
+				stats.blockCount++;
+				stats.allocationCount += static_cast<uint32_t>(block->allocations.size());
+				stats.bytesAllocated += block->size;
+				stats.bytesUsed += block->used;
+				for (const auto& [offset, size] : block->freeRanges)
+				{
+					stats.bytesFree += size;
+					stats.largestFreeRange = std::max(stats.largestFreeRange, size);
+					stats.freeRangeCount++;
+				}
+			}
+		}
+
+		for (const auto& framePools : transientPools)
+		{
+			for (const auto& [key, blocks] : framePools)
+			{
+				for (const auto& block : blocks)
+				{
+					stats.blockCount++;
+					stats.bytesAllocated += block->size;
+					stats.bytesUsed += block->used;
+					stats.bytesFree += block->size - block->linearHead;
+					stats.largestFreeRange = std::max(stats.largestFreeRange, block->size - block->linearHead);
+					stats.freeRangeCount++;
+				}
+			}
+		}
+
+		for (const auto& block : dedicatedBlocks)
+		{
+			stats.dedicatedCount++;
+			stats.allocationCount++;
+			stats.bytesAllocated += block->size;
+			stats.bytesUsed += block->used;
+		}
+
+		return stats;
+	}
+} // namespace ModelViewer
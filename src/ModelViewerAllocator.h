@@ -0,0 +1,152 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Sub-allocated range of device memory. Host-visible blocks are persistently mapped,
+	// in which case mapped points at the start of this range. Transient allocations are a
+	// range of their block's buffer, which spans the whole block, so offset is also the
+	// offset to bind that buffer at.
+	struct ModelViewerAllocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		void* block = nullptr;
+		VkBuffer buffer = VK_NULL_HANDLE;
+	};
+
+	// Block based GPU memory sub-allocator. Resources are placed into large blocks from
+	// per memory type pools instead of one vkAllocateMemory per resource, which keeps us far
+	// below maxMemoryAllocationCount. Buffers and optimally tiled images use separate pools
+	// so bufferImageGranularity never has to be padded for.
+	class ModelViewerAllocator
+	{
+	public:
+		enum class ResourceKind
+		{
+			Linear,
+			Optimal,
+		};
+
+		enum class Strategy
+		{
+			Default,
+			Dedicated,
+		};
+
+		struct Stats
+		{
+			uint32_t blockCount = 0;
+			uint32_t dedicatedCount = 0;
+			uint32_t allocationCount = 0;
+			VkDeviceSize bytesAllocated = 0;
+			VkDeviceSize bytesUsed = 0;
+			VkDeviceSize bytesFree = 0;
+			VkDeviceSize largestFreeRange = 0;
+			uint32_t freeRangeCount = 0;
+
+			// 0 when all free space is one contiguous range, approaching 1 as it splinters.
+			double fragmentation() const { return bytesFree ? 1.0 - static_cast<double>(largestFreeRange) / bytesFree : 0.0; }
+		};
+
+		// A proposed relocation out of a sparsely used block. Nothing is reserved by planning:
+		// the owner of the source claims the destination with claimDestination(), recreates
+		// its resource there, copies the contents and frees the source.
+		struct DefragmentationMove
+		{
+			ModelViewerAllocation source;
+			ModelViewerAllocation destination;
+			void* userData;
+		};
+
+		ModelViewerAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+		~ModelViewerAllocator();
+
+		ModelViewerAllocator(const ModelViewerAllocator&) = delete;
+		ModelViewerAllocator& operator=(const ModelViewerAllocator&) = delete;
+
+		ModelViewerAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+			ResourceKind kind, Strategy strategy = Strategy::Default, void* userData = nullptr);
+		void free(ModelViewerAllocation& allocation);
+
+		// Render thread only. Bump allocates a range of the buffer of one of the linear blocks
+		// of the frame slot last passed to resetTransient(). The blocks and their buffers
+		// persist and are only added to when a frame needs more, so frames with the same
+		// allocations get the same buffers and offsets. Never freed.
+		ModelViewerAllocation allocateTransient(VkDeviceSize size, VkDeviceSize alignment, VkMemoryPropertyFlags properties);
+		// Called once the fence of frameIndex's slot has signalled, so nothing recorded while
+		// the slot was last in use still reads its transient ranges: they are all released at
+		// once, and allocateTransient() hands them out again until the next call.
+		void resetTransient(uint32_t frameIndex);
+
+		// Plans moves that empty the least occupied block of each pool, up to maxBytes. Only
+		// allocations made with userData have an owner that can move them, so only those
+		// are planned.
+		std::vector<DefragmentationMove> planDefragmentation(VkDeviceSize maxBytes);
+		// Reserves a planned move's destination. Returns an allocation without a block if
+		// the range has been taken since the move was planned.
+		ModelViewerAllocation claimDestination(const DefragmentationMove& move);
+
+		Stats stats() const;
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	private:
+		struct Range
+		{
+			VkDeviceSize size;
+			VkDeviceSize alignment;
+			void* userData;
+		};
+
+		struct Block
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			char* mapped = nullptr;
+			uint32_t memoryType = 0;
+			ResourceKind kind = ResourceKind::Linear;
+			Strategy strategy = Strategy::Default;
+			VkDeviceSize used = 0;
+			VkDeviceSize linearHead = 0;
+			std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+			// Transient blocks only track used and linearHead.
+			std::map<VkDeviceSize, Range> allocations;
+			bool transient = false;
+			// Transient blocks only, bound over the whole block.
+			VkBuffer buffer = VK_NULL_HANDLE;
+		};
+
+		using PoolKey = std::pair<uint32_t, ResourceKind>;
+
+		Block* createBlock(uint32_t memoryType, VkDeviceSize size, ResourceKind kind, Strategy strategy);
+		Block* createTransientBlock(VkDeviceSize size, VkMemoryPropertyFlags properties);
+		void allocateMemory(Block& block, VkDeviceSize size);
+		void destroyBlock(Block* block);
+		bool allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, void* userData, VkDeviceSize& offset);
+		// Returns [offset, offset + size) of a default block to its free ranges.
+		void releaseRange(Block& block, VkDeviceSize offset, VkDeviceSize size);
+		bool ownsBlock(const Block* block) const;
+		ModelViewerAllocation makeAllocation(Block& block, VkDeviceSize offset, VkDeviceSize size) const;
+		VkDeviceSize preferredBlockSize(uint32_t memoryType) const;
+
+		VkDevice device;
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+		mutable std::mutex mutex;
+		std::map<PoolKey, std::vector<std::unique_ptr<Block>>> pools;
+		// Per frame slot, indexed by resetTransient()'s frameIndex, then by the requested
+		// memory properties.
+		std::vector<std::map<VkMemoryPropertyFlags, std::vector<std::unique_ptr<Block>>>> transientPools;
+		uint32_t transientFrame = 0;
+		std::vector<std::unique_ptr<Block>> dedicatedBlocks;
+	};
+} // namespace ModelViewer
@@ -0,0 +1,37 @@
+#include "ModelViewerComputePipeline.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace ModelViewer
+{
+	ModelViewerComputePipeline::ModelViewerComputePipeline(ModelViewerDevice& device, const std::string& compShader, VkPipelineLayout pipelineLayout) : modelViewerDevice{ device }
+	{
+		assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline:: no pipelineLayout provided");
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = modelViewerDevice.getShaderRegistry().getModule(compShader);
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(modelViewerDevice.device(), modelViewerDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create compute pipeline!");
+		}
+	}
+
+	ModelViewerComputePipeline::~ModelViewerComputePipeline()
+	{
+		vkDestroyPipeline(modelViewerDevice.device(), computePipeline, nullptr);
+	}
+
+	void ModelViewerComputePipeline::bind(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+	}
+} // namespace ModelViewer
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ModelViewerDevice.h"
+
+#include <string>
+
+namespace ModelViewer
+{
+	class ModelViewerComputePipeline
+	{
+	public:
+		// compShader is named as in the device's shader registry, e.g. "cull.comp".
+		ModelViewerComputePipeline(ModelViewerDevice& device, const std::string& compShader, VkPipelineLayout pipelineLayout);
+		~ModelViewerComputePipeline();
+
+		ModelViewerComputePipeline(const ModelViewerComputePipeline&) = delete;
+		ModelViewerComputePipeline& operator=(const ModelViewerComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer);
+
+	private:
+		ModelViewerDevice& modelViewerDevice;
+		VkPipeline computePipeline = VK_NULL_HANDLE;
+	};
+} // namespace ModelViewer
@@ -0,0 +1,63 @@
+#include "ModelViewerDeletionQueue.h"
+
+#include <utility>
+#include <vector>
+
+namespace ModelViewer
+{
+	ModelViewerDeletionQueue::~ModelViewerDeletionQueue()
+	{
+		flush();
+	}
+
+	void ModelViewerDeletionQueue::push(std::function<void()> destroy)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		deletions.push_back({ recordingFrame, std::move(destroy) });
+	}
+
+	void ModelViewerDeletionQueue::setRecordingFrame(uint64_t frame)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		recordingFrame = frame;
+	}
+
+	void ModelViewerDeletionQueue::retire(uint64_t completedFrame)
+	{
+		// The destroy calls run outside the lock; they may take other locks or queue more.
+		std::vector<std::function<void()>> ready;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			while (!deletions.empty() && deletions.front().frame <= completedFrame)
+			{
+				ready.push_back(std::move(deletions.front().destroy));
+				deletions.pop_front();
+			}
+		}
+
+		for (auto& destroy : ready)
+		{
+			destroy();
+		}
+	}
+
+	void ModelViewerDeletionQueue::flush()
+	{
+		std::deque<Deletion> pending;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			pending.swap(deletions);
+		}
+
+		for (Deletion& deletion : pending)
+		{
+			deletion.destroy();
+		}
+	}
+
+	size_t ModelViewerDeletionQueue::size() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return deletions.size();
+	}
+} // namespace ModelViewer
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace ModelViewer
+{
+	// Defers destroying GPU resources until no submitted frame can still be using them.
+	// Each deletion is tagged with the frame being recorded when it was queued and runs once
+	// the renderer reports that frame as complete, so releasing a resource mid-frame never
+	// needs vkDeviceWaitIdle. Deletions may be queued from any thread.
+	class ModelViewerDeletionQueue
+	{
+	public:
+		ModelViewerDeletionQueue() = default;
+		~ModelViewerDeletionQueue();
+
+		ModelViewerDeletionQueue(const ModelViewerDeletionQueue&) = delete;
+		ModelViewerDeletionQueue& operator=(const ModelViewerDeletionQueue&) = delete;
+
+		void push(std::function<void()> destroy);
+
+		// Frames are numbered from 1; later pushes are tagged with frame.
+		void setRecordingFrame(uint64_t frame);
+		// Runs every deletion tagged with a frame up to and including completedFrame.
+		void retire(uint64_t completedFrame);
+		// Runs every pending deletion. Only valid while the device is idle.
+		void flush();
+
+		size_t size() const;
+
+	private:
+		struct Deletion
+		{
+			uint64_t frame;
+			std::function<void()> destroy;
+		};
+
+		mutable std::mutex mutex;
+		// Tags only ever grow, so the oldest deletions are always at the front.
+		std::deque<Deletion> deletions;
+		uint64_t recordingFrame = 1;
+	};
+} // namespace ModelViewer
@@ -1,6 +1,8 @@
 #include "ModelViewerDevice.h"
+#include "ModelViewerResidencyManager.h"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -60,12 +62,27 @@ namespace ModelViewer {
 		setupDebugMessenger();
 		createSurface();
 		pickPhysicalDevice();
+		queryCapabilities();
 		createLogicalDevice();
 		createCommandPool();
+		createPipelineCache();
+		createShaderRegistry();
+		createStagingRing();
+		createGeometryPool();
+		createResidencyManager();
 	}
 
 	ModelViewerDevice::~ModelViewerDevice() 
 	{
+		// Deferred deletions still reference the pool and the allocator.
+		deletionQueue.flush();
+		residencyManager.reset();
+		geometryPool.reset();
+		stagingRing.reset();
+		allocator.reset();
+		// Saved here, after every pipeline using it was destroyed.
+		pipelineCache_.reset();
+		shaderRegistry.reset();
 		vkDestroyCommandPool(device_, commandPool, nullptr);
 		vkDestroyDevice(device_, nullptr);
 
@@ -91,7 +108,16 @@ namespace ModelViewer {
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+
+		// vkEnumerateInstanceVersion is missing from 1.0 loaders, so look it up instead of linking it.
+		auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+			nullptr,
+			"vkEnumerateInstanceVersion");
+		if (enumerateInstanceVersion != nullptr && enumerateInstanceVersion(&instanceApiVersion) == VK_SUCCESS)
+		{
+			instanceApiVersion = std::min(instanceApiVersion, VK_API_VERSION_1_2);
+		}
+		appInfo.apiVersion = instanceApiVersion;
 
 		VkInstanceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -160,6 +186,13 @@ namespace ModelViewer {
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+		// Without timeline semaphores the render loop could not tell when a transfer queue
+		// upload finished, so uploads stay on the graphics queue.
+		const bool useTransferQueue = indices.transferFamilyHasValue && capabilities.timelineSemaphore;
+		if (useTransferQueue)
+		{
+			uniqueQueueFamilies.insert(indices.transferFamily);
+		}
 
 		float queuePriority = 1.0f;
 		for (uint32_t queueFamily : uniqueQueueFamilies) 
@@ -172,8 +205,34 @@ namespace ModelViewer {
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
-		VkPhysicalDeviceFeatures deviceFeatures = {};
-		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		VkPhysicalDeviceFeatures2 deviceFeatures = {};
+		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.features.multiDrawIndirect = capabilities.multiDrawIndirect;
+		deviceFeatures.features.drawIndirectFirstInstance = capabilities.drawIndirectFirstInstance;
+		deviceFeatures.features.fillModeNonSolid = capabilities.fillModeNonSolid;
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+		vulkan12Features.drawIndirectCount = capabilities.drawIndirectCount;
+		vulkan12Features.timelineSemaphore = capabilities.timelineSemaphore;
+
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+		presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+		presentWaitFeatures.presentWait = VK_TRUE;
+
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+		presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+		presentIdFeatures.pNext = &presentWaitFeatures;
+		presentIdFeatures.presentId = VK_TRUE;
+
+		std::vector<const char*> extensions = deviceExtensions;
+		if (capabilities.presentWait)
+		{
+			extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+			vulkan12Features.pNext = &presentIdFeatures;
+		}
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -181,9 +240,19 @@ namespace ModelViewer {
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		// Vulkan 1.2 features can only be enabled through the VkPhysicalDeviceFeatures2 chain.
+		if (capabilities.apiVersion >= VK_API_VERSION_1_2)
+		{
+			deviceFeatures.pNext = &vulkan12Features;
+			createInfo.pNext = &deviceFeatures;
+			createInfo.pEnabledFeatures = nullptr;
+		}
+		else
+		{
+			createInfo.pEnabledFeatures = &deviceFeatures.features;
+		}
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
 
 		// might not really be necessary anymore because device specific validation layers
 		// have been deprecated
@@ -204,6 +273,66 @@ namespace ModelViewer {
 
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+		if (useTransferQueue)
+		{
+			vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+			std::cout << "Uploading through transfer queue family " << indices.transferFamily << std::endl;
+		}
+		if (capabilities.presentWait)
+		{
+			vkWaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR");
+			capabilities.presentWait = vkWaitForPresent != nullptr;
+		}
+
+		allocator = std::make_unique<ModelViewerAllocator>(physicalDevice, device_);
+	}
+
+	void ModelViewerDevice::queryCapabilities()
+	{
+		capabilities.apiVersion = std::min(instanceApiVersion, properties.apiVersion);
+
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		capabilities.multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+		capabilities.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+		capabilities.fillModeNonSolid = supportedFeatures.fillModeNonSolid == VK_TRUE;
+
+		if (capabilities.apiVersion >= VK_API_VERSION_1_2)
+		{
+			VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+			vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+
+			VkPhysicalDeviceFeatures2 features2 = {};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &vulkan12Features;
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+			capabilities.drawIndirectCount = vulkan12Features.drawIndirectCount == VK_TRUE;
+			capabilities.timelineSemaphore = vulkan12Features.timelineSemaphore == VK_TRUE;
+
+			// Present wait names the presents it waits for by their present ids.
+			if (isDeviceExtensionAvailable(VK_KHR_PRESENT_ID_EXTENSION_NAME) && isDeviceExtensionAvailable(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+			{
+				VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+				presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+				VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+				presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+				presentIdFeatures.pNext = &presentWaitFeatures;
+
+				features2.pNext = &presentIdFeatures;
+				vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+				capabilities.presentWait = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+			}
+		}
+
+		std::cout << "Vulkan " << VK_API_VERSION_MAJOR(capabilities.apiVersion) << "." << VK_API_VERSION_MINOR(capabilities.apiVersion)
+			<< ", multiDrawIndirect: " << capabilities.multiDrawIndirect
+			<< ", drawIndirectFirstInstance: " << capabilities.drawIndirectFirstInstance
+			<< ", drawIndirectCount: " << capabilities.drawIndirectCount
+			<< ", timelineSemaphore: " << capabilities.timelineSemaphore
+			<< ", presentWait: " << capabilities.presentWait << std::endl;
 	}
 
 	void ModelViewerDevice::createCommandPool() 
@@ -222,6 +351,32 @@ namespace ModelViewer {
 		}
 	}
 
+	void ModelViewerDevice::createPipelineCache()
+	{
+		pipelineCache_ = std::make_unique<ModelViewerPipelineCache>(device_, properties);
+	}
+
+	void ModelViewerDevice::createShaderRegistry()
+	{
+		shaderRegistry = std::make_unique<ModelViewerShaderRegistry>(device_);
+	}
+
+	void ModelViewerDevice::createStagingRing()
+	{
+		stagingRing = std::make_unique<ModelViewerStagingRing>(*this);
+	}
+
+	void ModelViewerDevice::createGeometryPool()
+	{
+		geometryPool = std::make_unique<ModelViewerGeometryPool>(*this);
+	}
+
+	void ModelViewerDevice::createResidencyManager()
+	{
+		// The slot pool is only allocated once a streamed model registers its pages.
+		residencyManager = std::make_unique<ModelViewerResidencyManager>(*this);
+	}
+
 	void ModelViewerDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
 	bool ModelViewerDevice::isDeviceSuitable(VkPhysicalDevice device) 
@@ -363,6 +518,24 @@ namespace ModelViewer {
 		return requiredExtensions.empty();
 	}
 
+	bool ModelViewerDevice::isDeviceExtensionAvailable(const char* extensionName)
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+		for (const auto& extension : availableExtensions)
+		{
+			if (std::strcmp(extension.extensionName, extensionName) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	QueueFamilyIndices ModelViewerDevice::findQueueFamilies(VkPhysicalDevice device) 
 	{
 		QueueFamilyIndices indices;
@@ -396,6 +569,19 @@ namespace ModelViewer {
 			i++;
 		}
 
+		// Families without graphics or compute are the copy engines, which run uploads
+		// alongside the frames instead of between them.
+		for (uint32_t family = 0; family < queueFamilyCount; family++)
+		{
+			const VkQueueFlags flags = queueFamilies[family].queueFlags;
+			if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			{
+				indices.transferFamily = family;
+				indices.transferFamilyHasValue = true;
+				break;
+			}
+		}
+
 		return indices;
 	}
 
@@ -471,7 +657,9 @@ namespace ModelViewer {
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer& buffer,
-		VkDeviceMemory& bufferMemory) 
+		ModelViewerAllocation& bufferAllocation,
+		ModelViewerAllocator::Strategy strategy,
+		void* userData)
 	{
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -486,16 +674,47 @@ namespace ModelViewer {
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		bufferAllocation = allocator->allocate(memRequirements, properties, ModelViewerAllocator::ResourceKind::Linear, strategy, userData);
+
+		vkBindBufferMemory(device_, buffer, bufferAllocation.memory, bufferAllocation.offset);
+	}
+
+	void ModelViewerDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const ModelViewerAllocation& allocation, VkBuffer& buffer)
+	{
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to allocate vertex buffer memory!");
+		if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create buffer!");
 		}
 
-		vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+		vkBindBufferMemory(device_, buffer, allocation.memory, allocation.offset);
+	}
+
+	void ModelViewerDevice::destroyBuffer(VkBuffer& buffer, ModelViewerAllocation& bufferAllocation)
+	{
+		vkDestroyBuffer(device_, buffer, nullptr);
+		allocator->free(bufferAllocation);
+		buffer = VK_NULL_HANDLE;
+	}
+
+	void ModelViewerDevice::deferDestroyBuffer(VkBuffer& buffer, ModelViewerAllocation& bufferAllocation)
+	{
+		deletionQueue.push([this, buffer, bufferAllocation]() mutable { destroyBuffer(buffer, bufferAllocation); });
+		buffer = VK_NULL_HANDLE;
+		bufferAllocation = {};
+	}
+
+	void ModelViewerDevice::waitIdle()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ queueMutex };
+			vkDeviceWaitIdle(device_);
+		}
+		deletionQueue.flush();
 	}
 
 	VkCommandBuffer ModelViewerDevice::beginSingleTimeCommands() 
@@ -526,8 +745,11 @@ namespace ModelViewer {
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
-		vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue_);
+		{
+			std::lock_guard<std::mutex> lock{ queueMutex };
+			vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+			vkQueueWaitIdle(graphicsQueue_);
+		}
 
 		vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 	}
@@ -545,6 +767,16 @@ namespace ModelViewer {
 		endSingleTimeCommands(commandBuffer);
 	}
 
+	void ModelViewerDevice::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+	{
+		stagingRing->upload(dstBuffer, dstOffset, data, size);
+	}
+
+	void ModelViewerDevice::uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void* data, VkDeviceSize size)
+	{
+		stagingRing->uploadImage(image, width, height, layerCount, data, size);
+	}
+
 	void ModelViewerDevice::copyBufferToImage(
 		VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) 
 	{
@@ -577,7 +809,7 @@ namespace ModelViewer {
 		const VkImageCreateInfo& imageInfo,
 		VkMemoryPropertyFlags properties,
 		VkImage& image,
-		VkDeviceMemory& imageMemory) {
+		ModelViewerAllocation& imageAllocation) {
 		if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create image!");
@@ -586,20 +818,22 @@ namespace ModelViewer {
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		const ModelViewerAllocator::ResourceKind kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL
+			? ModelViewerAllocator::ResourceKind::Optimal
+			: ModelViewerAllocator::ResourceKind::Linear;
+		imageAllocation = allocator->allocate(memRequirements, properties, kind);
 
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to allocate image memory!");
-		}
-
-		if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) 
+		if (vkBindImageMemory(device_, image, imageAllocation.memory, imageAllocation.offset) != VK_SUCCESS) 
 		{
 			throw std::runtime_error("failed to bind image memory!");
 		}
 	}
 
+	void ModelViewerDevice::destroyImage(VkImage& image, ModelViewerAllocation& imageAllocation)
+	{
+		vkDestroyImage(device_, image, nullptr);
+		allocator->free(imageAllocation);
+		image = VK_NULL_HANDLE;
+	}
+
 }  // namespace ModelViewer
\ No newline at end of file
@@ -1,8 +1,16 @@
 #pragma once
 
 #include "ModelViewerWindow.h"
+#include "ModelViewerAllocator.h"
+#include "ModelViewerDeletionQueue.h"
+#include "ModelViewerGeometryPool.h"
+#include "ModelViewerPipelineCache.h"
+#include "ModelViewerShaderRegistry.h"
+#include "ModelViewerStagingRing.h"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -17,11 +25,29 @@ namespace ModelViewer {
 	struct QueueFamilyIndices {
 		uint32_t graphicsFamily;
 		uint32_t presentFamily;
+		// A family that only does transfers, usually the GPU's copy engines. Optional.
+		uint32_t transferFamily;
 		bool graphicsFamilyHasValue = false;
 		bool presentFamilyHasValue = false;
+		bool transferFamilyHasValue = false;
 		bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 	};
 
+	// Optional features the renderers can take advantage of, filled in when the device is
+	// picked. Vulkan 1.2 is used when both the loader and the device support it.
+	struct DeviceCapabilities {
+		uint32_t apiVersion = VK_API_VERSION_1_0;
+		bool multiDrawIndirect = false;
+		bool drawIndirectFirstInstance = false;
+		bool fillModeNonSolid = false;
+		bool drawIndirectCount = false;
+		bool timelineSemaphore = false;
+		// VK_KHR_present_id and VK_KHR_present_wait, for frame pacing and latency.
+		bool presentWait = false;
+	};
+
+	class ModelViewerResidencyManager;
+
 	class ModelViewerDevice {
 	public:
 #ifdef NDEBUG
@@ -44,9 +70,27 @@ namespace ModelViewer {
 		VkSurfaceKHR surface() { return surface_; }
 		VkQueue graphicsQueue() { return graphicsQueue_; }
 		VkQueue presentQueue() { return presentQueue_; }
+		// The dedicated upload queue, or VK_NULL_HANDLE when uploads go through the graphics
+		// queue. Only used when timeline semaphores can synchronize it with the frames.
+		VkQueue transferQueue() { return transferQueue_; }
+		// Shared by every pipeline and persisted across runs.
+		VkPipelineCache pipelineCache() { return pipelineCache_->handle(); }
+		// Shader modules shared by every pipeline.
+		ModelViewerShaderRegistry& getShaderRegistry() { return *shaderRegistry; }
+
+		// Loader threads submit uploads while the render loop submits frames, so every queue
+		// submit, present and device-wide wait must hold this lock.
+		std::unique_lock<std::mutex> lockQueue() { return std::unique_lock<std::mutex>{ queueMutex }; }
+		// Also runs every deferred deletion, since nothing can be in use afterwards.
+		void waitIdle();
 		VkInstance getInstance() { return instance; }
 		ModelViewerWindow& getWindow() { return window; }
 		VkPhysicalDevice getPhysicalDevice(){ return physicalDevice; }
+		ModelViewerAllocator& getAllocator() { return *allocator; }
+		ModelViewerGeometryPool& getGeometryPool() { return *geometryPool; }
+		ModelViewerResidencyManager& getResidencyManager() { return *residencyManager; }
+		ModelViewerDeletionQueue& getDeletionQueue() { return deletionQueue; }
+		const DeviceCapabilities& getCapabilities() const { return capabilities; }
 
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -55,15 +99,47 @@ namespace ModelViewer {
 			const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
 		// Buffer Helper Functions
+		// Memory comes from the device allocator; release it with destroyBuffer/destroyImage.
 		void createBuffer(
 			VkDeviceSize size,
 			VkBufferUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkBuffer& buffer,
-			VkDeviceMemory& bufferMemory);
+			ModelViewerAllocation& bufferAllocation,
+			ModelViewerAllocator::Strategy strategy = ModelViewerAllocator::Strategy::Default,
+			void* userData = nullptr);
+		// Creates a buffer in memory the caller already holds, such as a claimed
+		// defragmentation destination.
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const ModelViewerAllocation& allocation, VkBuffer& buffer);
+		void destroyBuffer(VkBuffer& buffer, ModelViewerAllocation& bufferAllocation);
+		// Destroys the buffer once every frame that may still read it has completed.
+		void deferDestroyBuffer(VkBuffer& buffer, ModelViewerAllocation& bufferAllocation);
 		VkCommandBuffer beginSingleTimeCommands();
 		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+
+		// Staged uploads through the persistent staging ring. The copy is only submitted
+		// by flushUploads(), which the renderer calls before every frame submission.
+		void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+		void uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void* data, VkDeviceSize size);
+		void flushUploads() { stagingRing->flush(); }
+		// Render thread only. Blocks until every upload queued so far has landed and is
+		// visible to the graphics queue.
+		void waitForUploads()
+		{
+			stagingRing->waitIdle();
+			stagingRing->flush();
+		}
+		// Loader threads submit their uploads themselves so they start right away, and wait
+		// for isUploadReady() before handing the results to the render loop.
+		uint64_t submitUploads() { return stagingRing->submit(); }
+		bool isUploadReady(uint64_t ticket) { return stagingRing->isReady(ticket); }
+
+		// vkWaitForPresentKHR; requires capabilities.presentWait.
+		VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout)
+		{
+			return vkWaitForPresent(device_, swapChain, presentId, timeout);
+		}
 		void copyBufferToImage(
 			VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -71,7 +147,8 @@ namespace ModelViewer {
 			const VkImageCreateInfo& imageInfo,
 			VkMemoryPropertyFlags properties,
 			VkImage& image,
-			VkDeviceMemory& imageMemory);
+			ModelViewerAllocation& imageAllocation);
+		void destroyImage(VkImage& image, ModelViewerAllocation& imageAllocation);
 
 		VkPhysicalDeviceProperties properties;
 
@@ -82,6 +159,12 @@ namespace ModelViewer {
 		void pickPhysicalDevice();
 		void createLogicalDevice();
 		void createCommandPool();
+		void createPipelineCache();
+		void createShaderRegistry();
+		void createStagingRing();
+		void createGeometryPool();
+		void createResidencyManager();
+		void queryCapabilities();
 
 		// helper functions
 		bool isDeviceSuitable(VkPhysicalDevice device);
@@ -91,11 +174,14 @@ namespace ModelViewer {
 		void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 		void hasGflwRequiredInstanceExtensions();
 		bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+		bool isDeviceExtensionAvailable(const char* extensionName);
 		SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
 		VkInstance instance;
 		VkDebugUtilsMessengerEXT debugMessenger;
 		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+		uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+		DeviceCapabilities capabilities;
 		ModelViewerWindow& window;
 		VkCommandPool commandPool;
 
@@ -103,6 +189,17 @@ namespace ModelViewer {
 		VkSurfaceKHR surface_;
 		VkQueue graphicsQueue_;
 		VkQueue presentQueue_;
+		VkQueue transferQueue_ = VK_NULL_HANDLE;
+		std::mutex queueMutex;
+		PFN_vkWaitForPresentKHR vkWaitForPresent = nullptr;
+
+		std::unique_ptr<ModelViewerAllocator> allocator;
+		std::unique_ptr<ModelViewerPipelineCache> pipelineCache_;
+		std::unique_ptr<ModelViewerShaderRegistry> shaderRegistry;
+		ModelViewerDeletionQueue deletionQueue;
+		std::unique_ptr<ModelViewerStagingRing> stagingRing;
+		std::unique_ptr<ModelViewerGeometryPool> geometryPool;
+		std::unique_ptr<ModelViewerResidencyManager> residencyManager;
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
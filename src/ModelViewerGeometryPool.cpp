@@ -0,0 +1,339 @@
+#include "ModelViewerGeometryPool.h"
+#include "ModelViewerDevice.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		// Transfer source so that defragmentation can copy a page to its new memory.
+		constexpr VkBufferUsageFlags kVertexUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		constexpr VkBufferUsageFlags kIndexUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	}
+
+	void ModelViewerGeometryPool::RangeList::reset(uint32_t capacity)
+	{
+		freeRanges.clear();
+		freeRanges.emplace(0, capacity);
+	}
+
+	bool ModelViewerGeometryPool::RangeList::allocate(uint32_t count, uint32_t& offset)
+	{
+		for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+		{
+			if (it->second >= count)
+			{
+				offset = it->first;
+				const uint32_t remaining = it->second - count;
+				freeRanges.erase(it);
+				if (remaining > 0)
+				{
+					freeRanges.emplace(offset + count, remaining);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ModelViewerGeometryPool::RangeList::release(uint32_t offset, uint32_t count)
+	{
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.end() && next->first == offset + count)
+		{
+			count += next->second;
+			next = freeRanges.erase(next);
+		}
+		if (next != freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				count += previous->second;
+				freeRanges.erase(previous);
+			}
+		}
+		freeRanges.emplace(offset, count);
+	}
+
+	ModelViewerGeometryPool::ModelViewerGeometryPool(ModelViewerDevice& device) : device{ device }
+	{
+	}
+
+	ModelViewerGeometryPool::~ModelViewerGeometryPool()
+	{
+		for (auto& page : pages)
+		{
+			if (page)
+			{
+				destroyPage(*page);
+			}
+		}
+	}
+
+	uint32_t ModelViewerGeometryPool::createPage(uint32_t vertexStride, VkIndexType indexType, uint32_t vertexCapacity, uint32_t indexCapacity)
+	{
+		auto page = std::make_unique<Page>();
+		page->vertexStride = vertexStride;
+		page->indexType = indexType;
+		page->vertexCapacity = vertexCapacity;
+		page->indexCapacity = indexCapacity;
+		page->vertexRanges.reset(vertexCapacity);
+		page->indexRanges.reset(indexCapacity);
+
+		// The page is the allocations' user data, which lets defragment() find the buffer
+		// behind a planned move.
+		device.createBuffer(static_cast<VkDeviceSize>(vertexStride) * vertexCapacity,
+			kVertexUsage,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			page->vertexBuffer,
+			page->vertexAllocation,
+			ModelViewerAllocator::Strategy::Default,
+			page.get());
+
+		device.createBuffer(static_cast<VkDeviceSize>(indexSize(indexType)) * indexCapacity,
+			kIndexUsage,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			page->indexBuffer,
+			page->indexAllocation,
+			ModelViewerAllocator::Strategy::Default,
+			page.get());
+
+		auto slot = std::find(pages.begin(), pages.end(), nullptr);
+		if (slot != pages.end())
+		{
+			*slot = std::move(page);
+			return static_cast<uint32_t>(slot - pages.begin());
+		}
+
+		pages.push_back(std::move(page));
+		return static_cast<uint32_t>(pages.size() - 1);
+	}
+
+	void ModelViewerGeometryPool::destroyPage(Page& page)
+	{
+		device.destroyBuffer(page.vertexBuffer, page.vertexAllocation);
+		device.destroyBuffer(page.indexBuffer, page.indexAllocation);
+	}
+
+	ModelViewerGeometryPool::Range ModelViewerGeometryPool::allocate(uint32_t vertexStride, uint32_t vertexCount, uint32_t indexCount, VkIndexType indexType)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Range range{};
+		range.vertexCount = vertexCount;
+		range.indexCount = indexCount;
+
+		for (uint32_t i = 0; i < pages.size(); i++)
+		{
+			Page* page = pages[i].get();
+			if (page == nullptr || page->vertexStride != vertexStride || page->indexType != indexType
+				|| page->vertexCapacity - page->verticesUsed < vertexCount || page->indexCapacity - page->indicesUsed < indexCount)
+			{
+				continue;
+			}
+
+			if (!page->vertexRanges.allocate(vertexCount, range.vertexOffset))
+			{
+				continue;
+			}
+			if (!page->indexRanges.allocate(indexCount, range.firstIndex))
+			{
+				page->vertexRanges.release(range.vertexOffset, vertexCount);
+				continue;
+			}
+
+			range.page = i;
+			break;
+		}
+
+		if (!range.isValid())
+		{
+			range.page = createPage(vertexStride, indexType, std::max(vertexCount, DEFAULT_PAGE_VERTICES), std::max(indexCount, DEFAULT_PAGE_INDICES));
+			Page& page = *pages[range.page];
+			page.vertexRanges.allocate(vertexCount, range.vertexOffset);
+			page.indexRanges.allocate(indexCount, range.firstIndex);
+		}
+
+		Page& page = *pages[range.page];
+		page.verticesUsed += vertexCount;
+		page.indicesUsed += indexCount;
+		page.rangeCount++;
+		return range;
+	}
+
+	void ModelViewerGeometryPool::free(Range& range)
+	{
+		if (!range.isValid())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Page& page = *pages[range.page];
+		page.vertexRanges.release(range.vertexOffset, range.vertexCount);
+		page.indexRanges.release(range.firstIndex, range.indexCount);
+		page.verticesUsed -= range.vertexCount;
+		page.indicesUsed -= range.indexCount;
+		page.rangeCount--;
+
+		// Default sized pages are kept for reuse; oversized ones were created for a
+		// single large mesh and are released with it.
+		if (page.rangeCount == 0 && (page.vertexCapacity > DEFAULT_PAGE_VERTICES || page.indexCapacity > DEFAULT_PAGE_INDICES))
+		{
+			destroyPage(page);
+			pages[range.page].reset();
+		}
+
+		range = {};
+	}
+
+	void ModelViewerGeometryPool::upload(const Range& range, const void* vertices, const uint32_t* indices)
+	{
+		VkBuffer vertexBuffer;
+		VkBuffer indexBuffer;
+		uint32_t vertexStride;
+		VkIndexType indexType;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			const Page& page = *pages[range.page];
+			vertexBuffer = page.vertexBuffer;
+			indexBuffer = page.indexBuffer;
+			vertexStride = page.vertexStride;
+			indexType = page.indexType;
+			uploadsInProgress++;
+		}
+
+		device.uploadBuffer(vertexBuffer,
+			static_cast<VkDeviceSize>(range.vertexOffset) * vertexStride,
+			vertices,
+			static_cast<VkDeviceSize>(range.vertexCount) * vertexStride);
+
+		if (indexType == VK_INDEX_TYPE_UINT16)
+		{
+			// Truncation maps the 32-bit restart value onto the 16-bit one.
+			std::vector<uint16_t> narrowIndices(indices, indices + range.indexCount);
+			device.uploadBuffer(indexBuffer,
+				static_cast<VkDeviceSize>(range.firstIndex) * sizeof(uint16_t),
+				narrowIndices.data(),
+				static_cast<VkDeviceSize>(range.indexCount) * sizeof(uint16_t));
+		}
+		else
+		{
+			device.uploadBuffer(indexBuffer,
+				static_cast<VkDeviceSize>(range.firstIndex) * sizeof(uint32_t),
+				indices,
+				static_cast<VkDeviceSize>(range.indexCount) * sizeof(uint32_t));
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		uploadsInProgress--;
+	}
+
+	VkDeviceSize ModelViewerGeometryPool::defragment(VkDeviceSize maxBytes)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (uploadsInProgress != 0)
+		{
+			return 0;
+		}
+
+		ModelViewerAllocator& allocator = device.getAllocator();
+		std::vector<ModelViewerAllocator::DefragmentationMove> moves = allocator.planDefragmentation(maxBytes);
+		std::erase_if(moves, [this](const ModelViewerAllocator::DefragmentationMove& move)
+			{
+				return std::none_of(pages.begin(), pages.end(), [&](const auto& page) { return page.get() == move.userData; });
+			});
+		if (moves.empty())
+		{
+			return 0;
+		}
+
+		// Copies already queued for the old buffers have to land before they are copied.
+		device.waitForUploads();
+
+		struct Retired
+		{
+			VkBuffer buffer;
+			ModelViewerAllocation allocation;
+		};
+		std::vector<Retired> retired;
+		VkDeviceSize movedBytes = 0;
+
+		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+		for (const ModelViewerAllocator::DefragmentationMove& move : moves)
+		{
+			Page& page = *static_cast<Page*>(move.userData);
+			const bool vertices = page.vertexAllocation.memory == move.source.memory && page.vertexAllocation.offset == move.source.offset;
+			VkBuffer& buffer = vertices ? page.vertexBuffer : page.indexBuffer;
+			ModelViewerAllocation& allocation = vertices ? page.vertexAllocation : page.indexAllocation;
+			const VkDeviceSize size = vertices
+				? static_cast<VkDeviceSize>(page.vertexStride) * page.vertexCapacity
+				: static_cast<VkDeviceSize>(indexSize(page.indexType)) * page.indexCapacity;
+
+			ModelViewerAllocation destination = allocator.claimDestination(move);
+			if (destination.block == nullptr)
+			{
+				continue;
+			}
+
+			VkBuffer moved;
+			device.createBuffer(size, vertices ? kVertexUsage : kIndexUsage, destination, moved);
+
+			VkBufferCopy copyRegion{};
+			copyRegion.size = size;
+			vkCmdCopyBuffer(commandBuffer, buffer, moved, 1, &copyRegion);
+
+			retired.push_back({ buffer, allocation });
+			buffer = moved;
+			allocation = destination;
+			movedBytes += size;
+		}
+		device.endSingleTimeCommands(commandBuffer);
+
+		// Frames in flight, and the one being recorded, may still have the old buffers bound.
+		for (Retired& old : retired)
+		{
+			device.deferDestroyBuffer(old.buffer, old.allocation);
+		}
+		return movedBytes;
+	}
+
+	void ModelViewerGeometryPool::bind(VkCommandBuffer commandBuffer, uint32_t page)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		const Page& boundPage = *pages[page];
+
+		VkBuffer buffers[] = { boundPage.vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, boundPage.indexBuffer, 0, boundPage.indexType);
+	}
+
+	ModelViewerGeometryPool::Stats ModelViewerGeometryPool::stats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Stats stats{};
+		for (const auto& page : pages)
+		{
+			if (!page)
+			{
+				continue;
+			}
+
+			stats.pageCount++;
+			stats.rangeCount += page->rangeCount;
+			stats.vertexBytesUsed += static_cast<VkDeviceSize>(page->verticesUsed) * page->vertexStride;
+			stats.vertexBytesCapacity += static_cast<VkDeviceSize>(page->vertexCapacity) * page->vertexStride;
+			stats.indexBytesUsed += static_cast<VkDeviceSize>(page->indicesUsed) * indexSize(page->indexType);
+			stats.indexBytesCapacity += static_cast<VkDeviceSize>(page->indexCapacity) * indexSize(page->indexType);
+		}
+		return stats;
+	}
+} // namespace ModelViewer
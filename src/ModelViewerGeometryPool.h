@@ -0,0 +1,122 @@
+#pragma once
+
+#include "ModelViewerAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ModelViewer
+{
+	class ModelViewerDevice;
+
+	// Packs the geometry of every model into a few large device-local vertex/index buffer
+	// pairs ("pages"). A model only owns a range inside a page and draws with
+	// vertexOffset/firstIndex, so consecutive draws from the same page share one bind.
+	// Pages hold a single vertex stride and index type; a new page is created when no
+	// matching page has room, sized to fit meshes larger than the default page. Meshes with
+	// few enough vertices go to 16-bit index pages, halving their index memory.
+	class ModelViewerGeometryPool
+	{
+	public:
+		static constexpr uint32_t INVALID_PAGE = std::numeric_limits<uint32_t>::max();
+		static constexpr uint32_t DEFAULT_PAGE_VERTICES = 1u << 20;
+		static constexpr uint32_t DEFAULT_PAGE_INDICES = 3u << 20;
+
+		struct Range
+		{
+			uint32_t page = INVALID_PAGE;
+			uint32_t vertexOffset = 0;
+			uint32_t vertexCount = 0;
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+
+			bool isValid() const { return page != INVALID_PAGE; }
+		};
+
+		struct Stats
+		{
+			uint32_t pageCount = 0;
+			uint32_t rangeCount = 0;
+			VkDeviceSize vertexBytesUsed = 0;
+			VkDeviceSize vertexBytesCapacity = 0;
+			VkDeviceSize indexBytesUsed = 0;
+			VkDeviceSize indexBytesCapacity = 0;
+		};
+
+		ModelViewerGeometryPool(ModelViewerDevice& device);
+		~ModelViewerGeometryPool();
+
+		ModelViewerGeometryPool(const ModelViewerGeometryPool&) = delete;
+		ModelViewerGeometryPool& operator=(const ModelViewerGeometryPool&) = delete;
+
+		// 16-bit indices for meshes whose indices, including the 0xFFFF primitive restart
+		// value, fit; 32-bit otherwise.
+		static VkIndexType indexTypeFor(uint32_t vertexCount) { return vertexCount < 0xFFFF ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+		static uint32_t indexSize(VkIndexType indexType) { return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+
+		Range allocate(uint32_t vertexStride, uint32_t vertexCount, uint32_t indexCount, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+		void free(Range& range);
+
+		// Queues the copies on the device staging ring. Indices are always passed as 32-bit
+		// and narrowed for 16-bit pages, 0xFFFFFFFF restarts included.
+		void upload(const Range& range, const void* vertices, const uint32_t* indices);
+
+		void bind(VkCommandBuffer commandBuffer, uint32_t page);
+
+		// Render thread only. Moves page buffers the allocator plans to relocate, up to
+		// maxBytes, so that sparsely used memory blocks can be released. Waits for pending
+		// uploads and for the copies, so call it at a point where a hitch is acceptable.
+		// Returns the bytes moved; nothing is moved while a loader thread is uploading.
+		VkDeviceSize defragment(VkDeviceSize maxBytes);
+
+		Stats stats() const;
+
+	private:
+		// First fit free list over element offsets, coalesced on release.
+		class RangeList
+		{
+		public:
+			void reset(uint32_t capacity);
+			bool allocate(uint32_t count, uint32_t& offset);
+			void release(uint32_t offset, uint32_t count);
+
+		private:
+			std::map<uint32_t, uint32_t> freeRanges;
+		};
+
+		struct Page
+		{
+			uint32_t vertexStride = 0;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+			uint32_t vertexCapacity = 0;
+			uint32_t indexCapacity = 0;
+			uint32_t verticesUsed = 0;
+			uint32_t indicesUsed = 0;
+			uint32_t rangeCount = 0;
+
+			VkBuffer vertexBuffer = VK_NULL_HANDLE;
+			ModelViewerAllocation vertexAllocation{};
+			VkBuffer indexBuffer = VK_NULL_HANDLE;
+			ModelViewerAllocation indexAllocation{};
+
+			RangeList vertexRanges;
+			RangeList indexRanges;
+		};
+
+		uint32_t createPage(uint32_t vertexStride, VkIndexType indexType, uint32_t vertexCapacity, uint32_t indexCapacity);
+		void destroyPage(Page& page);
+
+		ModelViewerDevice& device;
+
+		mutable std::mutex mutex;
+		std::vector<std::unique_ptr<Page>> pages;
+		// upload() calls between looking up a page's buffers and queueing their copies.
+		uint32_t uploadsInProgress = 0;
+	};
+} // namespace ModelViewer
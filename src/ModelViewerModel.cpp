@@ -1,147 +1,392 @@
 #include "ModelViewerModel.h"
+#include "Core/ModelViewerSystemMemory.h"
+#include "Loader/ModelViewerMeshCache.h"
+#include "Loader/ModelViewerMeshletBuilder.h"
+#include "Loader/ModelViewerMeshOptimizer.h"
+#include "Loader/ModelViewerMeshSimplifier.h"
+#include "Loader/ModelViewerObjLoader.h"
+#include "ModelViewerResidencyManager.h"
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace ModelViewer
 {
-	ModelViewerModel::ModelViewerModel(ModelViewerDevice& device, const ModelViewerModel::Builder &builder) : modelViewerDevice { device }
+	ModelViewerModel::ModelViewerModel(ModelViewerDevice& device, const ModelViewerModel::Builder &builder) : ModelViewerModel{ device, builder.vertices, builder.indices, builder.topology, builder.meshlets, builder.lods }
 	{
+	}
+
+	ModelViewerModel::ModelViewerModel(ModelViewerDevice& device, std::span<const Vertex> vertices, std::span<const uint32_t> indices, VkPrimitiveTopology topology,
+		std::span<const Meshlet> meshlets, std::span<const Lod> lods) :
+		modelViewerDevice{ device }, topology{ topology }, meshlets(meshlets.begin(), meshlets.end()), lods(lods.begin(), lods.end())
+	{
+		assert(vertices.size() >= 3 && "Vertex count must be at least 3.");
+
+		// Centre the sphere on the bounding box; looser than a minimal sphere but one pass.
+		glm::vec3 boundsMin = vertices[0].position;
+		glm::vec3 boundsMax = vertices[0].position;
+		for (const Vertex& vertex : vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (const Vertex& vertex : vertices)
+		{
+			radius = std::max(radius, glm::length(vertex.position - center));
+		}
+		setBounds(boundsMin, boundsMax, radius);
 
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+		std::vector<PackedVertex> packedVertices(vertices.size());
+		packVertices(vertices, boundsMin, quantizationScaleFor(boundsMin, boundsMax), packedVertices);
+		upload(packedVertices, indices);
 	}
 
-	ModelViewerModel::~ModelViewerModel()
+	ModelViewerModel::ModelViewerModel(ModelViewerDevice& device, std::span<const PackedVertex> vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float boundingRadius,
+		std::span<const uint32_t> indices, VkPrimitiveTopology topology, std::span<const Meshlet> meshlets, std::span<const Lod> lods) :
+		modelViewerDevice{ device }, topology{ topology }, meshlets(meshlets.begin(), meshlets.end()), lods(lods.begin(), lods.end())
 	{
-		vkDestroyBuffer(modelViewerDevice.device(), vertexBuffer, nullptr);
-		vkFreeMemory(modelViewerDevice.device(), vertexBufferMemory, nullptr);
+		assert(vertices.size() >= 3 && "Vertex count must be at least 3.");
 
-		if (hasIndexBuffer)
+		setBounds(boundsMin, boundsMax, boundingRadius);
+		upload(vertices, indices);
+	}
+
+	ModelViewerModel::ModelViewerModel(ModelViewerDevice& device, std::shared_ptr<const ModelViewerMeshCache> cache) :
+		modelViewerDevice{ device }, topology{ VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST }, meshlets(cache->meshlets().begin(), cache->meshlets().end()), streamedCache{ cache }
+	{
+		assert(!cache->pages().empty() && cache->lods().size() > 1 && "Streamed models need pages and a coarser LOD!");
+
+		// The header's bounds spare a pass over vertices that may not fit in memory. They
+		// are the bounds both the cached vertices and the pages were quantized with.
+		const ModelViewerMeshCache::Header& header = cache->header();
+		setBounds({ header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] }, { header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] }, header.boundingRadius);
+
+		// The coarsest LOD stays resident as the stand-in while pages stream in, with only
+		// the vertices it uses.
+		const Lod& coarsest = cache->lods().back();
+		std::unordered_map<uint32_t, uint32_t> remap;
+		std::vector<PackedVertex> coarseVertices;
+		std::vector<uint32_t> coarseIndices;
+		coarseIndices.reserve(coarsest.indexCount);
+		for (uint32_t index : cache->indices().subspan(coarsest.firstIndex, coarsest.indexCount))
 		{
-			vkDestroyBuffer(modelViewerDevice.device(), indexBuffer, nullptr);
-			vkFreeMemory(modelViewerDevice.device(), indexBufferMemory, nullptr);
+			auto [entry, inserted] = remap.try_emplace(index, static_cast<uint32_t>(coarseVertices.size()));
+			if (inserted)
+			{
+				coarseVertices.push_back(cache->vertices()[index]);
+			}
+			coarseIndices.push_back(entry->second);
 		}
+
+		lods = { { 0, 0, 0.0f }, { 0, static_cast<uint32_t>(coarseIndices.size()), coarsest.error } };
+		upload(coarseVertices, coarseIndices);
+
+		pageCount = static_cast<uint32_t>(cache->pages().size());
+		firstPage = modelViewerDevice.getResidencyManager().registerPages(cache);
 	}
 
-	void ModelViewerModel::draw(VkCommandBuffer commandBuffer)
+	void ModelViewerModel::setBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float boundingRadius)
 	{
-		if (hasIndexBuffer)
+		boundingSphere.center = (boundsMin + boundsMax) * 0.5f;
+		boundingSphere.radius = boundingRadius;
+
+		const float quantizationScale = quantizationScaleFor(boundsMin, boundsMax);
+		dequantization = glm::translate(glm::mat4{ 1.0f }, boundsMin) * glm::scale(glm::mat4{ 1.0f }, glm::vec3{ quantizationScale });
+	}
+
+	void ModelViewerModel::upload(std::span<const PackedVertex> vertices, std::span<const uint32_t> indices)
+	{
+		// Everything in the pool is drawn indexed, so unindexed input gets a trivial index list.
+		std::vector<uint32_t> sequentialIndices;
+		if (indices.empty())
 		{
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			sequentialIndices.resize(vertices.size());
+			std::iota(sequentialIndices.begin(), sequentialIndices.end(), 0u);
+			indices = sequentialIndices;
 		}
-		else
+		if (lods.empty())
+		{
+			lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+		}
+
+		ModelViewerGeometryPool& geometryPool = modelViewerDevice.getGeometryPool();
+		const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+		geometry = geometryPool.allocate(sizeof(PackedVertex), vertexCount, static_cast<uint32_t>(indices.size()), ModelViewerGeometryPool::indexTypeFor(vertexCount));
+		geometryPool.upload(geometry, vertices.data(), indices.data());
+	}
+
+	ModelViewerModel::~ModelViewerModel()
+	{
+		if (streamedCache)
 		{
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			modelViewerDevice.getResidencyManager().unregisterPages(firstPage, pageCount);
 		}
+
+		// Frames still in flight may be drawing this mesh, so its range is only handed back
+		// to the pool once they have completed.
+		ModelViewerGeometryPool& geometryPool = modelViewerDevice.getGeometryPool();
+		modelViewerDevice.getDeletionQueue().push([&geometryPool, geometry = geometry]() mutable { geometryPool.free(geometry); });
 	}
 
-	void ModelViewerModel::bind(VkCommandBuffer commandBuffer)
+	namespace
 	{
-		VkBuffer buffers[] = { vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		// Rough peak memory of parsing, welding, simplifying and paging a mesh, per byte of
+		// its OBJ text.
+		constexpr uint64_t kImportBytesPerSourceByte = 4;
 
-		if (hasIndexBuffer)
+		void printOptimizerStats(const std::string& filepath, const ModelViewerMeshOptimizer::Stats& stats)
 		{
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			std::cout << "Optimized " << filepath << ": ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+				<< ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr << " in " << stats.milliseconds << " ms" << std::endl;
+		}
+
+		// The cache holds the vertices already packed and the bounds they were packed with,
+		// so the mapped spans go to the geometry pool's upload as they are.
+		std::unique_ptr<ModelViewerModel> createModelFromCache(ModelViewerDevice& device, const std::string& filepath, std::unique_ptr<ModelViewerMeshCache> cache,
+			const ModelImportOptions& options, std::chrono::high_resolution_clock::time_point startTime)
+		{
+			std::unique_ptr<ModelViewerModel> model;
+			const size_t fileSize = cache->fileSize();
+			const size_t vertexCount = cache->vertices().size();
+			const size_t indexCount = cache->lods().empty() ? cache->indices().size() : cache->lods()[0].indexCount;
+			const ModelViewerMeshOptimizer::Stats* stats = cache->optimizerStats();
+			if (options.streamClusters && options.buildMeshlets && !cache->pages().empty() && cache->lods().size() > 1)
+			{
+				// The model keeps the mapping alive for the pages it streams.
+				model = std::make_unique<ModelViewerModel>(device, std::shared_ptr<const ModelViewerMeshCache>{ std::move(cache) });
+			}
+			else
+			{
+				const std::span<const ModelViewerModel::Meshlet> meshlets = options.buildMeshlets ? cache->meshlets() : std::span<const ModelViewerModel::Meshlet>{};
+				// Without LODs only LOD 0 is uploaded. The coarser LODs follow it in the index
+				// list, so cutting the list after LOD 0 keeps every other offset valid.
+				std::span<const uint32_t> indices = cache->indices();
+				std::span<const ModelViewerModel::Lod> lods = cache->lods();
+				if (!options.generateLods && !lods.empty())
+				{
+					lods = lods.first(1);
+					indices = indices.first(lods[0].firstIndex + lods[0].indexCount);
+				}
+				const ModelViewerMeshCache::Header& header = cache->header();
+				model = std::make_unique<ModelViewerModel>(device, cache->vertices(), glm::vec3{ header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] },
+					glm::vec3{ header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] }, header.boundingRadius, indices, cache->topology(), meshlets, lods);
+			}
+
+			std::cout << "Loaded " << ModelViewerMeshCache::cachePathFor(filepath) << " (" << fileSize << " bytes): "
+				<< vertexCount << " vertices, " << indexCount / 3 << " triangles, "
+				<< model->getLods().size() << " LODs";
+			if (model->isStreamed())
+			{
+				std::cout << ", " << model->getMeshlets().size() << " meshlets streamed";
+			}
+			std::cout << " in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() << " ms" << std::endl;
+			if (stats)
+			{
+				printOptimizerStats(filepath, *stats);
+			}
+
+			return model;
 		}
 	}
 
-	void ModelViewerModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+	std::unique_ptr<ModelViewerModel> ModelViewerModel::createModelFromFile(ModelViewerDevice& device, const std::string& filepath, const ModelImportOptions& options)
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
+		auto startTime = std::chrono::high_resolution_clock::now();
 
-		assert(vertexCount >= 3 && "Vertex count must be at least 3.");
+		// An optimized cache also serves unoptimized imports; the reverse triggers a re-import.
+		const uint32_t passFlags = (options.stripify ? ModelViewerMeshCache::Stripified : 0) | (options.buildMeshlets ? ModelViewerMeshCache::Clustered : 0)
+			| (options.generateLods ? ModelViewerMeshCache::Simplified : 0) | (options.streamClusters ? ModelViewerMeshCache::Paged : 0);
+		const uint32_t requiredFlags = (options.optimize ? ModelViewerMeshCache::Optimized : 0) | passFlags;
+		if (std::unique_ptr<ModelViewerMeshCache> cache = ModelViewerMeshCache::open(filepath, requiredFlags))
+		{
+			return createModelFromCache(device, filepath, std::move(cache), options, startTime);
+		}
 
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+		// The first import still builds the whole mesh in memory before paging it into the
+		// cache, so a streamed model that would not fit is refused up front rather than
+		// thrashing or running out of memory halfway through.
+		if (options.streamClusters)
+		{
+			const uint64_t required = std::filesystem::file_size(filepath) * kImportBytesPerSourceByte;
+			const uint64_t available = availableSystemMemory();
+			if (available != 0 && required > available)
+			{
+				throw std::runtime_error("Importing " + filepath + " for streaming needs about " + std::to_string(required >> 20)
+					+ " MB but only " + std::to_string(available >> 20) + " MB of memory is available!");
+			}
+		}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		modelViewerDevice.createBuffer(bufferSize, 
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer, 
-			stagingBufferMemory);
+		Builder builder{};
+		builder.loadModel(filepath);
 
-		void* data;
-		vkMapMemory(modelViewerDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), static_cast<uint32_t>(bufferSize));
-		vkUnmapMemory(modelViewerDevice.device(), stagingBufferMemory);
+		std::cout << "Loaded " << filepath << ": " << builder.vertices.size() << " vertices, "
+			<< builder.indices.size() / 3 << " triangles" << std::endl;
 
-		modelViewerDevice.createBuffer(bufferSize,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			vertexBuffer,
-			vertexBufferMemory);
+		ModelViewerMeshOptimizer::Stats optimizerStats{};
+		if (options.optimize)
+		{
+			optimizerStats = ModelViewerMeshOptimizer::optimize(builder);
+			printOptimizerStats(filepath, optimizerStats);
+		}
 
-		modelViewerDevice.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+		if (options.generateLods)
+		{
+			auto simplifyStart = std::chrono::high_resolution_clock::now();
+			ModelViewerMeshSimplifier::generateLods(builder);
 
-		vkDestroyBuffer(modelViewerDevice.device(), stagingBuffer, nullptr);
-		vkFreeMemory(modelViewerDevice.device(), stagingBufferMemory, nullptr);
-	}
+			std::cout << "Simplified " << filepath << " into " << builder.lods.size() << " LODs (";
+			for (size_t lod = 0; lod < builder.lods.size(); lod++)
+			{
+				std::cout << (lod == 0 ? "" : ", ") << builder.lods[lod].indexCount / 3 << " triangles, error " << builder.lods[lod].error;
+			}
+			std::cout << ") in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - simplifyStart).count() << " ms" << std::endl;
+		}
 
-	void ModelViewerModel::createIndexBuffers(const std::vector<uint32_t>& indices)
-	{
-		indexCount = static_cast<uint32_t>(indices.size());
-		hasIndexBuffer = indexCount > 0;
+		const uint32_t baseIndexCount = builder.lods.empty() ? static_cast<uint32_t>(builder.indices.size()) : builder.lods[0].indexCount;
+		if (options.buildMeshlets && builder.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST
+			&& baseIndexCount / 3 >= ModelViewerMeshletBuilder::kMinTriangles)
+		{
+			builder.meshlets = ModelViewerMeshletBuilder::build(builder.vertices, std::span<const uint32_t>(builder.indices).first(baseIndexCount));
+			std::cout << "Split " << filepath << " into " << builder.meshlets.size() << " meshlets" << std::endl;
+		}
 
-		if (!hasIndexBuffer)
+		if (options.streamClusters && !builder.meshlets.empty() && builder.lods.size() > 1)
+		{
+			ModelViewerMeshletBuilder::buildPages(builder);
+			std::cout << "Paged " << filepath << " into " << builder.pages.size() << " pages, " << builder.pageData.size() << " bytes" << std::endl;
+		}
+
+		if (options.stripify && builder.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST && builder.meshlets.empty())
+		{
+			// Every LOD becomes its own run of strips. Short strips cost more indices than the
+			// list, restarts included.
+			std::vector<Lod> ranges = builder.lods;
+			if (ranges.empty())
+			{
+				ranges.push_back({ 0, static_cast<uint32_t>(builder.indices.size()), 0.0f });
+			}
+			std::vector<uint32_t> strips;
+			std::vector<Lod> stripRanges;
+			for (const Lod& range : ranges)
+			{
+				std::vector<uint32_t> lodStrips = ModelViewerMeshOptimizer::stripify(std::span<const uint32_t>(builder.indices).subspan(range.firstIndex, range.indexCount));
+				stripRanges.push_back({ static_cast<uint32_t>(strips.size()), static_cast<uint32_t>(lodStrips.size()), range.error });
+				strips.insert(strips.end(), lodStrips.begin(), lodStrips.end());
+			}
+
+			std::cout << "Stripified " << filepath << ": " << builder.indices.size() << " -> " << strips.size() << " indices"
+				<< (strips.size() < builder.indices.size() ? "" : ", keeping the list") << std::endl;
+			if (strips.size() < builder.indices.size())
+			{
+				builder.indices = std::move(strips);
+				builder.lods = std::move(stripRanges);
+				builder.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+			}
+		}
+
+		try
+		{
+			ModelViewerMeshCache::write(filepath, builder, options.optimize ? &optimizerStats : nullptr, passFlags);
+		}
+		catch (const std::exception& e)
 		{
-			return;
+			// A missing cache only costs the next launch a re-import.
+			std::cout << "Could not write mesh cache for " << filepath << ": " << e.what() << std::endl;
 		}
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+		// Pages are streamed from the mapping, so a paged import switches over to the cache
+		// it just wrote and lets the builder's copy go.
+		if (!builder.pages.empty())
+		{
+			if (std::unique_ptr<ModelViewerMeshCache> cache = ModelViewerMeshCache::open(filepath, requiredFlags))
+			{
+				builder = {};
+				return createModelFromCache(device, filepath, std::move(cache), options, startTime);
+			}
+		}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		modelViewerDevice.createBuffer(bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer,
-			stagingBufferMemory);
+		return std::make_unique<ModelViewerModel>(device, builder);
+	}
 
-		void* data;
-		vkMapMemory(modelViewerDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), static_cast<uint32_t>(bufferSize));
-		vkUnmapMemory(modelViewerDevice.device(), stagingBufferMemory);
+	void ModelViewerModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod)
+	{
+		// Only the GPU path streams pages; elsewhere a streamed model draws its coarsest LOD.
+		const Lod* range = &lods[std::min<size_t>(lod, lods.size() - 1)];
+		if (range->indexCount == 0)
+		{
+			range = &lods.back();
+		}
+		vkCmdDrawIndexed(commandBuffer, range->indexCount, instanceCount, geometry.firstIndex + range->firstIndex, static_cast<int32_t>(geometry.vertexOffset), firstInstance);
+	}
 
-		modelViewerDevice.createBuffer(bufferSize,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			indexBuffer,
-			indexBufferMemory);
+	std::vector<VkVertexInputBindingDescription> ModelViewerModel::getBindingDescriptions()
+	{
+		return vertexBindingDescriptions<PackedVertex, Instance>();
+	}
 
-		modelViewerDevice.copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+	std::vector<VkVertexInputAttributeDescription> ModelViewerModel::getAttributeDescriptions()
+	{
+		return vertexAttributeDescriptions<PackedVertex, Instance>();
+	}
 
-		vkDestroyBuffer(modelViewerDevice.device(), stagingBuffer, nullptr);
-		vkFreeMemory(modelViewerDevice.device(), stagingBufferMemory, nullptr);
+	float ModelViewerModel::quantizationScaleFor(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		// One scale for all axes keeps the dequantization a similarity transform, so bounding
+		// spheres and normals survive it unchanged.
+		const float extent = std::max({ boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z });
+		return extent > 0.0f ? extent : 1.0f;
 	}
 
-	std::vector<VkVertexInputBindingDescription> ModelViewerModel::Vertex::getBindingDescriptions()
+	void ModelViewerModel::packVertices(std::span<const Vertex> vertices, const glm::vec3& quantizationOrigin, float quantizationScale, std::span<PackedVertex> packed)
 	{
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
-		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		assert(packed.size() >= vertices.size() && "Packed vertex span too small!");
+
+		const float inverseScale = 1.0f / quantizationScale;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex& vertex = vertices[i];
+			PackedVertex& out = packed[i];
 
-		return bindingDescriptions;
+			const glm::vec3 position = (vertex.position - quantizationOrigin) * inverseScale;
+			out.position[0] = VertexEncoding::unorm16(position.x);
+			out.position[1] = VertexEncoding::unorm16(position.y);
+			out.position[2] = VertexEncoding::unorm16(position.z);
+			out.position[3] = 0;
 
+			const std::array<int16_t, 2> normal = VertexEncoding::octahedralSnorm16(vertex.normal);
+			out.normal[0] = normal[0];
+			out.normal[1] = normal[1];
+
+			out.uv[0] = VertexEncoding::half(vertex.uv.x);
+			out.uv[1] = VertexEncoding::half(vertex.uv.y);
+
+			out.color[0] = VertexEncoding::unorm8(vertex.color.x);
+			out.color[1] = VertexEncoding::unorm8(vertex.color.y);
+			out.color[2] = VertexEncoding::unorm8(vertex.color.z);
+			out.color[3] = 255;
+		}
 	}
 
-	std::vector<VkVertexInputAttributeDescription> ModelViewerModel::Vertex::getAttributeDescriptions()
+	void ModelViewerModel::Builder::loadModel(const std::string& filepath)
 	{
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(1);
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-		/*attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);*/
-
-		return attributeDescriptions;
+		ModelViewerObjLoader::Stats stats{};
+		ModelViewerObjLoader::load(filepath, *this, &stats);
+
+		std::cout << "Parsed " << filepath << " (" << stats.fileSize << " bytes) in " << stats.chunkCount << " chunks: "
+			<< stats.parseMilliseconds << " ms parse, " << stats.mergeMilliseconds << " ms merge" << std::endl;
+		std::cout << "Welded " << stats.weld.cornerCount << " corners into " << stats.weld.uniqueCount << " vertices ("
+			<< stats.weld.weldRate() * 100.0 << "% welded) in " << stats.weldMilliseconds << " ms" << std::endl;
 	}
 
 } // namespace ModelViewer
\ No newline at end of file
@@ -1,55 +1,210 @@
 #pragma once
 
 #include "ModelViewerDevice.h"
+#include "ModelViewerVertexFormat.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
 #include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
 namespace ModelViewer
 {
+	struct ModelImportOptions
+	{
+		// Reorder triangles and vertices with ModelViewerMeshOptimizer before upload.
+		bool optimize = true;
+		// Convert to triangle strips with primitive restart where that needs fewer indices.
+		// Meshes split into meshlets stay triangle lists.
+		bool stripify = false;
+		// Split dense meshes into meshlets for per-cluster culling.
+		bool buildMeshlets = true;
+		// Generate simplified LODs for distant objects.
+		bool generateLods = true;
+		// Keep only the coarsest LOD in memory and stream LOD 0's meshlets from the mesh
+		// cache on demand. Needs meshlets and LODs; only the GPU culling path streams.
+		bool streamClusters = false;
+	};
+
+	class ModelViewerMeshCache;
+
 	class ModelViewerModel
 	{
 	public:
 
+		// Full precision vertex produced by importers and kept in the mesh cache.
 		struct Vertex
 		{
-			glm::vec3 position;
-			glm::vec3 color;
+			glm::vec3 position{};
+			glm::vec3 color{};
+			glm::vec3 normal{};
+			glm::vec2 uv{};
+		};
+
+		// Compact vertex the geometry pool stores and the shaders read, 20 bytes instead of
+		// 44. Positions are unorm16 inside the mesh's quantization cube (see
+		// getDequantization), normals octahedral snorm16, uvs half floats, colors unorm8.
+		struct PackedVertex
+		{
+			uint16_t position[4];
+			int16_t normal[2];
+			uint16_t uv[2];
+			uint8_t color[4];
 
-			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+			static constexpr VkVertexInputRate kInputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			static constexpr std::array<VertexField, 4> fields()
+			{
+				return { {
+					{ 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) },
+					{ 5, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) },
+					{ 6, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) },
+					{ 7, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) },
+				} };
+			}
+		};
+
+		// Per-instance vertex data, streamed into binding 1 by the render system. The
+		// transform includes the mesh's dequantization.
+		struct Instance
+		{
+			glm::mat4 transform{ 1.0f };
+
+			static constexpr VkVertexInputRate kInputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+			static constexpr std::array<VertexField, 1> fields()
+			{
+				return { { { 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Instance, transform), 4 } } };
+			}
+		};
+
+		// Binding 0 is per vertex, binding 1 per instance.
+		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+
+		static void packVertices(std::span<const Vertex> vertices, const glm::vec3& quantizationOrigin, float quantizationScale, std::span<PackedVertex> packed);
+		// Edge length of the quantization cube for positions within the given bounds.
+		static float quantizationScaleFor(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+		// Object space bounds used for frustum culling, in unquantized units.
+		struct BoundingSphere
+		{
+			glm::vec3 center{};
+			float radius = 0.0f;
+		};
+
+		// A run of consecutive triangles in the mesh's index list with its own bounds, culled
+		// on the GPU by the indirect render system. Stored as is in the mesh cache.
+		struct Meshlet
+		{
+			glm::vec3 center{};
+			float radius = 0.0f;
+			// Every triangle normal lies within the cone around coneAxis; coneCutoff is the sine
+			// of its half angle, 1 when the triangles face too many ways to ever be back-facing.
+			glm::vec3 coneAxis{ 0.0f, 0.0f, 1.0f };
+			float coneCutoff = 1.0f;
+			// Relative to the start of the mesh's indices.
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			uint32_t vertexCount = 0;
+			uint32_t padding = 0;
+		};
+
+		// A fixed number of consecutive LOD 0 meshlets packed for streaming: PackedVertex
+		// data followed by 16-bit indices local to the page, offset bytes into the mesh
+		// cache's page data. Stored as is in the mesh cache.
+		struct ClusterPage
+		{
+			uint64_t offset = 0;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+			uint32_t firstMeshlet = 0;
+			uint32_t meshletCount = 0;
+		};
+
+		static constexpr uint32_t kMaxLods = 5;
+
+		// One level of detail: an index range of the shared vertex buffer and its geometric
+		// error, the furthest its surface may lie from LOD 0's in object space units.
+		struct Lod
+		{
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			float error = 0.0f;
 		};
 
 		struct Builder
 		{
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
+			// TRIANGLE_STRIP indices separate strips with ModelViewerMeshOptimizer::kRestartIndex.
+			VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			// Meshlets cover LOD 0 only.
+			std::vector<Meshlet> meshlets{};
+			// Finest first; empty means the whole index list is the only LOD.
+			std::vector<Lod> lods{};
+			// Streaming pages of the meshlets, quantized like the model; empty unless built.
+			std::vector<ClusterPage> pages{};
+			std::vector<uint8_t> pageData{};
+
+			void loadModel(const std::string& filepath);
 		};
 
 		ModelViewerModel(ModelViewerDevice& device, const ModelViewerModel::Builder &builder);
+		ModelViewerModel(ModelViewerDevice& device, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+			VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, std::span<const Meshlet> meshlets = {}, std::span<const Lod> lods = {});
+		// Uploads vertices already packed against boundsMin and boundsMax, such as a mesh
+		// cache's mapped ones, without another pass over them.
+		ModelViewerModel(ModelViewerDevice& device, std::span<const PackedVertex> vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float boundingRadius,
+			std::span<const uint32_t> indices, VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, std::span<const Meshlet> meshlets = {}, std::span<const Lod> lods = {});
+		// Streams LOD 0 from the pages of cache, which stays mapped for the model's lifetime.
+		// Only the coarsest LOD is uploaded to the geometry pool.
+		ModelViewerModel(ModelViewerDevice& device, std::shared_ptr<const ModelViewerMeshCache> cache);
 		~ModelViewerModel();
 
-		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		static std::unique_ptr<ModelViewerModel> createModelFromFile(ModelViewerDevice& device, const std::string& filepath, const ModelImportOptions& options = {});
+
+		// Draws from the geometry pool page returned by getGeometry(); the caller binds the
+		// page so that consecutive models sharing it skip the rebind.
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
+
+		const ModelViewerGeometryPool::Range& getGeometry() const { return geometry; }
+		// Render systems pick the matching pipeline; strips need primitive restart.
+		VkPrimitiveTopology getTopology() const { return topology; }
+		const BoundingSphere& getBoundingSphere() const { return boundingSphere; }
+		// Empty for meshes drawn whole.
+		const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+		// At least one; index ranges are relative to getGeometry().firstIndex. A streamed
+		// model's LOD 0 is empty since its meshlets live in the residency manager's pool.
+		const std::vector<Lod>& getLods() const { return lods; }
+		bool isStreamed() const { return streamedCache != nullptr; }
+		// Residency manager id of the page holding meshlet 0; meshlet i is in page
+		// getFirstPage() + i / ModelViewerMeshletBuilder::kPageMeshlets.
+		uint32_t getFirstPage() const { return firstPage; }
+		// Maps packed unorm16 positions back to object space; instance transforms apply it.
+		const glm::mat4& getDequantization() const { return dequantization; }
 
 		ModelViewerModel(const ModelViewerModel&) = delete;
 		ModelViewerModel& operator=(const ModelViewerModel&) = delete;
 			 
 	private:
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		// Sets the bounding sphere and the dequantization for vertices packed against the bounds.
+		void setBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float boundingRadius);
+		// Copies the mesh into the geometry pool, adding a trivial index list and LOD if missing.
+		void upload(std::span<const PackedVertex> vertices, std::span<const uint32_t> indices);
 
 		ModelViewerDevice &modelViewerDevice;
-		VkBuffer vertexBuffer;
-		VkDeviceMemory vertexBufferMemory;
-		uint32_t vertexCount;
-
-		bool hasIndexBuffer = false;
-		VkBuffer indexBuffer;
-		VkDeviceMemory indexBufferMemory;
-		uint32_t indexCount;
+		ModelViewerGeometryPool::Range geometry;
+		VkPrimitiveTopology topology;
+		BoundingSphere boundingSphere;
+		glm::mat4 dequantization{ 1.0f };
+		std::vector<Meshlet> meshlets;
+		std::vector<Lod> lods;
+		std::shared_ptr<const ModelViewerMeshCache> streamedCache;
+		uint32_t firstPage = 0;
+		uint32_t pageCount = 0;
 	};
 } // namespace ModelViewer
@@ -1,50 +1,12 @@
 #pragma once
 
 #include "ModelViewerModel.h"
-
-#include <glm/gtc/matrix_transform.hpp>
+#include "Scene/ModelViewerTransformSystem.h"
 
 #include <memory>
 
 namespace ModelViewer
 {
-	struct TransformComponent
-	{
-		glm::vec3 translation{};
-		glm::vec3 scale{ 1.0f, 1.0f, 1.0f };
-		glm::vec3 rotation;
-
-		glm::mat4 mat4() {
-			const float c1 = glm::cos(rotation.y); // Y-axis
-			const float s1 = glm::sin(rotation.y);
-			const float c2 = glm::cos(rotation.x); // X-axis
-			const float s2 = glm::sin(rotation.x);
-			const float c3 = glm::cos(rotation.z); // Z-axis
-			const float s3 = glm::sin(rotation.z);
-			return glm::mat4{
-				{
-					scale.x * (c1 * c3 + s1 * s2 * s3),
-					scale.x * (s1 * s2 * c3 - c1 * s3),
-					scale.x * (s1 * c2),
-					0.0f,
-				},
-				{
-					scale.y * (c2 * s3),
-					scale.y * (c2 * c3),
-					scale.y * (-s2),
-					0.0f,
-				},
-				{
-					scale.z * (s1 * c3 - c1 * s2 * s3),
-					scale.z * (c1 * s2 * c3 + s1 * s3),
-					scale.z * (c1 * c2),
-					0.0f,
-				},
-				{translation.x, translation.y, translation.z, 1.0f}
-			};
-		}
-	};
-
 	class ModelViewerObject
 	{
 	public:
@@ -65,7 +27,8 @@ namespace ModelViewer
 
 		std::shared_ptr<ModelViewerModel> model{};
 		glm::vec3  color{};
-		TransformComponent transform;
+		// Owned by the scene's ModelViewerTransformSystem.
+		ModelViewerTransformSystem::Handle transform = ModelViewerTransformSystem::INVALID_HANDLE;
 
 	private:
 		ModelViewerObject(id_t objId) : id{ objId } {};
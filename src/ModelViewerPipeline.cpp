@@ -1,24 +1,19 @@
 #include "ModelViewerPipeline.h"
 #include "ModelViewerModel.h"
 
-#include <fstream>
 #include <iostream>
 #include <stdexcept>
-#include <filesystem>
 #include <cassert>
 
 namespace ModelViewer
 {
-	ModelViewerPipeline::ModelViewerPipeline(ModelViewerDevice& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo) : modelViewerDevice{device}
+	ModelViewerPipeline::ModelViewerPipeline(ModelViewerDevice& device, const std::string& vertShader, const std::string& fragShader, const PipelineConfigInfo& configInfo) : modelViewerDevice{device}
 	{
-		createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
+		createGraphicsPipeline(vertShader, fragShader, configInfo);
 	}
 
 	ModelViewerPipeline::~ModelViewerPipeline()
 	{
-		vkDestroyShaderModule(modelViewerDevice.device(), vertShaderModule, nullptr);
-		vkDestroyShaderModule(modelViewerDevice.device(), fragShaderModule, nullptr);
-
 		vkDestroyPipeline(modelViewerDevice.device(), graphicsPipeline, nullptr);
 	}
 
@@ -27,36 +22,13 @@ namespace ModelViewer
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 	}
 
-	std::vector<char> ModelViewerPipeline::readFile(const std::string& filepath)
-	{
-		std::ifstream file(filepath, std::ios::ate | std::ios::binary);
-
-		if (!file.is_open())
-		{
-			throw std::runtime_error("Failed to open file: " + filepath);
-		}
-
-		size_t fileSize = static_cast<size_t>(file.tellg());
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0);
-
-		file.read(buffer.data(), fileSize);
-
-		file.close();
-
-		return buffer;
-	}
-
-	void ModelViewerPipeline::createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo)
+	void ModelViewerPipeline::createGraphicsPipeline(const std::string& vertShader, const std::string& fragShader, const PipelineConfigInfo& configInfo)
 	{
 		assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
 		assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no renderPass provided in configInfo");
-		auto vertCode = readFile(vertFilepath);
-		auto fragCode = readFile(fragFilepath);
-
-		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
+		// The registry owns the modules; pipelines only reference them.
+		VkShaderModule vertShaderModule = modelViewerDevice.getShaderRegistry().getModule(vertShader);
+		VkShaderModule fragShaderModule = modelViewerDevice.getShaderRegistry().getModule(fragShader);
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -74,8 +46,26 @@ namespace ModelViewer
 		shaderStages[1].pNext = nullptr;
 		shaderStages[1].pSpecializationInfo = nullptr;
 
-		auto bindingDescriptions = ModelViewerModel::Vertex::getBindingDescriptions();
-		auto attributeDescriptions = ModelViewerModel::Vertex::getAttributeDescriptions();
+		std::vector<VkSpecializationMapEntry> specializationEntries(configInfo.specializationConstants.size());
+		for (uint32_t i = 0; i < specializationEntries.size(); i++)
+		{
+			specializationEntries[i].constantID = i;
+			specializationEntries[i].offset = static_cast<uint32_t>(sizeof(uint32_t) * i);
+			specializationEntries[i].size = sizeof(uint32_t);
+		}
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+		specializationInfo.pMapEntries = specializationEntries.data();
+		specializationInfo.dataSize = sizeof(uint32_t) * configInfo.specializationConstants.size();
+		specializationInfo.pData = configInfo.specializationConstants.data();
+		if (!specializationEntries.empty())
+		{
+			shaderStages[0].pSpecializationInfo = &specializationInfo;
+			shaderStages[1].pSpecializationInfo = &specializationInfo;
+		}
+
+		auto bindingDescriptions = ModelViewerModel::getBindingDescriptions();
+		auto attributeDescriptions = ModelViewerModel::getAttributeDescriptions();
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -103,7 +93,7 @@ namespace ModelViewer
 		pipelineInfo.basePipelineIndex = -1;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		if (vkCreateGraphicsPipelines(modelViewerDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+		if (vkCreateGraphicsPipelines(modelViewerDevice.device(), modelViewerDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to create graphics pipeline!");
 		}
@@ -113,16 +103,10 @@ namespace ModelViewer
 
 	}
 
-	void ModelViewerPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
+	void ModelViewerPipeline::triangleStripConfigInfo(PipelineConfigInfo& configInfo)
 	{
-		VkShaderModuleCreateInfo createInfo{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-		if (vkCreateShaderModule(modelViewerDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create shader module!");
-		}
+		configInfo.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+		configInfo.inputAssemblyInfo.primitiveRestartEnable = VK_TRUE;
 	}
 
 	void ModelViewerPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
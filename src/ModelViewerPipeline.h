@@ -25,13 +25,16 @@ namespace ModelViewer
 		VkPipelineLayout pipelineLayout = nullptr;
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		// Specialization constants of both shader stages; constant_id i takes the i-th value.
+		std::vector<uint32_t> specializationConstants;
 	};
 
 	class ModelViewerPipeline
 	{
 	public:
 		ModelViewerPipeline() = default;
-		ModelViewerPipeline(ModelViewerDevice& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
+		// Shaders are named as in the device's shader registry, e.g. "simple_shader.vert".
+		ModelViewerPipeline(ModelViewerDevice& device, const std::string& vertShader, const std::string& fragShader, const PipelineConfigInfo& configInfo);
 		~ModelViewerPipeline();
 
 		ModelViewerPipeline(const ModelViewerPipeline&) = delete;
@@ -39,18 +42,15 @@ namespace ModelViewer
 
 		void bind(VkCommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+		// Switches a config to triangle strips separated by primitive restart indices.
+		static void triangleStripConfigInfo(PipelineConfigInfo& configInfo);
 
 	private:
-		static std::vector<char> readFile(const std::string& filepath);
 
-		void createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
-
-		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+		void createGraphicsPipeline(const std::string& vertShader, const std::string& fragShader, const PipelineConfigInfo& configInfo);
 
 		ModelViewerDevice& modelViewerDevice;
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
 
 	};
 }
\ No newline at end of file
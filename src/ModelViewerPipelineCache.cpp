@@ -0,0 +1,148 @@
+#include "ModelViewerPipelineCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr int kSaveAttempts = 3;
+	}
+
+	ModelViewerPipelineCache::ModelViewerPipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties, std::string path) :
+		device{ device }, path{ std::move(path) }
+	{
+		std::vector<char> data = readValidFile(properties);
+
+		VkPipelineCacheCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		VkResult result = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
+		if (result != VK_SUCCESS && !data.empty())
+		{
+			// A driver may still reject data that passed the header check.
+			std::cout << "Discarding pipeline cache " << this->path << std::endl;
+			data.clear();
+			createInfo.initialDataSize = 0;
+			createInfo.pInitialData = nullptr;
+			result = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
+		}
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create pipeline cache!");
+		}
+
+		savedSize = data.size();
+		if (!data.empty())
+		{
+			std::cout << "Loaded pipeline cache " << this->path << " (" << data.size() << " bytes)" << std::endl;
+		}
+	}
+
+	ModelViewerPipelineCache::~ModelViewerPipelineCache()
+	{
+		try
+		{
+			save();
+		}
+		catch (const std::exception& e)
+		{
+			// Losing the cache only costs the next launch its compile time.
+			std::cout << "Could not save pipeline cache " << path << ": " << e.what() << std::endl;
+		}
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
+	}
+
+	std::vector<char> ModelViewerPipelineCache::readValidFile(const VkPhysicalDeviceProperties& properties) const
+	{
+		std::ifstream in{ path, std::ios::binary | std::ios::ate };
+		if (!in.is_open())
+		{
+			return {};
+		}
+
+		std::vector<char> data(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		in.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+		VkPipelineCacheHeaderVersionOne header{};
+		if (!in.good() || data.size() < sizeof(header))
+		{
+			return {};
+		}
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		if (header.headerSize < sizeof(header) || header.headerSize > data.size()
+			|| header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			|| header.vendorID != properties.vendorID || header.deviceID != properties.deviceID
+			|| std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			std::cout << "Pipeline cache " << path << " is from another GPU or driver, rebuilding it" << std::endl;
+			return {};
+		}
+		return data;
+	}
+
+	void ModelViewerPipelineCache::save()
+	{
+		// Background compiles may grow the cache between the size query and the read, which
+		// then returns VK_INCOMPLETE with a truncated blob; query again in that case.
+		std::vector<char> data;
+		VkResult result = VK_INCOMPLETE;
+		for (int attempt = 0; attempt < kSaveAttempts && result == VK_INCOMPLETE; attempt++)
+		{
+			size_t size = 0;
+			if (vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to query pipeline cache size!");
+			}
+			// Pipelines are only ever added, so an unchanged size means nothing new was compiled.
+			if (size == savedSize)
+			{
+				return;
+			}
+
+			data.resize(size);
+			result = vkGetPipelineCacheData(device, pipelineCache, &size, data.data());
+			data.resize(size);
+		}
+		if (result == VK_INCOMPLETE)
+		{
+			// The next save picks up whatever is still compiling.
+			std::cout << "Pipeline cache " << path << " kept growing while saving, skipped writing it" << std::endl;
+			return;
+		}
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to read pipeline cache!");
+		}
+
+		const std::string tempPath = path + ".tmp";
+		{
+			std::ofstream out{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!out.is_open())
+			{
+				throw std::runtime_error("Failed to open pipeline cache for writing: " + tempPath);
+			}
+
+			out.write(data.data(), static_cast<std::streamsize>(data.size()));
+			if (!out.good())
+			{
+				out.close();
+				std::filesystem::remove(tempPath);
+				throw std::runtime_error("Failed to write pipeline cache: " + tempPath);
+			}
+		}
+
+		// Publish with a rename so a crash mid-write never leaves a truncated cache behind.
+		std::filesystem::rename(tempPath, path);
+		savedSize = data.size();
+	}
+} // namespace ModelViewer
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ModelViewer
+{
+	// The device's VkPipelineCache, shared by every pipeline and kept on disk between runs
+	// so later launches skip most of the shader compilation. The file is only used when
+	// its header matches this GPU's vendor, device and pipeline cache UUID, which changes
+	// with the driver; anything else starts an empty cache. The cache is written back on
+	// destruction through a temporary file and a rename, and only when it grew.
+	class ModelViewerPipelineCache
+	{
+	public:
+		static constexpr const char* DEFAULT_PATH = "pipeline_cache.bin";
+
+		ModelViewerPipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties, std::string path = DEFAULT_PATH);
+		~ModelViewerPipelineCache();
+
+		ModelViewerPipelineCache(const ModelViewerPipelineCache&) = delete;
+		ModelViewerPipelineCache& operator=(const ModelViewerPipelineCache&) = delete;
+
+		VkPipelineCache handle() const { return pipelineCache; }
+
+		// Writes the cache to disk if it changed since it was loaded or last saved.
+		void save();
+
+	private:
+		// The file's contents if its header matches properties, otherwise empty.
+		std::vector<char> readValidFile(const VkPhysicalDeviceProperties& properties) const;
+
+		VkDevice device;
+		const std::string path;
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		size_t savedSize = 0;
+	};
+} // namespace ModelViewer
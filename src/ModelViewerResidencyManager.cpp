@@ -0,0 +1,317 @@
+#include "ModelViewerResidencyManager.h"
+#include "ModelViewerDevice.h"
+#include "Loader/ModelViewerMeshCache.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr VkDeviceSize kSlotVertexBytes = sizeof(ModelViewerModel::PackedVertex) * ModelViewerResidencyManager::kPageVertices;
+		constexpr VkDeviceSize kSlotIndexBytes = sizeof(uint16_t) * ModelViewerResidencyManager::kPageIndices;
+		// Loads on the workers at once; more only queue up behind the disk.
+		constexpr uint32_t kMaxLoadsInFlight = 256;
+		// Queued pages not requested again within this many updates are no longer visible.
+		constexpr uint64_t kQueueTimeout = 8;
+	}
+
+	ModelViewerResidencyManager::ModelViewerResidencyManager(ModelViewerDevice& device, VkDeviceSize poolBytes, VkDeviceSize uploadBudget) :
+		device{ device }, poolBytes{ poolBytes }, uploadBudget{ uploadBudget }
+	{
+	}
+
+	ModelViewerResidencyManager::~ModelViewerResidencyManager()
+	{
+		// Loads capture this and write into the pool buffers.
+		if (ModelViewerJobSystem* jobSystem = ModelViewerJobSystem::current())
+		{
+			jobSystem->wait(loads);
+		}
+		if (vertexBuffer != VK_NULL_HANDLE)
+		{
+			device.destroyBuffer(vertexBuffer, vertexAllocation);
+			device.destroyBuffer(indexBuffer, indexAllocation);
+		}
+	}
+
+	void ModelViewerResidencyManager::createPool()
+	{
+		slotCount = static_cast<uint32_t>(std::min<VkDeviceSize>(poolBytes / (kSlotVertexBytes + kSlotIndexBytes), NOT_RESIDENT - 1));
+		if (slotCount == 0)
+		{
+			throw std::runtime_error("Residency pool too small for a single page!");
+		}
+
+		device.createBuffer(kSlotVertexBytes * slotCount,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			vertexBuffer,
+			vertexAllocation);
+
+		device.createBuffer(kSlotIndexBytes * slotCount,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			indexBuffer,
+			indexAllocation);
+
+		// Popped from the back, so slot 0 is handed out first.
+		freeSlots.resize(slotCount);
+		for (uint32_t slot = 0; slot < slotCount; slot++)
+		{
+			freeSlots[slot] = slotCount - 1 - slot;
+		}
+
+		std::cout << "Created residency pool: " << slotCount << " page slots, " << (kSlotVertexBytes + kSlotIndexBytes) * slotCount << " bytes" << std::endl;
+	}
+
+	uint32_t ModelViewerResidencyManager::registerPages(std::shared_ptr<const ModelViewerMeshCache> cache)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (vertexBuffer == VK_NULL_HANDLE)
+		{
+			createPool();
+		}
+
+		const uint32_t firstPage = static_cast<uint32_t>(pages.size());
+		const uint32_t count = static_cast<uint32_t>(cache->pages().size());
+		pages.resize(pages.size() + count);
+		pageSlots.resize(pages.size(), NOT_RESIDENT);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			pages[firstPage + i].cache = cache;
+			pages[firstPage + i].cachePage = i;
+		}
+		pageSlotsVersion++;
+		return firstPage;
+	}
+
+	void ModelViewerResidencyManager::unregisterPages(uint32_t firstPage, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		for (uint32_t id = firstPage; id < firstPage + count; id++)
+		{
+			Page& page = pages[id];
+			page.cache.reset();
+			// Queued pages are skipped when dequeued and loading ones when they finish.
+			if (page.state == PageState::Resident)
+			{
+				pageSlots[id] = NOT_RESIDENT;
+				releaseSlot(page.slot);
+				page.slot = NOT_RESIDENT;
+				page.state = PageState::Absent;
+				residentPages--;
+			}
+		}
+		pageSlotsVersion++;
+	}
+
+	void ModelViewerResidencyManager::releaseSlot(uint32_t slot)
+	{
+		releasingSlots++;
+		device.getDeletionQueue().push([this, slot]()
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				releasingSlots--;
+				freeSlots.push_back(slot);
+			});
+	}
+
+	void ModelViewerResidencyManager::update(std::span<const uint32_t> requestedPages)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		updateNumber++;
+
+		if (!loadedPages.empty())
+		{
+			const uint64_t ticket = device.submitUploads();
+			for (uint32_t id : loadedPages)
+			{
+				uploadingPages.emplace_back(id, ticket);
+			}
+			loadedPages.clear();
+		}
+
+		while (!uploadingPages.empty() && device.isUploadReady(uploadingPages.front().second))
+		{
+			const uint32_t id = uploadingPages.front().first;
+			uploadingPages.pop_front();
+			loadingPages--;
+
+			Page& page = pages[id];
+			if (!page.cache)
+			{
+				releaseSlot(page.slot);
+				page.slot = NOT_RESIDENT;
+				page.state = PageState::Absent;
+				continue;
+			}
+			page.state = PageState::Resident;
+			pageSlots[id] = page.slot;
+			residentPages++;
+			pageSlotsVersion++;
+		}
+
+		for (uint32_t id : requestedPages)
+		{
+			if (id >= pages.size() || !pages[id].cache)
+			{
+				continue;
+			}
+			Page& page = pages[id];
+			page.lastRequested = updateNumber;
+			if (page.state == PageState::Absent)
+			{
+				page.state = PageState::Queued;
+				queuedPages.push_back(id);
+				pageFaults++;
+				rateFaults++;
+			}
+		}
+
+		// Evicted slots only come back once the frames in flight stop drawing them, so the
+		// pool is trimmed ahead of the loads that will need the space.
+		if (queuedPages.size() > freeSlots.size() + releasingSlots)
+		{
+			evictLeastRecent(queuedPages.size() - freeSlots.size() - releasingSlots);
+		}
+
+		VkDeviceSize budget = uploadBudget;
+		while (!queuedPages.empty() && !freeSlots.empty() && budget > 0 && loadingPages < kMaxLoadsInFlight)
+		{
+			const uint32_t id = queuedPages.front();
+			queuedPages.pop_front();
+
+			Page& page = pages[id];
+			if (!page.cache || page.lastRequested + kQueueTimeout < updateNumber)
+			{
+				page.state = PageState::Absent;
+				continue;
+			}
+
+			const ModelViewerModel::ClusterPage& cachePage = page.cache->pages()[page.cachePage];
+			const VkDeviceSize bytes = sizeof(ModelViewerModel::PackedVertex) * cachePage.vertexCount + sizeof(uint16_t) * cachePage.indexCount;
+			budget -= std::min(budget, bytes);
+
+			const uint32_t slot = freeSlots.back();
+			freeSlots.pop_back();
+			startLoad(id, slot);
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		const float seconds = std::chrono::duration<float>(now - rateStart).count();
+		if (seconds >= 1.0f)
+		{
+			faultsPerSecond = static_cast<float>(rateFaults) / seconds;
+			uploadBytesPerSecond = static_cast<float>(rateBytes) / seconds;
+			rateFaults = 0;
+			rateBytes = 0;
+			rateStart = now;
+		}
+	}
+
+	void ModelViewerResidencyManager::startLoad(uint32_t pageId, uint32_t slot)
+	{
+		Page& page = pages[pageId];
+		page.state = PageState::Loading;
+		page.slot = slot;
+		loadingPages++;
+
+		const ModelViewerModel::ClusterPage& cachePage = page.cache->pages()[page.cachePage];
+		const VkDeviceSize vertexBytes = sizeof(ModelViewerModel::PackedVertex) * cachePage.vertexCount;
+		const VkDeviceSize indexBytes = sizeof(uint16_t) * cachePage.indexCount;
+		bytesUploaded += vertexBytes + indexBytes;
+		rateBytes += vertexBytes + indexBytes;
+
+		// Reading the mapping may fault in pages from disk, which is why this runs on a
+		// background worker. The job keeps the cache mapped even if the model goes away.
+		ModelViewerJobSystem::current()->runBackground(loads, [this, pageId, slot, vertexBytes, indexBytes, cache = page.cache, data = page.cache->pageData(cachePage)]()
+			{
+				device.uploadBuffer(vertexBuffer, kSlotVertexBytes * slot, data, vertexBytes);
+				device.uploadBuffer(indexBuffer, kSlotIndexBytes * slot, data + vertexBytes, indexBytes);
+
+				std::lock_guard<std::mutex> lock{ mutex };
+				loadedPages.push_back(pageId);
+			});
+	}
+
+	void ModelViewerResidencyManager::evictLeastRecent(size_t count)
+	{
+		// Pages the last frame used stay; the pool is too small for the view otherwise, and
+		// the missing pages wait for slots the camera leaves behind.
+		std::vector<uint32_t> candidates;
+		for (uint32_t id = 0; id < pages.size(); id++)
+		{
+			if (pages[id].state == PageState::Resident && pages[id].lastRequested < updateNumber)
+			{
+				candidates.push_back(id);
+			}
+		}
+		count = std::min(count, candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [this](uint32_t a, uint32_t b)
+			{
+				return pages[a].lastRequested < pages[b].lastRequested;
+			});
+
+		for (size_t i = 0; i < count; i++)
+		{
+			Page& page = pages[candidates[i]];
+			pageSlots[candidates[i]] = NOT_RESIDENT;
+			releaseSlot(page.slot);
+			page.slot = NOT_RESIDENT;
+			page.state = PageState::Absent;
+			residentPages--;
+			evictions++;
+		}
+		if (count != 0)
+		{
+			pageSlotsVersion++;
+		}
+	}
+
+	uint64_t ModelViewerResidencyManager::getPageSlotsVersion() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return pageSlotsVersion;
+	}
+
+	uint64_t ModelViewerResidencyManager::copyPageSlots(std::span<uint32_t> destination) const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		std::copy_n(pageSlots.begin(), std::min(destination.size(), pageSlots.size()), destination.begin());
+		return pageSlotsVersion;
+	}
+
+	uint32_t ModelViewerResidencyManager::getPageCount() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return static_cast<uint32_t>(pages.size());
+	}
+
+	void ModelViewerResidencyManager::bind(VkCommandBuffer commandBuffer)
+	{
+		VkBuffer buffers[] = { vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	}
+
+	ModelViewerResidencyManager::Stats ModelViewerResidencyManager::stats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Stats stats{};
+		stats.pageCount = static_cast<uint32_t>(pages.size());
+		stats.residentPages = residentPages;
+		stats.slotCount = slotCount;
+		stats.pendingLoads = static_cast<uint32_t>(queuedPages.size()) + loadingPages;
+		stats.pageFaults = pageFaults;
+		stats.evictions = evictions;
+		stats.bytesUploaded = bytesUploaded;
+		stats.faultsPerSecond = faultsPerSecond;
+		stats.uploadBytesPerSecond = uploadBytesPerSecond;
+		return stats;
+	}
+} // namespace ModelViewer
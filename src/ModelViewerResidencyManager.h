@@ -0,0 +1,149 @@
+#pragma once
+
+#include "ModelViewerAllocator.h"
+#include "Core/ModelViewerJobSystem.h"
+#include "Loader/ModelViewerMeshletBuilder.h"
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ModelViewer
+{
+	class ModelViewerDevice;
+	class ModelViewerMeshCache;
+
+	// Streams the meshlet pages of streamed models (see ModelViewerMeshCache's page
+	// sections) into a fixed size pool of equal slots in one vertex and one 16-bit index
+	// buffer, so a model only needs memory for what the camera sees. The GPU culling pass
+	// reports every page its visible meshlets used; update() refreshes those pages, loads
+	// the missing ones on background workers straight from the cache mapping into the
+	// staging ring, and evicts the least recently used pages once the pool runs out.
+	// The next update() submits the copies of loaded pages, which become resident once the
+	// staging ring reports them ready, so a frame never draws from a slot still uploading
+	// and never waits for a transfer queue upload either.
+	class ModelViewerResidencyManager
+	{
+	public:
+		static constexpr uint32_t NOT_RESIDENT = std::numeric_limits<uint32_t>::max();
+		static constexpr uint32_t kPageVertices = ModelViewerMeshletBuilder::kPageVertices;
+		static constexpr uint32_t kPageIndices = ModelViewerMeshletBuilder::kPageIndices;
+		static constexpr VkDeviceSize DEFAULT_POOL_BYTES = 256ull << 20;
+		// Bytes of page loads started per frame, which bounds the staging traffic.
+		static constexpr VkDeviceSize DEFAULT_UPLOAD_BUDGET = 16ull << 20;
+
+		struct Stats
+		{
+			uint32_t pageCount = 0;
+			uint32_t residentPages = 0;
+			uint32_t slotCount = 0;
+			uint32_t pendingLoads = 0;
+			uint64_t pageFaults = 0;
+			uint64_t evictions = 0;
+			uint64_t bytesUploaded = 0;
+			// Averaged over the last second.
+			float faultsPerSecond = 0.0f;
+			float uploadBytesPerSecond = 0.0f;
+		};
+
+		ModelViewerResidencyManager(ModelViewerDevice& device, VkDeviceSize poolBytes = DEFAULT_POOL_BYTES, VkDeviceSize uploadBudget = DEFAULT_UPLOAD_BUDGET);
+		~ModelViewerResidencyManager();
+
+		ModelViewerResidencyManager(const ModelViewerResidencyManager&) = delete;
+		ModelViewerResidencyManager& operator=(const ModelViewerResidencyManager&) = delete;
+
+		// Adds the pages of cache and returns the id of the first; ids are never reused.
+		// Creates the pool on first use. May be called from loader threads.
+		uint32_t registerPages(std::shared_ptr<const ModelViewerMeshCache> cache);
+		// Drops the pages; their slots return to the pool once in-flight frames completed.
+		void unregisterPages(uint32_t firstPage, uint32_t count);
+
+		// Called once per frame by the render thread with the pages a completed frame
+		// requested, in any order and with duplicates allowed.
+		void update(std::span<const uint32_t> requestedPages);
+
+		// Page id to slot table for the GPU, NOT_RESIDENT for missing pages. The version
+		// changes whenever the table does. copyPageSlots copies as many entries as fit, since
+		// pages registered after the caller sized its table are not drawn yet, and returns
+		// the version it copied.
+		uint64_t getPageSlotsVersion() const;
+		uint64_t copyPageSlots(std::span<uint32_t> destination) const;
+		uint32_t getPageCount() const;
+
+		// Binds the slot pool's vertex buffer to binding 0 and its index buffer.
+		void bind(VkCommandBuffer commandBuffer);
+
+		Stats stats() const;
+
+	private:
+		enum class PageState : uint8_t
+		{
+			Absent,
+			Queued,
+			Loading,
+			Resident,
+		};
+
+		struct Page
+		{
+			// Null once unregistered.
+			std::shared_ptr<const ModelViewerMeshCache> cache;
+			uint32_t cachePage = 0;
+			uint32_t slot = NOT_RESIDENT;
+			PageState state = PageState::Absent;
+			// update() call the page was last requested in.
+			uint64_t lastRequested = 0;
+		};
+
+		void createPool();
+		void startLoad(uint32_t pageId, uint32_t slot);
+		// Evicts up to count resident pages not requested this update, oldest first.
+		void evictLeastRecent(size_t count);
+		// Hands slot back once every frame that may draw from it has completed.
+		void releaseSlot(uint32_t slot);
+
+		ModelViewerDevice& device;
+		const VkDeviceSize poolBytes;
+		const VkDeviceSize uploadBudget;
+
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		ModelViewerAllocation vertexAllocation{};
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		ModelViewerAllocation indexAllocation{};
+		uint32_t slotCount = 0;
+
+		mutable std::mutex mutex;
+		std::vector<Page> pages;
+		std::vector<uint32_t> pageSlots;
+		uint64_t pageSlotsVersion = 0;
+		std::vector<uint32_t> freeSlots;
+		// Evicted slots waiting for the deletion queue.
+		uint32_t releasingSlots = 0;
+		std::deque<uint32_t> queuedPages;
+		std::vector<uint32_t> loadedPages;
+		// Page ids and the staging ring tickets of their copies, in submission order.
+		std::deque<std::pair<uint32_t, uint64_t>> uploadingPages;
+		uint32_t loadingPages = 0;
+		uint32_t residentPages = 0;
+		uint64_t updateNumber = 0;
+
+		uint64_t pageFaults = 0;
+		uint64_t evictions = 0;
+		uint64_t bytesUploaded = 0;
+		std::chrono::steady_clock::time_point rateStart = std::chrono::steady_clock::now();
+		uint64_t rateFaults = 0;
+		uint64_t rateBytes = 0;
+		float faultsPerSecond = 0.0f;
+		float uploadBytesPerSecond = 0.0f;
+
+		ModelViewerJobSystem::TaskGroup loads;
+	};
+} // namespace ModelViewer
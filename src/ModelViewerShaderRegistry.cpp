@@ -0,0 +1,124 @@
+#include "ModelViewerShaderRegistry.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr uint32_t kSpirvMagic = 0x07230203;
+
+		// glslc -mfmt=num output: the code words as comma separated literals.
+		constexpr uint32_t kSimpleShaderVert[] = {
+#include "shaders/generated/simple_shader.vert.inc"
+		};
+		constexpr uint32_t kSimpleShaderFrag[] = {
+#include "shaders/generated/simple_shader.frag.inc"
+		};
+		constexpr uint32_t kCullComp[] = {
+#include "shaders/generated/cull.comp.inc"
+		};
+		constexpr uint32_t kClusterCullComp[] = {
+#include "shaders/generated/cluster_cull.comp.inc"
+		};
+
+		struct EmbeddedShader
+		{
+			const char* name;
+			std::span<const uint32_t> code;
+		};
+
+		constexpr EmbeddedShader kEmbeddedShaders[] = {
+			{ "simple_shader.vert", kSimpleShaderVert },
+			{ "simple_shader.frag", kSimpleShaderFrag },
+			{ "cull.comp", kCullComp },
+			{ "cluster_cull.comp", kClusterCullComp },
+		};
+	}
+
+	ModelViewerShaderRegistry::ModelViewerShaderRegistry(VkDevice device) : device{ device }
+	{
+		if (const char* directory = std::getenv(OVERRIDE_VARIABLE))
+		{
+			overrideDirectory = directory;
+			std::cout << "Loading shaders from " << overrideDirectory << " where present" << std::endl;
+		}
+	}
+
+	ModelViewerShaderRegistry::~ModelViewerShaderRegistry()
+	{
+		for (const auto& [name, module] : modules)
+		{
+			vkDestroyShaderModule(device, module, nullptr);
+		}
+	}
+
+	std::vector<uint32_t> ModelViewerShaderRegistry::readOverride(const std::string& name) const
+	{
+		if (overrideDirectory.empty())
+		{
+			return {};
+		}
+
+		const std::filesystem::path path = std::filesystem::path{ overrideDirectory } / (name + ".spv");
+		std::ifstream file{ path, std::ios::ate | std::ios::binary };
+		if (!file.is_open())
+		{
+			return {};
+		}
+
+		const size_t fileSize = static_cast<size_t>(file.tellg());
+		std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(sizeof(uint32_t) * code.size()));
+
+		if (!file.good() || fileSize % sizeof(uint32_t) != 0 || code.empty() || code[0] != kSpirvMagic)
+		{
+			throw std::runtime_error("Invalid SPIR-V in shader override: " + path.string());
+		}
+		return code;
+	}
+
+	VkShaderModule ModelViewerShaderRegistry::getModule(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (auto it = modules.find(name); it != modules.end())
+		{
+			return it->second;
+		}
+
+		std::vector<uint32_t> overrideCode = readOverride(name);
+		std::span<const uint32_t> code = overrideCode;
+		if (code.empty())
+		{
+			for (const EmbeddedShader& shader : kEmbeddedShaders)
+			{
+				if (name == shader.name)
+				{
+					code = shader.code;
+				}
+			}
+		}
+		if (code.empty())
+		{
+			throw std::runtime_error("Unknown shader: " + name);
+		}
+
+		VkShaderModuleCreateInfo createInfo{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+		createInfo.codeSize = code.size_bytes();
+		createInfo.pCode = code.data();
+
+		VkShaderModule module = VK_NULL_HANDLE;
+		if (vkCreateShaderModule(device, &createInfo, nullptr, &module) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create shader module: " + name);
+		}
+		modules.emplace(name, module);
+		return module;
+	}
+} // namespace ModelViewer
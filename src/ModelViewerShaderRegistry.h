@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Shader modules by source name, e.g. "simple_shader.vert". The SPIR-V is compiled
+	// into the executable by scripts\CompileShaders.bat, which the build runs first, so
+	// nothing depends on the working directory. Each module is created on first use and
+	// shared by every pipeline until the device goes away. For shader development,
+	// MODELVIEWER_SHADER_DIR names a directory whose <name>.spv files take precedence.
+	// Safe to use from pipeline compiles on worker threads.
+	class ModelViewerShaderRegistry
+	{
+	public:
+		static constexpr const char* OVERRIDE_VARIABLE = "MODELVIEWER_SHADER_DIR";
+
+		explicit ModelViewerShaderRegistry(VkDevice device);
+		~ModelViewerShaderRegistry();
+
+		ModelViewerShaderRegistry(const ModelViewerShaderRegistry&) = delete;
+		ModelViewerShaderRegistry& operator=(const ModelViewerShaderRegistry&) = delete;
+
+		VkShaderModule getModule(const std::string& name);
+
+	private:
+		// The override file's code, or empty when there is none.
+		std::vector<uint32_t> readOverride(const std::string& name) const;
+
+		VkDevice device;
+		std::string overrideDirectory;
+
+		std::mutex mutex;
+		std::unordered_map<std::string, VkShaderModule> modules;
+	};
+} // namespace ModelViewer
@@ -0,0 +1,602 @@
+#include "ModelViewerStagingRing.h"
+#include "ModelViewerDevice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr VkDeviceSize kUploadAlignment = 16;
+
+		// Everything that reads uploaded data: vertex fetch, the culling passes and textures.
+		constexpr VkPipelineStageFlags kReadStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		constexpr VkAccessFlags kBufferReadAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		uint64_t alignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+	}
+
+	ModelViewerStagingRing::ModelViewerStagingRing(ModelViewerDevice& device, VkDeviceSize capacity) :
+		device{ device }, capacity_{ capacity }, renderThread{ std::this_thread::get_id() }
+	{
+		device.createBuffer(capacity_,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			buffer,
+			bufferAllocation,
+			ModelViewerAllocator::Strategy::Dedicated);
+		mapped = static_cast<char*>(bufferAllocation.mapped);
+
+		QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
+		graphicsFamily = indices.graphicsFamily;
+		transferQueue = device.transferQueue() != VK_NULL_HANDLE;
+		transferFamily = transferQueue ? indices.transferFamily : graphicsFamily;
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = transferFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create staging ring command pool!");
+		}
+
+		if (!transferQueue)
+		{
+			return;
+		}
+
+		poolInfo.queueFamilyIndex = graphicsFamily;
+		if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &acquirePool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create staging ring acquire command pool!");
+		}
+
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create staging ring timeline semaphore!");
+		}
+	}
+
+	ModelViewerStagingRing::~ModelViewerStagingRing()
+	{
+		waitIdle();
+
+		for (const Batch& batch : freeBatches)
+		{
+			vkDestroyFence(device.device(), batch.fence, nullptr);
+		}
+		for (const Acquire& acquire : freeAcquires)
+		{
+			vkDestroyFence(device.device(), acquire.fence, nullptr);
+		}
+
+		vkDestroySemaphore(device.device(), timeline, nullptr);
+		vkDestroyCommandPool(device.device(), acquirePool, nullptr);
+		vkDestroyCommandPool(device.device(), commandPool, nullptr);
+		device.destroyBuffer(buffer, bufferAllocation);
+	}
+
+	void ModelViewerStagingRing::upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+	{
+		const VkDeviceSize maxCopySize = capacity_ / 4;
+		const char* source = static_cast<const char*>(data);
+
+		std::unique_lock<std::mutex> lock{ mutex };
+		while (size > 0)
+		{
+			const VkDeviceSize copySize = std::min(size, maxCopySize);
+			const VkDeviceSize ringOffset = allocate(copySize, lock);
+
+			VkBufferCopy copyRegion{};
+			copyRegion.srcOffset = ringOffset;
+			copyRegion.dstOffset = dstOffset;
+			copyRegion.size = copySize;
+			vkCmdCopyBuffer(currentCommandBuffer(), buffer, dstBuffer, 1, &copyRegion);
+
+			// Allocating may have submitted the batch, so this goes into the current one.
+			recording.renderThreadUploads |= std::this_thread::get_id() == renderThread;
+			if (transferQueue)
+			{
+				// Chunked and back to back uploads release one range.
+				std::vector<VkBufferMemoryBarrier>& barriers = recording.bufferBarriers;
+				if (!barriers.empty() && barriers.back().buffer == dstBuffer && barriers.back().offset + barriers.back().size == dstOffset)
+				{
+					barriers.back().size += copySize;
+				}
+				else
+				{
+					VkBufferMemoryBarrier barrier{};
+					barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					barrier.srcQueueFamilyIndex = transferFamily;
+					barrier.dstQueueFamilyIndex = graphicsFamily;
+					barrier.buffer = dstBuffer;
+					barrier.offset = dstOffset;
+					barrier.size = copySize;
+					barriers.push_back(barrier);
+				}
+			}
+
+			// The batch is not submitted before its data is in, so the range stays ours
+			// while other threads reserve and record behind it.
+			recording.pendingCopies++;
+			lock.unlock();
+			std::memcpy(mapped + ringOffset, source, static_cast<size_t>(copySize));
+			lock.lock();
+			finishCopy();
+
+			source += copySize;
+			dstOffset += copySize;
+			size -= copySize;
+		}
+	}
+
+	void ModelViewerStagingRing::uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void* data, VkDeviceSize size)
+	{
+		// Copies into an image cannot be split by bytes like buffer copies.
+		if (size > capacity_ / 4)
+		{
+			throw std::runtime_error("Image too large for the staging ring!");
+		}
+
+		std::unique_lock<std::mutex> lock{ mutex };
+		const VkDeviceSize ringOffset = allocate(size, lock);
+		VkCommandBuffer commandBuffer = currentCommandBuffer();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layerCount };
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = ringOffset;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, layerCount };
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { width, height, 1 };
+		vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		// The transition to the sampled layout is part of the release on the transfer queue.
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = transferQueue ? 0 : VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		if (transferQueue)
+		{
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+		}
+		recording.imageBarriers.push_back(barrier);
+		recording.renderThreadUploads |= std::this_thread::get_id() == renderThread;
+
+		recording.pendingCopies++;
+		lock.unlock();
+		std::memcpy(mapped + ringOffset, data, static_cast<size_t>(size));
+		lock.lock();
+		finishCopy();
+	}
+
+	VkDeviceSize ModelViewerStagingRing::allocate(VkDeviceSize size, std::unique_lock<std::mutex>& lock)
+	{
+		for (;;)
+		{
+			// Recomputed after every wait, since other threads reserve while the lock is released.
+			uint64_t offset = alignUp(head, kUploadAlignment);
+			if (offset % capacity_ + size > capacity_)
+			{
+				offset += capacity_ - offset % capacity_;
+			}
+
+			if (offset + size - tail > capacity_ && recording.commandBuffer == VK_NULL_HANDLE && inFlight.empty())
+			{
+				// Nothing references the ring any more, so the skipped space is free too.
+				tail = offset;
+			}
+			if (offset + size - tail <= capacity_)
+			{
+				head = offset + size;
+				return static_cast<VkDeviceSize>(offset % capacity_);
+			}
+
+			submitRecording(lock);
+			waitForOldest(lock);
+		}
+	}
+
+	void ModelViewerStagingRing::finishCopy()
+	{
+		if (--recording.pendingCopies == 0)
+		{
+			copiesFinished.notify_all();
+		}
+	}
+
+	VkCommandBuffer ModelViewerStagingRing::currentCommandBuffer()
+	{
+		if (recording.commandBuffer != VK_NULL_HANDLE)
+		{
+			return recording.commandBuffer;
+		}
+
+		retire();
+
+		if (!freeBatches.empty() && fenceWaiters == 0)
+		{
+			recording = std::move(freeBatches.back());
+			freeBatches.pop_back();
+			if (recording.fence != VK_NULL_HANDLE)
+			{
+				vkResetFences(device.device(), 1, &recording.fence);
+			}
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = commandPool;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, &recording.commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to allocate staging ring command buffer!");
+			}
+
+			VkFenceCreateInfo fenceInfo{};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+			if (!transferQueue && vkCreateFence(device.device(), &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create staging ring fence!");
+			}
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(recording.commandBuffer, &beginInfo);
+		return recording.commandBuffer;
+	}
+
+	uint64_t ModelViewerStagingRing::submit()
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		submitRecording(lock);
+		return submittedValue;
+	}
+
+	bool ModelViewerStagingRing::isReady(uint64_t ticket)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (!transferQueue)
+		{
+			return ticket <= submittedValue;
+		}
+		retire();
+		return ticket <= completedValue;
+	}
+
+	void ModelViewerStagingRing::flush()
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		submitRecording(lock);
+		if (!transferQueue)
+		{
+			return;
+		}
+
+		// Batches still running for other threads are picked up by a later frame, once they
+		// completed, so the frame only waits for the render thread's own uploads.
+		recycleAcquires(false);
+		retire();
+		acquireReleased(std::max(completedValue, renderThreadValue));
+	}
+
+	void ModelViewerStagingRing::submitRecording(std::unique_lock<std::mutex>& lock)
+	{
+		// Copies into the batch's ranges run without the lock; the batch keeps collecting
+		// uploads until they are all in.
+		copiesFinished.wait(lock, [this] { return recording.pendingCopies == 0; });
+		if (recording.commandBuffer == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		if (transferQueue)
+		{
+			// Releases only make the copies available; the acquire in flush() makes them
+			// visible to the graphics queue.
+			vkCmdPipelineBarrier(recording.commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0, 0, nullptr,
+				static_cast<uint32_t>(recording.bufferBarriers.size()), recording.bufferBarriers.data(),
+				static_cast<uint32_t>(recording.imageBarriers.size()), recording.imageBarriers.data());
+		}
+		else
+		{
+			// One global barrier covers every copy in the batch, including storage buffers read
+			// by the culling compute pass.
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = kBufferReadAccess;
+			vkCmdPipelineBarrier(recording.commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				kReadStages,
+				0, 1, &barrier, 0, nullptr,
+				static_cast<uint32_t>(recording.imageBarriers.size()), recording.imageBarriers.data());
+		}
+
+		if (vkEndCommandBuffer(recording.commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record staging ring command buffer!");
+		}
+
+		recording.value = submittedValue + 1;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &recording.value;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &recording.commandBuffer;
+		if (transferQueue)
+		{
+			submitInfo.pNext = &timelineInfo;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &timeline;
+		}
+
+		{
+			auto queueLock = device.lockQueue();
+			if (vkQueueSubmit(transferQueue ? device.transferQueue() : device.graphicsQueue(), 1, &submitInfo, recording.fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit staging ring uploads!");
+			}
+		}
+		submittedValue = recording.value;
+
+		if (transferQueue)
+		{
+			released.push_back({ recording.value, std::move(recording.bufferBarriers), std::move(recording.imageBarriers) });
+		}
+		recording.bufferBarriers.clear();
+		recording.imageBarriers.clear();
+		if (recording.renderThreadUploads)
+		{
+			renderThreadValue = recording.value;
+		}
+
+		recording.ringEnd = head;
+		inFlight.push_back(std::move(recording));
+		recording = {};
+	}
+
+	void ModelViewerStagingRing::acquireReleased(uint64_t upTo)
+	{
+		if (released.empty() || released.front().value > upTo)
+		{
+			return;
+		}
+
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		uint64_t waitValue = 0;
+		while (!released.empty() && released.front().value <= upTo)
+		{
+			// Acquires repeat the releases with the access of the graphics queue.
+			for (VkBufferMemoryBarrier barrier : released.front().bufferBarriers)
+			{
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = kBufferReadAccess;
+				bufferBarriers.push_back(barrier);
+			}
+			for (VkImageMemoryBarrier barrier : released.front().imageBarriers)
+			{
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+				imageBarriers.push_back(barrier);
+			}
+			waitValue = released.front().value;
+			released.pop_front();
+		}
+
+		Acquire acquire = beginAcquire();
+		// The semaphore wait blocks the same stages, which chains it to the barrier.
+		vkCmdPipelineBarrier(acquire.commandBuffer,
+			kReadStages,
+			kReadStages,
+			0, 0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+		if (vkEndCommandBuffer(acquire.commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record staging ring acquire command buffer!");
+		}
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = 1;
+		timelineInfo.pWaitSemaphoreValues = &waitValue;
+
+		const VkPipelineStageFlags waitStages = kReadStages;
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &timeline;
+		submitInfo.pWaitDstStageMask = &waitStages;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &acquire.commandBuffer;
+
+		{
+			auto queueLock = device.lockQueue();
+			if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, acquire.fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit staging ring acquire!");
+			}
+		}
+		acquiresInFlight.push_back(acquire);
+	}
+
+	ModelViewerStagingRing::Acquire ModelViewerStagingRing::beginAcquire()
+	{
+		Acquire acquire{};
+		if (!freeAcquires.empty())
+		{
+			acquire = freeAcquires.back();
+			freeAcquires.pop_back();
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = acquirePool;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, &acquire.commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to allocate staging ring acquire command buffer!");
+			}
+
+			VkFenceCreateInfo fenceInfo{};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+			if (vkCreateFence(device.device(), &fenceInfo, nullptr, &acquire.fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create staging ring acquire fence!");
+			}
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(acquire.commandBuffer, &beginInfo);
+		return acquire;
+	}
+
+	void ModelViewerStagingRing::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		submitRecording(lock);
+		while (!inFlight.empty())
+		{
+			waitForOldest(lock);
+		}
+		recycleAcquires(true);
+	}
+
+	void ModelViewerStagingRing::waitForOldest(std::unique_lock<std::mutex>& lock)
+	{
+		if (inFlight.empty())
+		{
+			return;
+		}
+
+		// Other threads keep uploading into free space meanwhile, and may retire the batch
+		// first, which retire() copes with.
+		if (transferQueue)
+		{
+			const uint64_t value = inFlight.front().value;
+			lock.unlock();
+
+			VkSemaphoreWaitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &timeline;
+			waitInfo.pValues = &value;
+			vkWaitSemaphores(device.device(), &waitInfo, UINT64_MAX);
+			lock.lock();
+		}
+		else
+		{
+			const VkFence fence = inFlight.front().fence;
+			fenceWaiters++;
+			lock.unlock();
+			vkWaitForFences(device.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+			lock.lock();
+			fenceWaiters--;
+		}
+
+		retire();
+	}
+
+	void ModelViewerStagingRing::retire()
+	{
+		if (transferQueue && !inFlight.empty())
+		{
+			vkGetSemaphoreCounterValue(device.device(), timeline, &completedValue);
+		}
+
+		while (!inFlight.empty())
+		{
+			Batch& batch = inFlight.front();
+			if (transferQueue ? batch.value > completedValue : vkGetFenceStatus(device.device(), batch.fence) != VK_SUCCESS)
+			{
+				break;
+			}
+
+			// The fence stays signalled until the batch is reused, see fenceWaiters.
+			tail = batch.ringEnd;
+			completedValue = std::max(completedValue, batch.value);
+			vkResetCommandBuffer(batch.commandBuffer, 0);
+			batch.renderThreadUploads = false;
+			freeBatches.push_back(std::move(batch));
+			inFlight.pop_front();
+		}
+	}
+
+	void ModelViewerStagingRing::recycleAcquires(bool wait)
+	{
+		while (!acquiresInFlight.empty())
+		{
+			Acquire acquire = acquiresInFlight.front();
+			if (wait)
+			{
+				vkWaitForFences(device.device(), 1, &acquire.fence, VK_TRUE, UINT64_MAX);
+			}
+			else if (vkGetFenceStatus(device.device(), acquire.fence) != VK_SUCCESS)
+			{
+				break;
+			}
+
+			vkResetFences(device.device(), 1, &acquire.fence);
+			vkResetCommandBuffer(acquire.commandBuffer, 0);
+			freeAcquires.push_back(acquire);
+			acquiresInFlight.pop_front();
+		}
+	}
+} // namespace ModelViewer
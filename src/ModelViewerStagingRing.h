@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ModelViewerAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ModelViewer
+{
+	class ModelViewerDevice;
+
+	// Persistently mapped host-visible ring used for all buffer uploads. Data is copied
+	// into the ring immediately and the GPU copy is recorded into a shared batch command
+	// buffer; batches are submitted on flush() or submit() and their ring space is
+	// reclaimed once they complete, so uploads never wait for the queue to drain. Safe to
+	// use from loader threads alongside the render loop: the mutex only covers reserving
+	// ring space and recording, while the copies into the ring and any wait for the GPU to
+	// free space run without it.
+	//
+	// On devices with a transfer-only queue family the batches run there, overlapping the
+	// frames on the graphics queue. Each batch signals the next value of a timeline
+	// semaphore and releases the ranges it wrote to the graphics family; flush() acquires
+	// them back on the graphics queue, waiting on the timeline only for batches the next
+	// frame needs. Everything else submits to the graphics queue as before.
+	class ModelViewerStagingRing
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_CAPACITY = 64ull * 1024 * 1024;
+
+		// The thread creating the ring is the render thread that calls flush().
+		ModelViewerStagingRing(ModelViewerDevice& device, VkDeviceSize capacity = DEFAULT_CAPACITY);
+		~ModelViewerStagingRing();
+
+		ModelViewerStagingRing(const ModelViewerStagingRing&) = delete;
+		ModelViewerStagingRing& operator=(const ModelViewerStagingRing&) = delete;
+
+		// Copies size bytes into the ring and records a copy to dstBuffer. Uploads larger
+		// than a quarter of the ring are split into several copies.
+		void upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+		// Same for every layer of an image's first mip level, tightly packed. The image
+		// ends up in SHADER_READ_ONLY_OPTIMAL; its previous contents are discarded.
+		void uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void* data, VkDeviceSize size);
+
+		// Submits the pending batch from any thread and returns a ticket for everything
+		// uploaded so far. Threads other than the render thread use it to start large
+		// uploads right away and to find out when they are ready to draw.
+		uint64_t submit();
+		// True once a frame submitted after the next flush() can use the ticket's uploads
+		// without waiting. On the graphics queue that is as soon as they are submitted.
+		bool isReady(uint64_t ticket);
+
+		// Render thread only. Submits the pending batch and makes the uploads ready by now,
+		// and everything the render thread uploaded itself, visible to vertex input,
+		// compute and fragment shaders for every later submission on the graphics queue,
+		// so call this before submitting a frame.
+		void flush();
+
+		// Flushes and blocks until every submitted batch has completed.
+		void waitIdle();
+
+		VkDeviceSize capacity() const { return capacity_; }
+		VkDeviceSize bytesInFlight() const { return head - tail; }
+		bool usesTransferQueue() const { return transferQueue; }
+
+	private:
+		struct Batch
+		{
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			// Only without the transfer queue; batches there complete at their timeline value.
+			VkFence fence = VK_NULL_HANDLE;
+			uint64_t value = 0;
+			uint64_t ringEnd = 0;
+			// Ranges reserved in the batch whose data is still being copied in; the batch is
+			// only submitted once this drops to zero.
+			uint32_t pendingCopies = 0;
+			// Holds uploads of the render thread, which its next flush() has to wait for.
+			bool renderThreadUploads = false;
+			// Ownership releases on the transfer queue, or layout transitions on the graphics
+			// queue, recorded when the batch is submitted.
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+		};
+
+		// Submitted batches whose ranges the graphics queue has not acquired yet.
+		struct Release
+		{
+			uint64_t value = 0;
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+		};
+
+		// Graphics queue command buffers acquiring released ranges.
+		struct Acquire
+		{
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+		};
+
+		// The private helpers expect mutex to be held. Those taking the lock release it while
+		// they wait for copies into the ring or for the GPU.
+		void submitRecording(std::unique_lock<std::mutex>& lock);
+		// Acquires every batch released up to the value upTo on the graphics queue.
+		void acquireReleased(uint64_t upTo);
+		Acquire beginAcquire();
+		VkDeviceSize allocate(VkDeviceSize size, std::unique_lock<std::mutex>& lock);
+		// Called once the data of a range reserved in the recording batch is copied in.
+		void finishCopy();
+		VkCommandBuffer currentCommandBuffer();
+		void retire();
+		// Blocks until the oldest batch in flight has completed, then retires.
+		void waitForOldest(std::unique_lock<std::mutex>& lock);
+		void recycleAcquires(bool wait);
+
+		ModelViewerDevice& device;
+		VkDeviceSize capacity_;
+		std::mutex mutex;
+		std::condition_variable copiesFinished;
+		const std::thread::id renderThread;
+		bool transferQueue = false;
+		uint32_t transferFamily = 0;
+		uint32_t graphicsFamily = 0;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		ModelViewerAllocation bufferAllocation{};
+		char* mapped = nullptr;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkCommandPool acquirePool = VK_NULL_HANDLE;
+		VkSemaphore timeline = VK_NULL_HANDLE;
+
+		// Monotonic byte counters; the ring offset is counter % capacity.
+		uint64_t head = 0;
+		uint64_t tail = 0;
+		// Batch values; the timeline semaphore's on the transfer queue.
+		uint64_t submittedValue = 0;
+		uint64_t completedValue = 0;
+		// Latest batch holding render thread uploads.
+		uint64_t renderThreadValue = 0;
+		// Threads waiting on a batch fence without the mutex. Free batches keep their
+		// signalled fences until none are, so a fence is never reset under a waiter.
+		uint32_t fenceWaiters = 0;
+
+		Batch recording{};
+		std::deque<Batch> inFlight;
+		std::vector<Batch> freeBatches;
+		std::deque<Release> released;
+		std::deque<Acquire> acquiresInFlight;
+		std::vector<Acquire> freeAcquires;
+	};
+} // namespace ModelViewer
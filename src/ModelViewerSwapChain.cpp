@@ -1,5 +1,6 @@
 #include "ModelViewerSwapChain.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -10,15 +11,23 @@
 
 namespace ModelViewer {
 
-	ModelViewerSwapChain::ModelViewerSwapChain(ModelViewerDevice& deviceRef, VkExtent2D extent)
-		: device{ deviceRef }, windowExtent{ extent } 
+	namespace
+	{
+		// Bounds the low-latency wait, since a hidden window may never present again.
+		constexpr uint64_t kPresentWaitTimeout = 100'000'000;
+		// Presents tracked for latency; older ones are dropped if presents stop completing.
+		constexpr size_t kMaxPendingPresents = 16;
+	}
+
+	ModelViewerSwapChain::ModelViewerSwapChain(ModelViewerDevice& deviceRef, VkExtent2D extent, FramePacing framePacing)
+		: device{ deviceRef }, windowExtent{ extent }, framePacing{ framePacing }
 	{
 		init();
 	}
 
 	ModelViewerSwapChain::ModelViewerSwapChain(
-		ModelViewerDevice& deviceRef, VkExtent2D extent, std::shared_ptr<ModelViewerSwapChain> previous)
-		: device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous } 
+		ModelViewerDevice& deviceRef, VkExtent2D extent, FramePacing framePacing, std::shared_ptr<ModelViewerSwapChain> previous)
+		: device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous }, framePacing{ framePacing }
 	{
 		init();
 		oldSwapChain = nullptr;
@@ -26,6 +35,22 @@ namespace ModelViewer {
 
 	void ModelViewerSwapChain::init() 
 	{
+		switch (framePacing)
+		{
+		case FramePacing::LowLatency:
+			framesInFlight_ = 1;
+			break;
+		case FramePacing::Throughput:
+			framesInFlight_ = 3;
+			break;
+		case FramePacing::Uncapped:
+			framesInFlight_ = 2;
+			break;
+		}
+		// Presents are only waited for under low-latency pacing, but every policy uses
+		// present ids to measure latency to the display.
+		usePresentWait = device.getCapabilities().presentWait;
+
 		createSwapChain();
 		createImageViews();
 		createRenderPass();
@@ -51,8 +76,7 @@ namespace ModelViewer {
 		for (int i = 0; i < depthImages.size(); i++) 
 		{
 			vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-			vkDestroyImage(device.device(), depthImages[i], nullptr);
-			vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+			device.destroyImage(depthImages[i], depthImageAllocations[i]);
 		}
 
 		for (auto framebuffer : swapChainFramebuffers) 
@@ -71,6 +95,40 @@ namespace ModelViewer {
 		}
 	}
 
+	void ModelViewerSwapChain::waitForPresent()
+	{
+		if (!usePresentWait)
+		{
+			return;
+		}
+
+		if (framePacing == FramePacing::LowLatency && presentId > 0)
+		{
+			device.waitForPresent(swapChain, presentId, kPresentWaitTimeout);
+		}
+
+		while (!pendingPresents.empty() && device.waitForPresent(swapChain, pendingPresents.front().first, 0) == VK_SUCCESS)
+		{
+			recordLatency(pendingPresents.front().second);
+			pendingPresents.pop_front();
+		}
+	}
+
+	void ModelViewerSwapChain::recordLatency(std::chrono::steady_clock::time_point inputTime)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		latencySum += std::chrono::duration<double, std::milli>(now - inputTime).count();
+		latencySamples++;
+
+		if (now - latencyWindowStart >= std::chrono::seconds{ 1 })
+		{
+			averageLatency = static_cast<float>(latencySum / latencySamples);
+			latencySum = 0.0;
+			latencySamples = 0;
+			latencyWindowStart = now;
+		}
+	}
+
 	VkResult ModelViewerSwapChain::acquireNextImage(uint32_t* imageIndex) 
 	{
 		vkWaitForFences(
@@ -91,7 +149,8 @@ namespace ModelViewer {
 		return result;
 	}
 
-	VkResult ModelViewerSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) 
+	VkResult ModelViewerSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex,
+		std::chrono::steady_clock::time_point inputTime) 
 	{
 		if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) 
 		{
@@ -115,6 +174,7 @@ namespace ModelViewer {
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
+		auto queueLock = device.lockQueue();
 		vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
 		if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
 			VK_SUCCESS) 
@@ -134,9 +194,33 @@ namespace ModelViewer {
 
 		presentInfo.pImageIndices = imageIndex;
 
+		const uint64_t nextPresentId = presentId + 1;
+		VkPresentIdKHR presentIdInfo = {};
+		if (usePresentWait)
+		{
+			presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+			presentIdInfo.swapchainCount = 1;
+			presentIdInfo.pPresentIds = &nextPresentId;
+			presentInfo.pNext = &presentIdInfo;
+		}
+
 		auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		if (usePresentWait)
+		{
+			presentId = nextPresentId;
+			if (pendingPresents.size() == kMaxPendingPresents)
+			{
+				pendingPresents.pop_front();
+			}
+			pendingPresents.emplace_back(presentId, inputTime);
+		}
+		else
+		{
+			recordLatency(inputTime);
+		}
+
+		currentFrame = (currentFrame + 1) % framesInFlight_;
 
 		return result;
 	}
@@ -146,10 +230,11 @@ namespace ModelViewer {
 		SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
 		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-		VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+		presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 		VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-		uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+		// An image for every frame in flight keeps them from waiting on each other's images.
+		uint32_t imageCount = std::max(swapChainSupport.capabilities.minImageCount + 1, framesInFlight_);
 		if (swapChainSupport.capabilities.maxImageCount > 0 &&
 			imageCount > swapChainSupport.capabilities.maxImageCount) 
 		{
@@ -330,7 +415,7 @@ namespace ModelViewer {
 		VkExtent2D swapChainExtent = getSwapChainExtent();
 
 		depthImages.resize(imageCount());
-		depthImageMemorys.resize(imageCount());
+		depthImageAllocations.resize(imageCount());
 		depthImageViews.resize(imageCount());
 
 		for (int i = 0; i < depthImages.size(); i++) 
@@ -355,7 +440,7 @@ namespace ModelViewer {
 				imageInfo,
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 				depthImages[i],
-				depthImageMemorys[i]);
+				depthImageAllocations[i]);
 
 			VkImageViewCreateInfo viewInfo{};
 			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -418,24 +503,53 @@ namespace ModelViewer {
 	VkPresentModeKHR ModelViewerSwapChain::chooseSwapPresentMode(
 		const std::vector<VkPresentModeKHR>& availablePresentModes) 
 	{
-		for (const auto& availablePresentMode : availablePresentModes) 
+		// Modes to try in order; FIFO is always supported.
+		std::vector<VkPresentModeKHR> preferredModes;
+		switch (framePacing)
+		{
+		case FramePacing::LowLatency:
+			// Waiting for each present keeps the FIFO queue empty. Without present wait,
+			// mailbox replaces queued images instead of letting them pile up.
+			if (!usePresentWait)
+			{
+				preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR };
+			}
+			break;
+		case FramePacing::Throughput:
+			preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR };
+			break;
+		case FramePacing::Uncapped:
+			preferredModes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+			break;
+		}
+
+		VkPresentModeKHR chosenMode = VK_PRESENT_MODE_FIFO_KHR;
+		for (VkPresentModeKHR preferredMode : preferredModes)
 		{
-			if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) 
+			if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferredMode) != availablePresentModes.end())
 			{
-				std::cout << "Present mode: Mailbox" << std::endl;
-				return availablePresentMode;
+				chosenMode = preferredMode;
+				break;
 			}
 		}
 
-		// for (const auto &availablePresentMode : availablePresentModes) {
-		//   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-		//     std::cout << "Present mode: Immediate" << std::endl;
-		//     return availablePresentMode;
-		//   }
-		// }
+		std::cout << "Present mode: " << presentModeName(chosenMode) << ", " << framesInFlight_ << " frames in flight" << std::endl;
+		return chosenMode;
+	}
 
-		std::cout << "Present mode: V-Sync" << std::endl;
-		return VK_PRESENT_MODE_FIFO_KHR;
+	const char* ModelViewerSwapChain::presentModeName(VkPresentModeKHR mode)
+	{
+		switch (mode)
+		{
+		case VK_PRESENT_MODE_IMMEDIATE_KHR:
+			return "Immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR:
+			return "Mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR:
+			return "V-Sync";
+		default:
+			return "Other";
+		}
 	}
 
 	VkExtent2D ModelViewerSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) 
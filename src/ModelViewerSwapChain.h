@@ -6,19 +6,37 @@
 #include <vulkan/vulkan.h>
 
 // STDLIB Headers
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace ModelViewer {
 
+	// Trade-off between input latency and frame rate, fixed for the life of a swap chain.
+	enum class FramePacing : uint32_t
+	{
+		// One frame in flight. With VK_KHR_present_wait, presents are FIFO and the next
+		// frame only samples input once the previous one reached the display; without it,
+		// mailbox where available.
+		LowLatency,
+		// Three frames in flight, mailbox where available.
+		Throughput,
+		// Two frames in flight, immediate presents that may tear.
+		Uncapped,
+	};
+
 	class ModelViewerSwapChain {
 	public:
-		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+		// Frame slots every per-frame resource is sized for; the pacing uses 1 to this many.
+		static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
-		ModelViewerSwapChain(ModelViewerDevice& deviceRef, VkExtent2D windowExtent);
+		ModelViewerSwapChain(ModelViewerDevice& deviceRef, VkExtent2D windowExtent, FramePacing framePacing = FramePacing::Throughput);
 		ModelViewerSwapChain(
-			ModelViewerDevice& deviceRef, VkExtent2D windowExtent, std::shared_ptr<ModelViewerSwapChain> previous);
+			ModelViewerDevice& deviceRef, VkExtent2D windowExtent, FramePacing framePacing, std::shared_ptr<ModelViewerSwapChain> previous);
 
 		~ModelViewerSwapChain();
 
@@ -41,8 +59,25 @@ namespace ModelViewer {
 		}
 		VkFormat findDepthFormat();
 
+		FramePacing getFramePacing() const { return framePacing; }
+		uint32_t framesInFlight() const { return framesInFlight_; }
+		VkPresentModeKHR getPresentMode() const { return presentMode; }
+		static const char* presentModeName(VkPresentModeKHR mode);
+
+		// Call before sampling input for a frame. Under low-latency pacing with present wait,
+		// blocks until the last frame reached the display; always collects the latency of
+		// the presents completed since the last call.
+		void waitForPresent();
+		// Input to present latency in milliseconds, averaged over the last second. With
+		// present wait it runs until the image was displayed, as observed by the next
+		// waitForPresent(); otherwise until vkQueuePresentKHR returned.
+		float getLatency() const { return averageLatency; }
+		bool measuresDisplayLatency() const { return usePresentWait; }
+
 		VkResult acquireNextImage(uint32_t* imageIndex);
-		VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+		// inputTime is when the input the frame reflects was sampled.
+		VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex,
+			std::chrono::steady_clock::time_point inputTime);
 
 		bool compareSwapFormats(const ModelViewerSwapChain& swapChain) const {
 			return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
@@ -64,6 +99,7 @@ namespace ModelViewer {
 		VkPresentModeKHR chooseSwapPresentMode(
 			const std::vector<VkPresentModeKHR>& availablePresentModes);
 		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+		void recordLatency(std::chrono::steady_clock::time_point inputTime);
 
 		VkFormat swapChainImageFormat;
 		VkFormat swapChainDepthFormat;
@@ -73,7 +109,7 @@ namespace ModelViewer {
 		VkRenderPass renderPass;
 
 		std::vector<VkImage> depthImages;
-		std::vector<VkDeviceMemory> depthImageMemorys;
+		std::vector<ModelViewerAllocation> depthImageAllocations;
 		std::vector<VkImageView> depthImageViews;
 		std::vector<VkImage> swapChainImages;
 		std::vector<VkImageView> swapChainImageViews;
@@ -89,6 +125,20 @@ namespace ModelViewer {
 		std::vector<VkFence> inFlightFences;
 		std::vector<VkFence> imagesInFlight;
 		size_t currentFrame = 0;
+
+		const FramePacing framePacing;
+		uint32_t framesInFlight_ = MAX_FRAMES_IN_FLIGHT;
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+		bool usePresentWait = false;
+
+		// Id of the last present, and the presents not known to be displayed yet with the
+		// input time of their frames.
+		uint64_t presentId = 0;
+		std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> pendingPresents;
+		std::chrono::steady_clock::time_point latencyWindowStart = std::chrono::steady_clock::now();
+		double latencySum = 0.0;
+		uint32_t latencySamples = 0;
+		float averageLatency = 0.0f;
 	};
 
 }  // namespace ModelViewer
@@ -0,0 +1,70 @@
+#include "ModelViewerVertexFormat.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		float signNotZero(float value)
+		{
+			return value >= 0.0f ? 1.0f : -1.0f;
+		}
+	}
+
+	std::array<int16_t, 2> VertexEncoding::octahedralSnorm16(const glm::vec3& normal)
+	{
+		const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (length == 0.0f)
+		{
+			// Missing normals still decode to a unit vector.
+			return { 0, 0 };
+		}
+
+		const glm::vec3 n = normal / length;
+		float x = n.x;
+		float y = n.y;
+		if (n.z < 0.0f)
+		{
+			// Fold the lower hemisphere over the diagonals.
+			x = (1.0f - std::abs(n.y)) * signNotZero(n.x);
+			y = (1.0f - std::abs(n.x)) * signNotZero(n.y);
+		}
+		return { snorm16(x), snorm16(y) };
+	}
+
+	glm::vec3 VertexEncoding::decodeOctahedral(const glm::vec2& encoded)
+	{
+		glm::vec3 n{ encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y) };
+		if (n.z < 0.0f)
+		{
+			const float x = (1.0f - std::abs(n.y)) * signNotZero(n.x);
+			n.y = (1.0f - std::abs(n.x)) * signNotZero(n.y);
+			n.x = x;
+		}
+		return glm::normalize(n);
+	}
+
+	uint16_t VertexEncoding::unorm16(float value)
+	{
+		return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	int16_t VertexEncoding::snorm16(float value)
+	{
+		return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	uint8_t VertexEncoding::unorm8(float value)
+	{
+		return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+	}
+
+	uint16_t VertexEncoding::half(float value)
+	{
+		return glm::packHalf1x16(value);
+	}
+} // namespace ModelViewer
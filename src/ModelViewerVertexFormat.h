@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Size of one element of a vertex attribute format; 0 for formats no layout uses.
+	constexpr uint32_t vertexFormatSize(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R8G8_SNORM:
+			return 2;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SNORM:
+		case VK_FORMAT_R16G16_UNORM:
+		case VK_FORMAT_R16G16_SNORM:
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_R32_SFLOAT:
+			return 4;
+		case VK_FORMAT_R16G16B16A16_UNORM:
+		case VK_FORMAT_R16G16B16A16_SNORM:
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_R32G32_SFLOAT:
+			return 8;
+		case VK_FORMAT_R32G32B32_SFLOAT:
+			return 12;
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	// One shader input of a vertex type. Matrices span locationCount consecutive
+	// locations, one format element each.
+	struct VertexField
+	{
+		uint32_t location;
+		VkFormat format;
+		uint32_t offset;
+		uint32_t locationCount = 1;
+	};
+
+	// A vertex type lists its shader inputs in a static constexpr fields() function, which
+	// can use offsetof because member function bodies see the complete type, and states
+	// whether it advances per vertex or per instance.
+	template<typename T>
+	concept VertexLayout = requires
+	{
+		{ T::kInputRate } -> std::convertible_to<VkVertexInputRate>;
+		T::fields().size();
+	};
+
+	template<VertexLayout T>
+	constexpr size_t vertexAttributeCount()
+	{
+		size_t count = 0;
+		for (const VertexField& field : T::fields())
+		{
+			count += field.locationCount;
+		}
+		return count;
+	}
+
+	// Every field must use a known format and lie inside the struct.
+	template<VertexLayout T>
+	constexpr bool isValidVertexLayout()
+	{
+		for (const VertexField& field : T::fields())
+		{
+			const uint32_t size = vertexFormatSize(field.format);
+			if (size == 0 || field.locationCount == 0 || field.offset % 4 != 0 || field.offset + size * field.locationCount > sizeof(T))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<VertexLayout T>
+	constexpr std::array<VkVertexInputAttributeDescription, vertexAttributeCount<T>()> vertexAttributeDescriptions(uint32_t binding)
+	{
+		static_assert(isValidVertexLayout<T>(), "Vertex field outside its struct or with an unsupported format!");
+
+		std::array<VkVertexInputAttributeDescription, vertexAttributeCount<T>()> attributes{};
+		size_t next = 0;
+		for (const VertexField& field : T::fields())
+		{
+			for (uint32_t i = 0; i < field.locationCount; i++)
+			{
+				attributes[next++] = { field.location + i, binding, field.format, field.offset + i * vertexFormatSize(field.format) };
+			}
+		}
+		return attributes;
+	}
+
+	template<VertexLayout T>
+	constexpr VkVertexInputBindingDescription vertexBindingDescription(uint32_t binding)
+	{
+		return { binding, static_cast<uint32_t>(sizeof(T)), T::kInputRate };
+	}
+
+	// Descriptions for a pipeline reading each layout from its own binding, numbered in order.
+	template<VertexLayout... Ts>
+	std::vector<VkVertexInputBindingDescription> vertexBindingDescriptions()
+	{
+		uint32_t binding = 0;
+		return { vertexBindingDescription<Ts>(binding++)... };
+	}
+
+	template<VertexLayout... Ts>
+	std::vector<VkVertexInputAttributeDescription> vertexAttributeDescriptions()
+	{
+		std::vector<VkVertexInputAttributeDescription> descriptions;
+		uint32_t binding = 0;
+		([&]
+		{
+			const auto attributes = vertexAttributeDescriptions<Ts>(binding++);
+			descriptions.insert(descriptions.end(), attributes.begin(), attributes.end());
+		}(), ...);
+		return descriptions;
+	}
+
+	// Encoders for the compact attribute formats.
+	namespace VertexEncoding
+	{
+		// Maps a unit vector onto the octahedron, unfolded into [-1, 1]^2, as two snorm16.
+		std::array<int16_t, 2> octahedralSnorm16(const glm::vec3& normal);
+		glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+		uint16_t unorm16(float value);
+		int16_t snorm16(float value);
+		uint8_t unorm8(float value);
+		uint16_t half(float value);
+	}
+} // namespace ModelViewer
@@ -1,6 +1,7 @@
 #include "ImGuiRenderer.h"
 
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 
 #include "ModelViewerDevice.h"
 #include "ModelViewerRenderer.h"
@@ -72,12 +73,14 @@ namespace ModelViewer
 		init_info.Device = modelViewerDevice->device();
 		init_info.QueueFamily = modelViewerDevice->findPhysicalQueueFamilies().graphicsFamily;
 		init_info.Queue = modelViewerDevice->graphicsQueue();
-		init_info.PipelineCache = VK_NULL_HANDLE;
+		init_info.PipelineCache = modelViewerDevice->pipelineCache();
 		init_info.DescriptorPool = descriptorPool;
 		init_info.RenderPass = modelViewerRenderer->getSwapChain()->getRenderPass();
 		init_info.Subpass = 0;
 		init_info.MinImageCount = 2;
-		init_info.ImageCount = modelViewerRenderer->getSwapChain()->imageCount();
+		// The backend cycles its vertex buffers through ImageCount frames, which has to cover
+		// the most frames any pacing keeps in flight, whatever the current swap chain has.
+		init_info.ImageCount = std::max<uint32_t>(static_cast<uint32_t>(modelViewerRenderer->getSwapChain()->imageCount()), ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT);
 		init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 		init_info.Allocator = VK_NULL_HANDLE;
 		ImGui_ImplVulkan_Init(&init_info);
@@ -122,15 +125,99 @@ namespace ModelViewer
 		}
 	}
 
-	void ImGuiRenderer::renderUI(ModelViewerObject* object)
+	bool ImGuiRenderer::renderUI(TransformComponent& transform, RenderSettings& settings)
 	{
 		ImGui::Begin("Controls");
 
-		ImGui::DragFloat3("Position", glm::value_ptr(object->transform.translation));
-		ImGui::DragFloat3("Rotation", glm::value_ptr(object->transform.rotation));
+		bool transformChanged = ImGui::DragFloat3("Position", glm::value_ptr(transform.translation));
 
+		// Rotation is stored in radians but edited in degrees.
+		glm::vec3 rotationDegrees = glm::degrees(transform.rotation);
+		if (ImGui::DragFloat3("Rotation", glm::value_ptr(rotationDegrees)))
+		{
+			transform.rotation = glm::radians(rotationDegrees);
+			transformChanged = true;
+		}
+
+		ImGui::Separator();
+		if (settings.gpuCullingSupported)
+		{
+			ImGui::Checkbox("GPU culling", &settings.gpuCulling);
+		}
+		else
+		{
+			ImGui::TextDisabled("GPU culling unsupported");
+		}
+		ImGui::Text("Visible objects: %u / %u", settings.visibleObjects, settings.totalObjects);
+		if (settings.totalClusters > 0)
+		{
+			ImGui::Text("Visible meshlets: %u / %u", settings.visibleClusters, settings.totalClusters);
+		}
+
+		ImGui::Checkbox("LODs", &settings.lods);
+		if (settings.lods)
+		{
+			ImGui::SliderFloat("LOD error (px)", &settings.lodPixelError, 0.25f, 8.0f, "%.2f");
+			ImGui::Checkbox("LOD cross-fade", &settings.lodCrossFade);
+		}
+
+		// Render modes never seen before compile in the background, drawn meanwhile with the
+		// closest mode that is ready.
+		if (settings.wireframeSupported)
+		{
+			ImGui::Checkbox("Wireframe", &settings.renderMode.wireframe);
+		}
+		ImGui::Checkbox("Back-face culling", &settings.renderMode.backfaceCulling);
+		const char* lightingModels[] = { "Lit", "Unlit", "Normals" };
+		int lightingModel = static_cast<int>(settings.renderMode.lightingModel);
+		if (ImGui::Combo("Shading", &lightingModel, lightingModels, IM_ARRAYSIZE(lightingModels)))
+		{
+			settings.renderMode.lightingModel = static_cast<uint32_t>(lightingModel);
+		}
+		if (settings.pipelinesCompiling > 0)
+		{
+			ImGui::TextDisabled("Compiling %u pipelines...", settings.pipelinesCompiling);
+		}
+		if (settings.pipelinesFailed > 0)
+		{
+			ImGui::Text("%u pipelines failed to compile; drawing with the closest mode", settings.pipelinesFailed);
+		}
+
+		ImGui::Separator();
+		const char* framePacings[] = { "Low latency", "Throughput", "Uncapped" };
+		int framePacing = static_cast<int>(settings.framePacing);
+		if (ImGui::Combo("Frame pacing", &framePacing, framePacings, IM_ARRAYSIZE(framePacings)))
+		{
+			settings.framePacing = static_cast<FramePacing>(framePacing);
+		}
+		ImGui::Text("%s, %u frames in flight", settings.presentMode, settings.framesInFlight);
+		ImGui::Text("Input to %s: %.1f ms", settings.latencyToDisplay ? "display" : "present", settings.latency);
+		if (settings.framePacing == FramePacing::LowLatency && !settings.latencyToDisplay)
+		{
+			ImGui::TextDisabled("No present wait; pacing by mailbox");
+		}
+
+		if (settings.streamedPages > 0)
+		{
+			ImGui::Text("Resident pages: %u / %u (%u slots)", settings.residentPages, settings.streamedPages, settings.pageSlots);
+			ImGui::Text("Page faults: %.0f/s, upload %.1f MB/s", settings.pageFaultsPerSecond, settings.uploadBytesPerSecond / (1024.0f * 1024.0f));
+		}
+
+		const uint32_t modelsDone = settings.modelsLoaded + settings.modelsFailed;
+		if (modelsDone < settings.modelsRequested)
+		{
+			char overlay[64];
+			snprintf(overlay, sizeof(overlay), "Loading %u / %u models", modelsDone, settings.modelsRequested);
+			ImGui::ProgressBar(static_cast<float>(modelsDone) / settings.modelsRequested, ImVec2(-1.0f, 0.0f), overlay);
+		}
+		if (settings.modelsFailed > 0)
+		{
+			ImGui::Text("%u models failed to load", settings.modelsFailed);
+		}
 
 		ImGui::End();
+
+		return transformChanged;
 	}
 
 	void ImGuiRenderer::drawUI()
@@ -139,6 +226,12 @@ namespace ModelViewer
 		ImGui::Render();
 		ImDrawData* main_draw_data = ImGui::GetDrawData();
 
-		ImGui_ImplVulkan_RenderDrawData(main_draw_data, modelViewerRenderer->getCurrentCommandBuffer());
+		// Recorded on the main thread after the scene, so the first pool is free to use.
+		ModelViewerCommandRecorder& commandRecorder = modelViewerRenderer->getCommandRecorder();
+		VkCommandBuffer commandBuffer = commandRecorder.beginSecondary(0);
+		ImGui_ImplVulkan_RenderDrawData(main_draw_data, commandBuffer);
+		commandRecorder.endSecondary(commandBuffer);
+
+		vkCmdExecuteCommands(modelViewerRenderer->getCurrentCommandBuffer(), 1, &commandBuffer);
 	}
 } // namespace ModelViewer
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
-#include "ModelViewerObject.h"
+#include "ModelViewerFrameInfo.h"
+#include "Scene/ModelViewerTransformSystem.h"
 
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
@@ -27,7 +28,8 @@ namespace ModelViewer
 
 		void drawDemo(bool show_demo_window, bool show_another_window, ImVec4 clear_color);
 
-		void renderUI(ModelViewerObject* object);
+		// Returns true when the transform was edited.
+		bool renderUI(TransformComponent& transform, RenderSettings& settings);
 
 		void drawUI();
 
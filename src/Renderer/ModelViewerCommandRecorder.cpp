@@ -0,0 +1,120 @@
+#include "ModelViewerCommandRecorder.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace ModelViewer
+{
+	ModelViewerCommandRecorder::ModelViewerCommandRecorder(std::shared_ptr<ModelViewerDevice> device, uint32_t poolCount) :
+		modelViewerDevice{ device }, poolCount{ poolCount }
+	{
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = modelViewerDevice->findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		for (std::vector<ThreadPool>& pools : frames)
+		{
+			pools.resize(poolCount);
+			for (ThreadPool& pool : pools)
+			{
+				if (vkCreateCommandPool(modelViewerDevice->device(), &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed to create recording Command Pool!");
+				}
+			}
+		}
+	}
+
+	ModelViewerCommandRecorder::~ModelViewerCommandRecorder()
+	{
+		// Destroying a pool frees its command buffers along with it.
+		for (std::vector<ThreadPool>& pools : frames)
+		{
+			for (ThreadPool& pool : pools)
+			{
+				vkDestroyCommandPool(modelViewerDevice->device(), pool.commandPool, nullptr);
+			}
+		}
+	}
+
+	void ModelViewerCommandRecorder::beginFrame(int frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent)
+	{
+		currentFrameIndex = frameIndex;
+		currentRenderPass = renderPass;
+		currentFramebuffer = framebuffer;
+		currentExtent = extent;
+
+		// Resetting the pool recycles every buffer it handed out in one call; the buffers are
+		// kept and re-begun rather than freed and allocated again.
+		for (ThreadPool& pool : frames[frameIndex])
+		{
+			if (pool.usedCount > 0)
+			{
+				vkResetCommandPool(modelViewerDevice->device(), pool.commandPool, 0);
+				pool.usedCount = 0;
+			}
+		}
+	}
+
+	VkCommandBuffer ModelViewerCommandRecorder::beginSecondary(uint32_t pool)
+	{
+		assert(pool < poolCount && "Recording with a command pool that does not exist!");
+
+		ThreadPool& threadPool = frames[currentFrameIndex][pool];
+		if (threadPool.usedCount == threadPool.commandBuffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = threadPool.commandPool;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			if (vkAllocateCommandBuffers(modelViewerDevice->device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to allocate secondary Command Buffer!");
+			}
+			threadPool.commandBuffers.push_back(commandBuffer);
+		}
+		VkCommandBuffer commandBuffer = threadPool.commandBuffers[threadPool.usedCount++];
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = currentRenderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = currentFramebuffer;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to begin recording secondary Command Buffer!");
+		}
+
+		// Dynamic state is not inherited from the primary, so each secondary sets its own.
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(currentExtent.width);
+		viewport.height = static_cast<float>(currentExtent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{ {0,0}, currentExtent };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		return commandBuffer;
+	}
+
+	void ModelViewerCommandRecorder::endSecondary(VkCommandBuffer commandBuffer)
+	{
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record secondary Command Buffer!");
+		}
+	}
+} // namespace ModelViewer
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ModelViewerDevice.h"
+#include "ModelViewerSwapChain.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Secondary command buffers for recording the swap chain render pass from several
+	// threads. Every frame in flight owns one command pool per recording thread, so the
+	// pools never need locking: a pool is only touched by whichever thread records with
+	// its index, and the whole set is reset once the frame's fence has signalled.
+	class ModelViewerCommandRecorder
+	{
+	public:
+		ModelViewerCommandRecorder(std::shared_ptr<ModelViewerDevice> device, uint32_t poolCount);
+		~ModelViewerCommandRecorder();
+
+		ModelViewerCommandRecorder(const ModelViewerCommandRecorder&) = delete;
+		ModelViewerCommandRecorder& operator=(const ModelViewerCommandRecorder&) = delete;
+
+		// Resets the frame slot's pools and remembers the render pass the secondaries continue.
+		void beginFrame(int frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent);
+
+		// Begins a secondary command buffer from the given pool with the viewport and scissor
+		// already set. Different pools may be used from different threads at the same time.
+		VkCommandBuffer beginSecondary(uint32_t pool);
+		void endSecondary(VkCommandBuffer commandBuffer);
+
+		uint32_t getPoolCount() const { return poolCount; }
+
+	private:
+		struct ThreadPool
+		{
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> commandBuffers;
+			uint32_t usedCount = 0;
+		};
+
+		std::shared_ptr<ModelViewerDevice> modelViewerDevice;
+		uint32_t poolCount;
+		std::array<std::vector<ThreadPool>, ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+
+		int currentFrameIndex = 0;
+		VkRenderPass currentRenderPass = VK_NULL_HANDLE;
+		VkFramebuffer currentFramebuffer = VK_NULL_HANDLE;
+		VkExtent2D currentExtent{};
+	};
+} // namespace ModelViewer
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Camera/ModelViewerCamera.h"
+#include "ModelViewerSwapChain.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace ModelViewer
+{
+	class ModelViewerCommandRecorder;
+
+	// Shading options; every combination is drawn with a pipeline variant of its own.
+	struct RenderMode
+	{
+		enum LightingModel : uint32_t
+		{
+			Lit,
+			Unlit,
+			Normals,
+		};
+
+		bool wireframe = false;
+		bool backfaceCulling = false;
+		// Specialization constant 0 of simple_shader.vert.
+		uint32_t lightingModel = Lit;
+
+		bool operator==(const RenderMode&) const = default;
+	};
+
+	// Per-frame state handed to the render systems.
+	struct FrameInfo
+	{
+		int frameIndex;
+		float frameTime;
+		VkCommandBuffer commandBuffer;
+		ModelViewerCamera& camera;
+		glm::mat4 viewProjection{ 1.0f };
+		// World space eye position, for view dependent culling.
+		glm::vec3 cameraPosition{ 0.0f };
+		// Viewport pixels per world unit at unit distance over the LOD error threshold in
+		// pixels; 0 draws every object at LOD 0.
+		float lodErrorScale = 0.0f;
+		// Dither between LODs for a moment after a switch; only the CPU path fades.
+		bool lodCrossFade = false;
+		RenderMode renderMode{};
+		// Source of the secondary command buffers the render pass contents are recorded into.
+		ModelViewerCommandRecorder* commandRecorder = nullptr;
+	};
+
+	// Renderer options exposed in the UI, plus the statistics shown next to them.
+	struct RenderSettings
+	{
+		bool gpuCullingSupported = false;
+		bool gpuCulling = false;
+		uint32_t visibleObjects = 0;
+		uint32_t totalObjects = 0;
+		// Meshlets of clustered objects, only counted with GPU culling.
+		uint32_t visibleClusters = 0;
+		uint32_t totalClusters = 0;
+		bool lods = true;
+		// Largest on-screen deviation, in pixels, a coarser LOD may introduce.
+		float lodPixelError = 1.0f;
+		bool lodCrossFade = true;
+		// Wireframe needs the fillModeNonSolid feature.
+		bool wireframeSupported = false;
+		RenderMode renderMode{};
+		// Pipeline variants still compiling; the old ones draw meanwhile.
+		uint32_t pipelinesCompiling = 0;
+		// Variants that failed to compile and stay on their stand-in.
+		uint32_t pipelinesFailed = 0;
+		// Pages of streamed models, which only stream with GPU culling.
+		uint32_t streamedPages = 0;
+		uint32_t residentPages = 0;
+		uint32_t pageSlots = 0;
+		float pageFaultsPerSecond = 0.0f;
+		float uploadBytesPerSecond = 0.0f;
+		uint32_t modelsRequested = 0;
+		uint32_t modelsLoaded = 0;
+		uint32_t modelsFailed = 0;
+		// Applied after the frame, recreating the swap chain.
+		FramePacing framePacing = FramePacing::Throughput;
+		uint32_t framesInFlight = 0;
+		const char* presentMode = "";
+		// See ModelViewerSwapChain::getLatency().
+		float latency = 0.0f;
+		bool latencyToDisplay = false;
+	};
+} // namespace ModelViewer
@@ -0,0 +1,764 @@
+#include "ModelViewerIndirectRenderSystem.h"
+#include "ModelViewerCommandRecorder.h"
+#include "ModelViewerSimpleRenderSystem.h"
+#include "ModelViewerResidencyManager.h"
+#include "Loader/ModelViewerMeshletBuilder.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_access.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr uint32_t kCullGroupSize = 64;
+		constexpr uint32_t kDrawStride = sizeof(VkDrawIndexedIndirectCommand);
+		constexpr uint32_t kBindingCount = 11;
+
+		static_assert(ModelViewerResidencyManager::kPageVertices == 1024 && ModelViewerResidencyManager::kPageIndices == 5952,
+			"Update PAGE_VERTICES and PAGE_INDICES in cluster_cull.comp!");
+
+		// Replaces buffer with a device local copy of data, at least one element long so the
+		// descriptor stays valid. The old buffer is retired like the object buffer.
+		template <typename T>
+		void replaceStorageBuffer(ModelViewerDevice& device, const std::vector<T>& data, VkBuffer& buffer, ModelViewerAllocation& allocation)
+		{
+			if (buffer != VK_NULL_HANDLE)
+			{
+				device.deferDestroyBuffer(buffer, allocation);
+			}
+			device.createBuffer(sizeof(T) * std::max<size_t>(data.size(), 1),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				buffer,
+				allocation);
+			if (!data.empty())
+			{
+				device.uploadBuffer(buffer, 0, data.data(), sizeof(T) * data.size());
+			}
+		}
+	}
+
+	ModelViewerIndirectRenderSystem::ModelViewerIndirectRenderSystem(std::shared_ptr<ModelViewerDevice> device, VkRenderPass renderPass) : modelViewerDevice{ device }
+	{
+		assert(isSupported(*modelViewerDevice) && "Indirect rendering needs drawIndirectFirstInstance!");
+
+		// Without drawIndirectCount the culled draws stay in place with zero instances.
+		compact = modelViewerDevice->getCapabilities().drawIndirectCount;
+
+		createPipelineLayouts();
+		createPipelines(renderPass);
+		createDescriptorSets();
+	}
+
+	ModelViewerIndirectRenderSystem::~ModelViewerIndirectRenderSystem()
+	{
+		destroyBuffers();
+
+		vkDestroyDescriptorPool(modelViewerDevice->device(), descriptorPool, nullptr);
+		vkDestroyPipelineLayout(modelViewerDevice->device(), cullPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(modelViewerDevice->device(), cullSetLayout, nullptr);
+		vkDestroyPipelineLayout(modelViewerDevice->device(), pipelineLayout, nullptr);
+	}
+
+	void ModelViewerIndirectRenderSystem::createPipelineLayouts()
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(SimplePushConstantData);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 0;
+		pipelineLayoutInfo.pSetLayouts = nullptr;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(modelViewerDevice->device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Pipeline Layout!");
+		}
+
+		// Objects, transforms, draw commands, draw counts, clusters, cluster instances, LODs,
+		// LOD states, page slots, page request flags and page requests.
+		std::array<VkDescriptorSetLayoutBinding, kBindingCount> bindings{};
+		for (uint32_t i = 0; i < bindings.size(); i++)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+		setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		setLayoutInfo.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(modelViewerDevice->device(), &setLayoutInfo, nullptr, &cullSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create culling descriptor set layout!");
+		}
+
+		VkPushConstantRange cullPushConstantRange{};
+		cullPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		cullPushConstantRange.offset = 0;
+		cullPushConstantRange.size = sizeof(CullPushConstantData);
+
+		VkPipelineLayoutCreateInfo cullLayoutInfo{};
+		cullLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		cullLayoutInfo.setLayoutCount = 1;
+		cullLayoutInfo.pSetLayouts = &cullSetLayout;
+		cullLayoutInfo.pushConstantRangeCount = 1;
+		cullLayoutInfo.pPushConstantRanges = &cullPushConstantRange;
+
+		if (vkCreatePipelineLayout(modelViewerDevice->device(), &cullLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create culling Pipeline Layout!");
+		}
+	}
+
+	void ModelViewerIndirectRenderSystem::createPipelines(VkRenderPass renderPass)
+	{
+		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
+
+		pipelineManager = std::make_unique<ModelViewerPipelineManager>(*modelViewerDevice,
+			"simple_shader.vert",
+			"simple_shader.frag",
+			pipelineLayout,
+			renderPass);
+		pipelineManager->prepare({ RenderMode{}, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST });
+		pipelineManager->prepare({ RenderMode{}, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP });
+
+		cullPipeline = std::make_unique<ModelViewerComputePipeline>(*modelViewerDevice,
+			"cull.comp",
+			cullPipelineLayout);
+
+		clusterCullPipeline = std::make_unique<ModelViewerComputePipeline>(*modelViewerDevice,
+			"cluster_cull.comp",
+			cullPipelineLayout);
+	}
+
+	void ModelViewerIndirectRenderSystem::createDescriptorSets()
+	{
+		VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, kBindingCount * ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT };
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		if (vkCreateDescriptorPool(modelViewerDevice->device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create culling descriptor pool!");
+		}
+
+		std::array<VkDescriptorSetLayout, ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT> setLayouts;
+		setLayouts.fill(cullSetLayout);
+		std::array<VkDescriptorSet, ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT> descriptorSets;
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+		allocInfo.pSetLayouts = setLayouts.data();
+
+		if (vkAllocateDescriptorSets(modelViewerDevice->device(), &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate culling descriptor sets!");
+		}
+
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			frames[i].descriptorSet = descriptorSets[i];
+		}
+	}
+
+	void ModelViewerIndirectRenderSystem::destroyBuffers()
+	{
+		if (objectBuffer != VK_NULL_HANDLE)
+		{
+			modelViewerDevice->destroyBuffer(objectBuffer, objectAllocation);
+		}
+		if (clusterBuffer != VK_NULL_HANDLE)
+		{
+			modelViewerDevice->destroyBuffer(clusterBuffer, clusterAllocation);
+			modelViewerDevice->destroyBuffer(clusterInstanceBuffer, clusterInstanceAllocation);
+			modelViewerDevice->destroyBuffer(lodBuffer, lodAllocation);
+			modelViewerDevice->destroyBuffer(lodStateBuffer, lodStateAllocation);
+		}
+		for (FrameResources& frame : frames)
+		{
+			destroyFrameBuffers(frame);
+		}
+	}
+
+	void ModelViewerIndirectRenderSystem::destroyFrameBuffers(FrameResources& frame)
+	{
+		if (frame.capacity == 0)
+		{
+			return;
+		}
+
+		modelViewerDevice->destroyBuffer(frame.transformBuffer, frame.transformAllocation);
+		modelViewerDevice->destroyBuffer(frame.totalsBuffer, frame.totalsAllocation);
+		modelViewerDevice->destroyBuffer(frame.pageSlotBuffer, frame.pageSlotAllocation);
+		modelViewerDevice->destroyBuffer(frame.requestFlagBuffer, frame.requestFlagAllocation);
+		modelViewerDevice->destroyBuffer(frame.requestBuffer, frame.requestAllocation);
+		frame.capacity = 0;
+		frame.pageCapacity = 0;
+	}
+
+	void ModelViewerIndirectRenderSystem::reserveFrame(FrameResources& frame, uint32_t objectCount, uint32_t pageCount)
+	{
+		if (frame.capacity >= objectCount && frame.pageCapacity >= pageCount)
+		{
+			return;
+		}
+
+		// Only called once the slot's fence has signalled, so nothing still reads these.
+		destroyFrameBuffers(frame);
+		frame.capacity = std::max(objectCount, 256u);
+		frame.pageCapacity = std::max(pageCount, 256u);
+		frame.descriptorsDirty = true;
+
+		// The transforms double as the instance vertex buffer, indexed through firstInstance.
+		modelViewerDevice->createBuffer(sizeof(ModelViewerModel::Instance) * frame.capacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.transformBuffer,
+			frame.transformAllocation);
+
+		modelViewerDevice->createBuffer(sizeof(uint32_t) * 2,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.totalsBuffer,
+			frame.totalsAllocation);
+		std::fill_n(static_cast<uint32_t*>(frame.totalsAllocation.mapped), 2, 0u);
+
+		// The page table is rewritten by the CPU whenever residency changes.
+		modelViewerDevice->createBuffer(sizeof(uint32_t) * frame.pageCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.pageSlotBuffer,
+			frame.pageSlotAllocation);
+		std::fill_n(static_cast<uint32_t*>(frame.pageSlotAllocation.mapped), frame.pageCapacity, ModelViewerResidencyManager::NOT_RESIDENT);
+		frame.pageSlotsVersion = 0;
+
+		modelViewerDevice->createBuffer(sizeof(uint32_t) * frame.pageCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			frame.requestFlagBuffer,
+			frame.requestFlagAllocation);
+
+		// A count followed by the requested pages.
+		modelViewerDevice->createBuffer(sizeof(uint32_t) * (kMaxPageRequests + 1),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.requestBuffer,
+			frame.requestAllocation);
+		static_cast<uint32_t*>(frame.requestAllocation.mapped)[0] = 0;
+	}
+
+	void ModelViewerIndirectRenderSystem::allocateTransientRanges(FrameResources& frame, uint32_t groupCount)
+	{
+		ModelViewerAllocator& allocator = modelViewerDevice->getAllocator();
+		const VkDeviceSize alignment = modelViewerDevice->properties.limits.minStorageBufferOffsetAlignment;
+
+		const ModelViewerAllocation draws = allocator.allocateTransient(static_cast<VkDeviceSize>(kDrawStride) * std::max(drawCount, 1u),
+			alignment,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		// A count per group, plus the object and cluster totals.
+		const ModelViewerAllocation counts = allocator.allocateTransient(sizeof(uint32_t) * (groupCount + 2),
+			alignment,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		auto sameRange = [](const ModelViewerAllocation& a, const ModelViewerAllocation& b)
+		{
+			return a.buffer == b.buffer && a.offset == b.offset && a.size == b.size;
+		};
+		if (!sameRange(draws, frame.drawAllocation) || !sameRange(counts, frame.countAllocation))
+		{
+			frame.descriptorsDirty = true;
+		}
+		frame.drawAllocation = draws;
+		frame.countAllocation = counts;
+	}
+
+	void ModelViewerIndirectRenderSystem::updateStreaming(FrameResources& frame)
+	{
+		ModelViewerResidencyManager& residencyManager = modelViewerDevice->getResidencyManager();
+
+		// The slot's fence has signalled, so its requests are complete.
+		uint32_t* requests = static_cast<uint32_t*>(frame.requestAllocation.mapped);
+		const uint32_t requestCount = std::min(requests[0], kMaxPageRequests);
+		residencyManager.update({ requests + 1, requestCount });
+		requests[0] = 0;
+
+		if (frame.pageSlotsVersion != residencyManager.getPageSlotsVersion())
+		{
+			frame.pageSlotsVersion = residencyManager.copyPageSlots({ static_cast<uint32_t*>(frame.pageSlotAllocation.mapped), frame.pageCapacity });
+		}
+	}
+
+	void ModelViewerIndirectRenderSystem::updateDescriptorSet(FrameResources& frame)
+	{
+		std::array<VkDescriptorBufferInfo, kBindingCount> bufferInfos{};
+		bufferInfos[0] = { objectBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { frame.transformBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { frame.drawAllocation.buffer, frame.drawAllocation.offset, frame.drawAllocation.size };
+		bufferInfos[3] = { frame.countAllocation.buffer, frame.countAllocation.offset, frame.countAllocation.size };
+		bufferInfos[4] = { clusterBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[5] = { clusterInstanceBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[6] = { lodBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[7] = { lodStateBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[8] = { frame.pageSlotBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[9] = { frame.requestFlagBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[10] = { frame.requestBuffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, kBindingCount> writes{};
+		for (uint32_t i = 0; i < writes.size(); i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(modelViewerDevice->device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	void ModelViewerIndirectRenderSystem::setObjects(const std::vector<ModelViewerObject>& modelObjects)
+	{
+		objectCount = static_cast<uint32_t>(modelObjects.size());
+		drawCount = 0;
+		clusterInstanceCount = 0;
+		drawGroups.clear();
+
+		ModelViewerTransformSystem::Handle handleCount = 0;
+		for (const ModelViewerObject& object : modelObjects)
+		{
+			handleCount = std::max(handleCount, object.transform + 1);
+		}
+		// Transforms that only group other objects, like the scene root, have no slot.
+		transformSlots.assign(handleCount, kNoSlot);
+
+		for (FrameResources& frame : frames)
+		{
+			frame.dirtyTransforms.clear();
+			frame.dirtyFlags.assign(handleCount, 0);
+		}
+
+		if (objectCount == 0)
+		{
+			return;
+		}
+
+		// Frames still in flight keep reading the old object buffer, so it is replaced rather
+		// than overwritten and destroyed once those frames complete. Each frame slot picks up
+		// the new objects the next time it is culled.
+		if (objectBuffer != VK_NULL_HANDLE)
+		{
+			modelViewerDevice->deferDestroyBuffer(objectBuffer, objectAllocation);
+		}
+		modelViewerDevice->createBuffer(sizeof(CullObject) * objectCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			objectBuffer,
+			objectAllocation);
+		objectsVersion++;
+
+		// Slots are ordered by geometry page and topology so every group's draws are contiguous.
+		std::vector<uint32_t> order(modelObjects.size());
+		for (uint32_t i = 0; i < order.size(); i++)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+		{
+			const ModelViewerModel& modelA = *modelObjects[a].model;
+			const ModelViewerModel& modelB = *modelObjects[b].model;
+			if (modelA.getGeometry().page != modelB.getGeometry().page)
+			{
+				return modelA.getGeometry().page < modelB.getGeometry().page;
+			}
+			return modelA.getTopology() < modelB.getTopology();
+		});
+
+		std::vector<CullObject> cullObjects(modelObjects.size());
+		std::vector<CullCluster> cullClusters;
+		std::vector<ClusterInstance> clusterInstances;
+		std::vector<CullLod> cullLods;
+		// Meshlets and LODs are uploaded once per model, however many objects use it.
+		struct ModelRanges
+		{
+			uint32_t firstCluster;
+			uint32_t firstLod;
+		};
+		std::unordered_map<const ModelViewerModel*, ModelRanges> modelRanges;
+		// Streamed meshlets share one group after all the others, laid out once its base is known.
+		uint32_t streamingDraws = 0;
+		slotTransforms.resize(order.size());
+		slotDequantizations.resize(order.size());
+		for (uint32_t slot = 0; slot < order.size(); slot++)
+		{
+			const ModelViewerModel& model = *modelObjects[order[slot]].model;
+			const ModelViewerGeometryPool::Range& geometry = model.getGeometry();
+
+			if (drawGroups.empty() || drawGroups.back().page != geometry.page || drawGroups.back().topology != model.getTopology())
+			{
+				drawGroups.push_back({ geometry.page, model.getTopology(), drawCount, 0 });
+			}
+			DrawGroup& group = drawGroups.back();
+
+			CullObject& cullObject = cullObjects[slot];
+			// The instance transforms include the dequantization, which is a uniform scale and
+			// offset, so the sphere is moved into the packed position space.
+			const glm::mat4& dequantization = model.getDequantization();
+			const float quantizationScale = dequantization[0][0];
+			const ModelViewerModel::BoundingSphere& sphere = model.getBoundingSphere();
+			const glm::vec3 quantizationOffset{ dequantization[3] };
+			cullObject.sphere = glm::vec4((sphere.center - quantizationOffset) / quantizationScale, sphere.radius / quantizationScale);
+			cullObject.vertexOffset = static_cast<int32_t>(geometry.vertexOffset);
+			cullObject.group = static_cast<uint32_t>(drawGroups.size() - 1);
+			cullObject.drawBase = group.drawBase;
+			cullObject.drawIndex = drawCount;
+			group.drawCount++;
+			drawCount++;
+
+			const std::vector<ModelViewerModel::Meshlet>& meshlets = model.getMeshlets();
+			const std::vector<ModelViewerModel::Lod>& lods = model.getLods();
+			auto [entry, inserted] = modelRanges.try_emplace(&model, ModelRanges{ static_cast<uint32_t>(cullClusters.size()), static_cast<uint32_t>(cullLods.size()) });
+			if (inserted)
+			{
+				for (const ModelViewerModel::Lod& lod : lods)
+				{
+					cullLods.push_back({ geometry.firstIndex + lod.firstIndex, lod.indexCount, lod.error / quantizationScale, 0 });
+				}
+				for (uint32_t i = 0; i < meshlets.size(); i++)
+				{
+					const ModelViewerModel::Meshlet& meshlet = meshlets[i];
+					CullCluster& cluster = cullClusters.emplace_back();
+					cluster.sphere = glm::vec4((meshlet.center - quantizationOffset) / quantizationScale, meshlet.radius / quantizationScale);
+					// A uniform scale leaves directions, and so the cone, unchanged.
+					cluster.cone = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff);
+					cluster.indexCount = meshlet.indexCount;
+					cluster.page = kNoPage;
+					cluster.padding = 0;
+					if (model.isStreamed())
+					{
+						// Pages hold consecutive meshlets, so the page's first one starts its indices.
+						const uint32_t pageIndex = i / ModelViewerMeshletBuilder::kPageMeshlets;
+						cluster.page = model.getFirstPage() + pageIndex;
+						cluster.firstIndex = meshlet.firstIndex - meshlets[pageIndex * ModelViewerMeshletBuilder::kPageMeshlets].firstIndex;
+					}
+					else
+					{
+						cluster.firstIndex = geometry.firstIndex + meshlet.firstIndex;
+					}
+				}
+			}
+
+			cullObject.firstLod = entry->second.firstLod;
+			cullObject.lodCount = static_cast<uint32_t>(lods.size());
+			cullObject.firstCluster = entry->second.firstCluster;
+			cullObject.clusterCount = static_cast<uint32_t>(meshlets.size());
+			cullObject.padding = 0;
+			for (uint32_t cluster = 0; cluster < cullObject.clusterCount; cluster++)
+			{
+				clusterInstances.push_back({ slot, cluster });
+			}
+			if (model.isStreamed())
+			{
+				// Relative to the streaming group until it is placed below.
+				cullObject.clusterDrawIndex = streamingDraws;
+				streamingDraws += cullObject.clusterCount;
+			}
+			else
+			{
+				cullObject.clusterGroup = cullObject.group;
+				cullObject.clusterDrawBase = cullObject.drawBase;
+				cullObject.clusterDrawIndex = drawCount;
+				group.drawCount += cullObject.clusterCount;
+				drawCount += cullObject.clusterCount;
+			}
+
+			transformSlots[modelObjects[order[slot]].transform] = slot;
+			slotTransforms[slot] = modelObjects[order[slot]].transform;
+			slotDequantizations[slot] = dequantization;
+		}
+
+		if (streamingDraws != 0)
+		{
+			const uint32_t streamingGroup = static_cast<uint32_t>(drawGroups.size());
+			drawGroups.push_back({ kStreamingPage, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, drawCount, streamingDraws });
+			for (uint32_t slot = 0; slot < order.size(); slot++)
+			{
+				if (modelObjects[order[slot]].model->isStreamed())
+				{
+					cullObjects[slot].clusterGroup = streamingGroup;
+					cullObjects[slot].clusterDrawBase = drawCount;
+					cullObjects[slot].clusterDrawIndex += drawCount;
+				}
+			}
+			drawCount += streamingDraws;
+		}
+		pageCount = modelViewerDevice->getResidencyManager().getPageCount();
+
+		modelViewerDevice->uploadBuffer(objectBuffer, 0, cullObjects.data(), sizeof(CullObject) * cullObjects.size());
+
+		clusterInstanceCount = static_cast<uint32_t>(clusterInstances.size());
+		replaceStorageBuffer(*modelViewerDevice, cullClusters, clusterBuffer, clusterAllocation);
+		replaceStorageBuffer(*modelViewerDevice, clusterInstances, clusterInstanceBuffer, clusterInstanceAllocation);
+		replaceStorageBuffer(*modelViewerDevice, cullLods, lodBuffer, lodAllocation);
+		// Slots were reassigned, so every object starts over at LOD 0 with nothing missing.
+		replaceStorageBuffer(*modelViewerDevice, std::vector<uint32_t>(objectCount, 0u), lodStateBuffer, lodStateAllocation);
+	}
+
+	void ModelViewerIndirectRenderSystem::markTransformDirty(ModelViewerTransformSystem::Handle transform)
+	{
+		// Every frame slot has its own copy of the transforms, so each one is updated the
+		// next time it is culled.
+		for (FrameResources& frame : frames)
+		{
+			if (transform < frame.dirtyFlags.size() && transformSlots[transform] != kNoSlot && !frame.dirtyFlags[transform])
+			{
+				frame.dirtyFlags[transform] = 1;
+				frame.dirtyTransforms.push_back(transform);
+			}
+		}
+	}
+
+	void ModelViewerIndirectRenderSystem::cull(FrameInfo& frameInfo, const ModelViewerTransformSystem& transforms)
+	{
+		if (objectCount == 0)
+		{
+			visibleCount = 0;
+			visibleClusterCount = 0;
+			return;
+		}
+
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		const uint32_t groupCount = static_cast<uint32_t>(drawGroups.size());
+
+		// The frame's fence has already been waited on, so its buffers are free to change.
+		auto* instances = static_cast<ModelViewerModel::Instance*>(frame.transformAllocation.mapped);
+		if (frame.version != objectsVersion)
+		{
+			// First cull of this slot since setObjects; its counts describe the old objects.
+			reserveFrame(frame, objectCount, pageCount);
+			frame.version = objectsVersion;
+			// setObjects may also have replaced the shared buffers.
+			frame.descriptorsDirty = true;
+
+			instances = static_cast<ModelViewerModel::Instance*>(frame.transformAllocation.mapped);
+			for (uint32_t slot = 0; slot < objectCount; slot++)
+			{
+				instances[slot].transform = transforms.getWorldMatrix(slotTransforms[slot]) * slotDequantizations[slot];
+			}
+			for (ModelViewerTransformSystem::Handle transform : frame.dirtyTransforms)
+			{
+				frame.dirtyFlags[transform] = 0;
+			}
+		}
+		else
+		{
+			const uint32_t* totals = static_cast<const uint32_t*>(frame.totalsAllocation.mapped);
+			visibleCount = totals[0];
+			visibleClusterCount = totals[1];
+
+			for (ModelViewerTransformSystem::Handle transform : frame.dirtyTransforms)
+			{
+				const uint32_t slot = transformSlots[transform];
+				instances[slot].transform = transforms.getWorldMatrix(transform) * slotDequantizations[slot];
+				frame.dirtyFlags[transform] = 0;
+			}
+		}
+		frame.dirtyTransforms.clear();
+
+		allocateTransientRanges(frame, groupCount);
+		if (frame.descriptorsDirty)
+		{
+			updateDescriptorSet(frame);
+			frame.descriptorsDirty = false;
+		}
+
+		if (pageCount != 0)
+		{
+			updateStreaming(frame);
+		}
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+		vkCmdFillBuffer(commandBuffer, frame.countAllocation.buffer, frame.countAllocation.offset, frame.countAllocation.size, 0);
+		if (pageCount != 0)
+		{
+			vkCmdFillBuffer(commandBuffer, frame.requestFlagBuffer, 0, sizeof(uint32_t) * pageCount, 0);
+		}
+
+		// Also orders this frame's LOD state accesses after the previous frame's culling.
+		VkMemoryBarrier fillBarrier{};
+		fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+		// Gribb/Hartmann plane extraction for a 0..1 depth range.
+		const glm::mat4& viewProjection = frameInfo.viewProjection;
+		const glm::vec4 row0 = glm::row(viewProjection, 0);
+		const glm::vec4 row1 = glm::row(viewProjection, 1);
+		const glm::vec4 row2 = glm::row(viewProjection, 2);
+		const glm::vec4 row3 = glm::row(viewProjection, 3);
+
+		CullPushConstantData push{};
+		push.planes[0] = row3 + row0;
+		push.planes[1] = row3 - row0;
+		push.planes[2] = row3 + row1;
+		push.planes[3] = row3 - row1;
+		push.planes[4] = row2;
+		push.planes[5] = row3 - row2;
+		for (glm::vec4& plane : push.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		push.objectCount = objectCount;
+		push.groupCount = groupCount;
+		push.compact = compact ? 1 : 0;
+		push.clusterInstanceCount = clusterInstanceCount;
+		push.cameraPosition = glm::vec4(frameInfo.cameraPosition, frameInfo.lodErrorScale);
+
+		cullPipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData), &push);
+		vkCmdDispatch(commandBuffer, (objectCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+		if (clusterInstanceCount != 0)
+		{
+			// Both passes append to the same group counts.
+			VkMemoryBarrier passBarrier{};
+			passBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			passBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			passBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &passBarrier, 0, nullptr, 0, nullptr);
+
+			// The descriptor set and push constants stay bound across the compatible layout.
+			clusterCullPipeline->bind(commandBuffer);
+			vkCmdDispatch(commandBuffer, (clusterInstanceCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+		}
+
+		VkMemoryBarrier cullBarrier{};
+		cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy totalsCopy{};
+		totalsCopy.srcOffset = frame.countAllocation.offset + sizeof(uint32_t) * groupCount;
+		totalsCopy.size = sizeof(uint32_t) * 2;
+		vkCmdCopyBuffer(commandBuffer, frame.countAllocation.buffer, frame.totalsBuffer, 1, &totalsCopy);
+
+		VkMemoryBarrier readbackBarrier{};
+		readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &readbackBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	void ModelViewerIndirectRenderSystem::render(FrameInfo& frameInfo)
+	{
+		if (objectCount == 0)
+		{
+			return;
+		}
+
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		// A handful of indirect draws is not worth splitting, so one secondary suffices.
+		VkCommandBuffer commandBuffer = frameInfo.commandRecorder->beginSecondary(0);
+		ModelViewerPipeline& trianglePipeline = pipelineManager->get({ frameInfo.renderMode, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST });
+		ModelViewerPipeline& stripPipeline = pipelineManager->get({ frameInfo.renderMode, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP });
+		trianglePipeline.bind(commandBuffer);
+
+		SimplePushConstantData push{};
+		push.viewProjection = frameInfo.viewProjection;
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+
+		VkBuffer buffers[] = { frame.transformBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, buffers, offsets);
+
+		ModelViewerGeometryPool& geometryPool = modelViewerDevice->getGeometryPool();
+		ModelViewerResidencyManager& residencyManager = modelViewerDevice->getResidencyManager();
+		const bool multiDraw = modelViewerDevice->getCapabilities().multiDrawIndirect;
+
+		uint32_t boundPage = ModelViewerGeometryPool::INVALID_PAGE;
+		bool stripsBound = false;
+
+		for (uint32_t i = 0; i < drawGroups.size(); i++)
+		{
+			const DrawGroup& group = drawGroups[i];
+			const VkDeviceSize drawOffset = frame.drawAllocation.offset + static_cast<VkDeviceSize>(group.drawBase) * kDrawStride;
+
+			const bool strips = group.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+			if (strips != stripsBound)
+			{
+				(strips ? stripPipeline : trianglePipeline).bind(commandBuffer);
+				stripsBound = strips;
+			}
+			if (group.page == kStreamingPage)
+			{
+				residencyManager.bind(commandBuffer);
+				boundPage = kStreamingPage;
+			}
+			else if (group.page != boundPage)
+			{
+				geometryPool.bind(commandBuffer, group.page);
+				boundPage = group.page;
+			}
+
+			if (compact)
+			{
+				vkCmdDrawIndexedIndirectCount(commandBuffer, frame.drawAllocation.buffer, drawOffset,
+					frame.countAllocation.buffer, frame.countAllocation.offset + sizeof(uint32_t) * i, group.drawCount, kDrawStride);
+			}
+			else if (multiDraw)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, frame.drawAllocation.buffer, drawOffset, group.drawCount, kDrawStride);
+			}
+			else
+			{
+				for (uint32_t draw = 0; draw < group.drawCount; draw++)
+				{
+					vkCmdDrawIndexedIndirect(commandBuffer, frame.drawAllocation.buffer, drawOffset + static_cast<VkDeviceSize>(draw) * kDrawStride, 1, kDrawStride);
+				}
+			}
+		}
+
+		frameInfo.commandRecorder->endSecondary(commandBuffer);
+		vkCmdExecuteCommands(frameInfo.commandBuffer, 1, &commandBuffer);
+	}
+} // namespace ModelViewer
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "ModelViewerComputePipeline.h"
+#include "ModelViewerDevice.h"
+#include "ModelViewerFrameInfo.h"
+#include "ModelViewerPipelineManager.h"
+#include "ModelViewerObject.h"
+#include "ModelViewerSwapChain.h"
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace ModelViewer
+{
+	// GPU driven path: object bounds and transforms live in storage buffers, a compute pass
+	// culls them against the view frustum and writes the indirect draw commands, and each
+	// geometry page is drawn with one vkCmdDrawIndexedIndirectCount. The CPU only touches
+	// objects whose transform changed, so the per-frame cost does not grow with the scene.
+	// Models split into meshlets draw one command per meshlet instead, emitted by a second
+	// pass that also rejects meshlets facing away from the camera. The object pass also
+	// picks each object's LOD, keeping the previous choice on the GPU for hysteresis;
+	// objects switch LODs without a cross-fade on this path. The meshlets of streamed models
+	// draw from the residency manager's slot pool: the cluster pass reports the pages it
+	// needed and, while any of them is missing, the object falls back to its coarsest LOD.
+	class ModelViewerIndirectRenderSystem
+	{
+	public:
+		// Indirect draws select the object's transform through firstInstance.
+		static bool isSupported(const ModelViewerDevice& device) { return device.getCapabilities().drawIndirectFirstInstance; }
+
+		ModelViewerIndirectRenderSystem(std::shared_ptr<ModelViewerDevice> device, VkRenderPass renderPass);
+		~ModelViewerIndirectRenderSystem();
+
+		ModelViewerIndirectRenderSystem(const ModelViewerIndirectRenderSystem&) = delete;
+		ModelViewerIndirectRenderSystem& operator=(const ModelViewerIndirectRenderSystem&) = delete;
+
+		// Rebuilds the object buffer when the scene changes. Does not wait for the device; the
+		// previous buffers are retired through the device's deletion queue.
+		void setObjects(const std::vector<ModelViewerObject>& modelObjects);
+
+		// Queues a changed world matrix for upload into every frame's transform buffer.
+		void markTransformDirty(ModelViewerTransformSystem::Handle transform);
+
+		// Records the culling dispatch; must be called outside the render pass.
+		void cull(FrameInfo& frameInfo, const ModelViewerTransformSystem& transforms);
+		void render(FrameInfo& frameInfo);
+
+		// Visible objects counted by the GPU the last time this frame slot was culled.
+		uint32_t getVisibleCount() const { return visibleCount; }
+		// Same for the meshlets of clustered objects, out of getClusterCount().
+		uint32_t getVisibleClusterCount() const { return visibleClusterCount; }
+		uint32_t getClusterCount() const { return clusterInstanceCount; }
+		uint32_t getCompilingPipelineCount() const { return pipelineManager->getCompilingCount(); }
+		uint32_t getFailedPipelineCount() const { return pipelineManager->getFailedCount(); }
+
+	private:
+		struct CullObject
+		{
+			glm::vec4 sphere;
+			int32_t vertexOffset;
+			uint32_t group;
+			uint32_t drawBase;
+			// Fixed draw slot when compaction is unavailable.
+			uint32_t drawIndex;
+			uint32_t firstCluster;
+			uint32_t clusterCount;
+			uint32_t firstLod;
+			uint32_t lodCount;
+			// Where the meshlet draws go: the object's own group, or the streaming group for
+			// streamed models. clusterDrawIndex is the first of clusterCount fixed slots.
+			uint32_t clusterGroup;
+			uint32_t clusterDrawBase;
+			uint32_t clusterDrawIndex;
+			uint32_t padding;
+		};
+
+		// A LOD's index range in its geometry page; error is in the packed position space.
+		struct CullLod
+		{
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			float error;
+			uint32_t padding;
+		};
+
+		// A meshlet in the packed position space, shared by every object using the model.
+		// firstIndex is relative to the page's slot for streamed meshlets.
+		struct CullCluster
+		{
+			glm::vec4 sphere;
+			glm::vec4 cone;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			// Residency manager page, kNoPage unless streamed.
+			uint32_t page;
+			uint32_t padding;
+		};
+
+		// One per meshlet of every clustered object; cluster is relative to its firstCluster.
+		struct ClusterInstance
+		{
+			uint32_t object;
+			uint32_t cluster;
+		};
+
+		struct CullPushConstantData
+		{
+			glm::vec4 planes[6];
+			uint32_t objectCount;
+			uint32_t groupCount;
+			uint32_t compact;
+			uint32_t clusterInstanceCount;
+			// w is FrameInfo::lodErrorScale.
+			glm::vec4 cameraPosition;
+		};
+
+		// Objects drawing from the same geometry page with the same topology occupy one
+		// contiguous range of draws.
+		struct DrawGroup
+		{
+			uint32_t page;
+			VkPrimitiveTopology topology;
+			uint32_t drawBase;
+			uint32_t drawCount;
+		};
+
+		struct FrameResources
+		{
+			VkBuffer transformBuffer = VK_NULL_HANDLE;
+			ModelViewerAllocation transformAllocation{};
+			// The slot's last ranges of transient memory, which stay put from frame to frame
+			// while the draw and group counts do.
+			ModelViewerAllocation drawAllocation{};
+			ModelViewerAllocation countAllocation{};
+			// The visible object and cluster totals of the slot's last cull. Copied out of the
+			// counts, since frames drawn without culling reuse the slot's transient memory.
+			VkBuffer totalsBuffer = VK_NULL_HANDLE;
+			ModelViewerAllocation totalsAllocation{};
+			// Page to slot table as of this frame, a flag per page the cluster pass has asked
+			// for, and the list of those pages, read back once the frame completed.
+			VkBuffer pageSlotBuffer = VK_NULL_HANDLE;
+			ModelViewerAllocation pageSlotAllocation{};
+			VkBuffer requestFlagBuffer = VK_NULL_HANDLE;
+			ModelViewerAllocation requestFlagAllocation{};
+			VkBuffer requestBuffer = VK_NULL_HANDLE;
+			ModelViewerAllocation requestAllocation{};
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			// Set when any buffer the descriptor set points at was replaced.
+			bool descriptorsDirty = true;
+			uint32_t capacity = 0;
+			uint32_t pageCapacity = 0;
+			uint64_t pageSlotsVersion = 0;
+			// objectsVersion this slot's buffers were last built for.
+			uint64_t version = 0;
+
+			std::vector<ModelViewerTransformSystem::Handle> dirtyTransforms;
+			std::vector<uint8_t> dirtyFlags;
+		};
+
+		void createPipelineLayouts();
+		void createPipelines(VkRenderPass renderPass);
+		void createDescriptorSets();
+		void reserveFrame(FrameResources& frame, uint32_t objectCount, uint32_t pageCount);
+		// Takes this frame's draw and count ranges from the slot's transient memory.
+		void allocateTransientRanges(FrameResources& frame, uint32_t groupCount);
+		// Feeds the pages the slot's last frame requested to the residency manager and
+		// refreshes the slot's page table.
+		void updateStreaming(FrameResources& frame);
+		void destroyFrameBuffers(FrameResources& frame);
+		void destroyBuffers();
+		void updateDescriptorSet(FrameResources& frame);
+
+		std::shared_ptr<ModelViewerDevice> modelViewerDevice;
+		std::unique_ptr<ModelViewerPipelineManager> pipelineManager;
+		std::unique_ptr<ModelViewerComputePipeline> cullPipeline;
+		std::unique_ptr<ModelViewerComputePipeline> clusterCullPipeline;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+
+		VkBuffer objectBuffer = VK_NULL_HANDLE;
+		ModelViewerAllocation objectAllocation{};
+		VkBuffer clusterBuffer = VK_NULL_HANDLE;
+		ModelViewerAllocation clusterAllocation{};
+		VkBuffer clusterInstanceBuffer = VK_NULL_HANDLE;
+		ModelViewerAllocation clusterInstanceAllocation{};
+		VkBuffer lodBuffer = VK_NULL_HANDLE;
+		ModelViewerAllocation lodAllocation{};
+		// Each object's current LOD, shared by all frame slots since frames execute in order.
+		VkBuffer lodStateBuffer = VK_NULL_HANDLE;
+		ModelViewerAllocation lodStateAllocation{};
+		std::array<FrameResources, ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+
+		static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+		static constexpr uint32_t kNoPage = std::numeric_limits<uint32_t>::max();
+		// Draw group page of the meshlets drawn from the residency manager's pool.
+		static constexpr uint32_t kStreamingPage = ModelViewerGeometryPool::INVALID_PAGE - 1;
+		// Most distinct pages one frame can report; the rest are asked for again next frame.
+		static constexpr uint32_t kMaxPageRequests = 1u << 16;
+
+		std::vector<DrawGroup> drawGroups;
+		// Transform handle to object slot.
+		std::vector<uint32_t> transformSlots;
+		// Object slot to transform handle.
+		std::vector<ModelViewerTransformSystem::Handle> slotTransforms;
+		std::vector<glm::mat4> slotDequantizations;
+		uint32_t objectCount = 0;
+		uint32_t drawCount = 0;
+		uint32_t clusterInstanceCount = 0;
+		// Residency manager pages when setObjects last ran; 0 without streamed models.
+		uint32_t pageCount = 0;
+		uint64_t objectsVersion = 0;
+		uint32_t visibleCount = 0;
+		uint32_t visibleClusterCount = 0;
+		bool compact = false;
+	};
+} // namespace ModelViewer
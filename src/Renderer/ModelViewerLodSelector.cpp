@@ -0,0 +1,77 @@
+#include "ModelViewerLodSelector.h"
+
+#include <algorithm>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		// Keeps the error finite for cameras inside the bounds; LOD 0 wins there anyway.
+		constexpr float kMinDistance = 1e-3f;
+	}
+
+	float ModelViewerLodSelector::pixelsPerError(float errorScale, const glm::vec3& cameraPosition, const glm::mat4& world, const ModelViewerModel::BoundingSphere& sphere)
+	{
+		const float scale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+		const glm::vec3 center = glm::vec3(world * glm::vec4(sphere.center, 1.0f));
+		const float distance = std::max(glm::length(center - cameraPosition) - sphere.radius * scale, kMinDistance);
+		return errorScale * scale / distance;
+	}
+
+	uint32_t ModelViewerLodSelector::selectLod(std::span<const ModelViewerModel::Lod> lods, float pixelsPerError, uint32_t currentLod)
+	{
+		// Errors grow with the LOD, so the last one within a limit is the coarsest.
+		uint32_t ideal = 0;
+		for (uint32_t lod = 1; lod < lods.size(); lod++)
+		{
+			if (lods[lod].error * pixelsPerError <= 1.0f)
+			{
+				ideal = lod;
+			}
+		}
+		if (ideal <= currentLod)
+		{
+			return ideal;
+		}
+
+		uint32_t selected = std::min<uint32_t>(currentLod, static_cast<uint32_t>(lods.size() - 1));
+		for (uint32_t lod = selected + 1; lod <= ideal; lod++)
+		{
+			if (lods[lod].error * pixelsPerError <= 1.0f - kHysteresis)
+			{
+				selected = lod;
+			}
+		}
+		return selected;
+	}
+
+	void ModelViewerLodSelector::beginFrame(float frameTime, bool crossFade)
+	{
+		fadeStep = crossFade ? frameTime / kFadeSeconds : 1.0f;
+	}
+
+	ModelViewerLodSelector::Selection ModelViewerLodSelector::update(uint32_t key, std::span<const ModelViewerModel::Lod> lods, float pixelsPerError)
+	{
+		if (key >= states.size())
+		{
+			states.resize(key + 1);
+		}
+
+		Selection& state = states[key];
+		state.fade = std::min(state.fade + fadeStep, 1.0f);
+
+		const uint32_t lod = selectLod(lods, pixelsPerError, state.lod);
+		// A switch during a fade restarts it from the LOD that was showing most.
+		if (lod != state.lod)
+		{
+			state.previousLod = state.fade >= 0.5f ? state.lod : state.previousLod;
+			state.lod = lod;
+			state.fade = std::min(fadeStep, 1.0f);
+		}
+		if (state.previousLod >= lods.size() || state.previousLod == state.lod)
+		{
+			state.fade = 1.0f;
+		}
+		return state;
+	}
+} // namespace ModelViewer
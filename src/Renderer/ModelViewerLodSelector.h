@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ModelViewerModel.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Picks each object's LOD from the screen-space size of its geometric error for the
+	// CPU render path, and cross-fades between the old and new LOD after a switch. The
+	// selection rule is shared with cull.comp, which applies it on the GPU path.
+	class ModelViewerLodSelector
+	{
+	public:
+		// A coarser LOD is only taken once its error is this much below the threshold, so
+		// objects near a switching distance do not flicker between two LODs.
+		static constexpr float kHysteresis = 0.25f;
+		static constexpr float kFadeSeconds = 0.25f;
+
+		struct Selection
+		{
+			uint32_t lod = 0;
+			// Still drawn, fading out, while fade is below 1.
+			uint32_t previousLod = 0;
+			float fade = 1.0f;
+
+			bool isFading() const { return fade < 1.0f; }
+		};
+
+		// Threshold-relative pixels per unit of object space error for an object with the given
+		// world transform and bounds. errorScale is the viewport's pixels per world unit at unit
+		// distance divided by the error threshold in pixels.
+		static float pixelsPerError(float errorScale, const glm::vec3& cameraPosition, const glm::mat4& world, const ModelViewerModel::BoundingSphere& sphere);
+
+		// Coarsest LOD whose error stays within one threshold, moving coarser than currentLod
+		// only past the hysteresis band.
+		static uint32_t selectLod(std::span<const ModelViewerModel::Lod> lods, float pixelsPerError, uint32_t currentLod);
+
+		void beginFrame(float frameTime, bool crossFade);
+		// key identifies the object across frames; transform handles serve well.
+		Selection update(uint32_t key, std::span<const ModelViewerModel::Lod> lods, float pixelsPerError);
+
+	private:
+		std::vector<Selection> states;
+		float fadeStep = 1.0f;
+	};
+} // namespace ModelViewer
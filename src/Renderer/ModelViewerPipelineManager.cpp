@@ -0,0 +1,203 @@
+#include "ModelViewerPipelineManager.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace ModelViewer
+{
+	namespace
+	{
+		constexpr uint64_t kFnvOffset = 0xCBF29CE484222325ull;
+		constexpr uint64_t kFnvPrime = 0x100000001B3ull;
+
+		template <typename T>
+		void hashBytes(uint64_t& hash, const T* data, size_t count)
+		{
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < sizeof(T) * count; i++)
+			{
+				hash = (hash ^ bytes[i]) * kFnvPrime;
+			}
+		}
+
+		template <typename T>
+		void hashValue(uint64_t& hash, const T& value)
+		{
+			hashBytes(hash, &value, 1);
+		}
+	}
+
+	ModelViewerPipelineManager::ModelViewerPipelineManager(ModelViewerDevice& device, std::string vertShader, std::string fragShader, VkPipelineLayout pipelineLayout, VkRenderPass renderPass) :
+		modelViewerDevice{ device }, vertShader{ std::move(vertShader) }, fragShader{ std::move(fragShader) }, pipelineLayout{ pipelineLayout }, renderPass{ renderPass }
+	{
+	}
+
+	ModelViewerPipelineManager::~ModelViewerPipelineManager()
+	{
+		// Compiles capture this and write into entries.
+		if (ModelViewerJobSystem* jobSystem = ModelViewerJobSystem::current())
+		{
+			jobSystem->wait(compiles);
+		}
+	}
+
+	void ModelViewerPipelineManager::configure(const PipelineVariant& variant, PipelineConfigInfo& configInfo) const
+	{
+		ModelViewerPipeline::defaultPipelineConfigInfo(configInfo);
+		configInfo.renderPass = renderPass;
+		configInfo.pipelineLayout = pipelineLayout;
+		if (variant.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP)
+		{
+			ModelViewerPipeline::triangleStripConfigInfo(configInfo);
+		}
+
+		const RenderMode& renderMode = variant.renderMode;
+		const bool wireframe = renderMode.wireframe && modelViewerDevice.getCapabilities().fillModeNonSolid;
+		configInfo.rasterizationInfo.polygonMode = wireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
+		configInfo.rasterizationInfo.cullMode = renderMode.backfaceCulling ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
+		configInfo.specializationConstants = { renderMode.lightingModel };
+	}
+
+	uint64_t ModelViewerPipelineManager::hashConfig(const PipelineConfigInfo& configInfo) const
+	{
+		// Only the state defaultPipelineConfigInfo and configure() set; the rest is fixed.
+		uint64_t hash = kFnvOffset;
+		hashBytes(hash, vertShader.data(), vertShader.size());
+		hashBytes(hash, fragShader.data(), fragShader.size());
+		hashValue(hash, configInfo.inputAssemblyInfo.topology);
+		hashValue(hash, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+		hashValue(hash, configInfo.rasterizationInfo.polygonMode);
+		hashValue(hash, configInfo.rasterizationInfo.cullMode);
+		hashValue(hash, configInfo.rasterizationInfo.frontFace);
+		hashValue(hash, configInfo.rasterizationInfo.depthBiasEnable);
+		hashValue(hash, configInfo.multisampleInfo.rasterizationSamples);
+		hashValue(hash, configInfo.colorBlendAttachment);
+		hashValue(hash, configInfo.depthStencilInfo.depthTestEnable);
+		hashValue(hash, configInfo.depthStencilInfo.depthWriteEnable);
+		hashValue(hash, configInfo.depthStencilInfo.depthCompareOp);
+		hashBytes(hash, configInfo.dynamicStateEnables.data(), configInfo.dynamicStateEnables.size());
+		hashValue(hash, configInfo.pipelineLayout);
+		hashValue(hash, configInfo.renderPass);
+		hashValue(hash, configInfo.subpass);
+		hashBytes(hash, configInfo.specializationConstants.data(), configInfo.specializationConstants.size());
+		return hash;
+	}
+
+	std::unique_ptr<ModelViewerPipeline> ModelViewerPipelineManager::compile(const PipelineVariant& variant) const
+	{
+		PipelineConfigInfo configInfo{};
+		configure(variant, configInfo);
+		return std::make_unique<ModelViewerPipeline>(modelViewerDevice, vertShader, fragShader, configInfo);
+	}
+
+	void ModelViewerPipelineManager::prepare(const PipelineVariant& variant)
+	{
+		PipelineConfigInfo configInfo{};
+		configure(variant, configInfo);
+		const uint64_t key = hashConfig(configInfo);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		Entry& entry = entries[key];
+		if (!entry.pipeline)
+		{
+			entry.variant = variant;
+			entry.pipeline = compile(variant);
+		}
+	}
+
+	ModelViewerPipeline& ModelViewerPipelineManager::get(const PipelineVariant& variant)
+	{
+		PipelineConfigInfo configInfo{};
+		configure(variant, configInfo);
+		const uint64_t key = hashConfig(configInfo);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto [it, inserted] = entries.try_emplace(key);
+		Entry& entry = it->second;
+		if (entry.pipeline)
+		{
+			return *entry.pipeline;
+		}
+
+		ModelViewerPipeline* fallback = findFallback(variant);
+		ModelViewerJobSystem* jobSystem = ModelViewerJobSystem::current();
+		if (fallback == nullptr || jobSystem == nullptr)
+		{
+			// Nothing can stand in, so this frame has to wait for the compile.
+			entry.variant = variant;
+			entry.pipeline = compile(variant);
+			return *entry.pipeline;
+		}
+
+		if (inserted)
+		{
+			entry.variant = variant;
+			compilingCount++;
+			jobSystem->runBackground(compiles, [this, key, variant]()
+				{
+					std::unique_ptr<ModelViewerPipeline> pipeline;
+					try
+					{
+						pipeline = compile(variant);
+					}
+					catch (const std::exception& e)
+					{
+						// The fallback keeps drawing; the variant is not tried again.
+						std::cout << "Failed to compile pipeline variant: " << e.what() << std::endl;
+					}
+
+					std::lock_guard<std::mutex> lock{ mutex };
+					compilingCount--;
+					Entry& entry = entries[key];
+					entry.failed = pipeline == nullptr;
+					if (!entry.pipeline)
+					{
+						entry.pipeline = std::move(pipeline);
+					}
+				});
+		}
+		return *fallback;
+	}
+
+	ModelViewerPipeline* ModelViewerPipelineManager::findFallback(const PipelineVariant& variant) const
+	{
+		ModelViewerPipeline* fallback = nullptr;
+		int bestScore = -1;
+		for (const auto& [key, entry] : entries)
+		{
+			if (!entry.pipeline || entry.variant.topology != variant.topology)
+			{
+				continue;
+			}
+
+			const RenderMode& mode = entry.variant.renderMode;
+			const int score = (mode.lightingModel == variant.renderMode.lightingModel ? 2 : 0)
+				+ (mode.wireframe == variant.renderMode.wireframe ? 1 : 0)
+				+ (mode.backfaceCulling == variant.renderMode.backfaceCulling ? 1 : 0);
+			if (score > bestScore)
+			{
+				bestScore = score;
+				fallback = entry.pipeline.get();
+			}
+		}
+		return fallback;
+	}
+
+	uint32_t ModelViewerPipelineManager::getCompilingCount() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return compilingCount;
+	}
+
+	uint32_t ModelViewerPipelineManager::getFailedCount() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		uint32_t failedCount = 0;
+		for (const auto& [key, entry] : entries)
+		{
+			failedCount += entry.failed ? 1 : 0;
+		}
+		return failedCount;
+	}
+} // namespace ModelViewer
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Core/ModelViewerJobSystem.h"
+#include "ModelViewerDevice.h"
+#include "ModelViewerFrameInfo.h"
+#include "ModelViewerPipeline.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ModelViewer
+{
+	// Everything that may differ between the pipelines of one manager.
+	struct PipelineVariant
+	{
+		RenderMode renderMode{};
+		// Strips use primitive restart.
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		bool operator==(const PipelineVariant&) const = default;
+	};
+
+	// Graphics pipelines of one shader pair, layout and render pass, created on demand for
+	// each PipelineVariant and keyed by a hash of the resulting PipelineConfigInfo and its
+	// specialization constants. Variants compile on background workers; until one is
+	// ready, get() returns the closest ready variant with the same topology, so switching
+	// render modes never stalls a frame. Everything compiles through the device's
+	// pipeline cache, so variants seen before come back quickly.
+	class ModelViewerPipelineManager
+	{
+	public:
+		ModelViewerPipelineManager(ModelViewerDevice& device, std::string vertShader, std::string fragShader, VkPipelineLayout pipelineLayout, VkRenderPass renderPass);
+		// Waits for the compiles in flight. The device must be idle.
+		~ModelViewerPipelineManager();
+
+		ModelViewerPipelineManager(const ModelViewerPipelineManager&) = delete;
+		ModelViewerPipelineManager& operator=(const ModelViewerPipelineManager&) = delete;
+
+		// Compiles variant on the calling thread unless it is ready, for the variants the
+		// first frame draws with.
+		void prepare(const PipelineVariant& variant);
+
+		// The variant's pipeline once compiled, a stand-in otherwise; see above. Only
+		// compiles on the calling thread when no variant with the topology is ready.
+		ModelViewerPipeline& get(const PipelineVariant& variant);
+
+		uint32_t getCompilingCount() const;
+		// Variants whose background compile threw; they keep drawing with their fallback.
+		uint32_t getFailedCount() const;
+
+	private:
+		struct Entry
+		{
+			PipelineVariant variant;
+			// Null until compiled.
+			std::unique_ptr<ModelViewerPipeline> pipeline;
+			// Not compiled again; counted by getFailedCount().
+			bool failed = false;
+		};
+
+		void configure(const PipelineVariant& variant, PipelineConfigInfo& configInfo) const;
+		uint64_t hashConfig(const PipelineConfigInfo& configInfo) const;
+		std::unique_ptr<ModelViewerPipeline> compile(const PipelineVariant& variant) const;
+		// Ready variant sharing the topology and most of the render mode, or null.
+		ModelViewerPipeline* findFallback(const PipelineVariant& variant) const;
+
+		ModelViewerDevice& modelViewerDevice;
+		const std::string vertShader;
+		const std::string fragShader;
+		const VkPipelineLayout pipelineLayout;
+		const VkRenderPass renderPass;
+
+		mutable std::mutex mutex;
+		std::unordered_map<uint64_t, Entry> entries;
+		uint32_t compilingCount = 0;
+		ModelViewerJobSystem::TaskGroup compiles;
+	};
+} // namespace ModelViewer
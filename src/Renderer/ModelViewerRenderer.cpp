@@ -1,16 +1,18 @@
 #include "ModelViewerRenderer.h"
 #include "ModelViewerModel.h"
 #include "ModelViewerPipeline.h"
+#include "Core/ModelViewerJobSystem.h"
 
 #include <array>
 
 namespace ModelViewer
 {
-	ModelViewerRenderer::ModelViewerRenderer(std::shared_ptr<ModelViewerWindow> window, std::shared_ptr<ModelViewerDevice> device) :
-		modelViewerWindow{ window }, modelViewerDevice { device }
+	ModelViewerRenderer::ModelViewerRenderer(std::shared_ptr<ModelViewerWindow> window, std::shared_ptr<ModelViewerDevice> device, FramePacing framePacing) :
+		modelViewerWindow{ window }, modelViewerDevice { device }, framePacing{ framePacing }
 	{
 		recreateSwapChain();
 		createCommandBuffers();
+		commandRecorder = std::make_unique<ModelViewerCommandRecorder>(modelViewerDevice, jobThreadCount());
 	}
 
 	ModelViewerRenderer::~ModelViewerRenderer()
@@ -28,22 +30,25 @@ namespace ModelViewer
 			glfwWaitEvents();
 		}
 
-		vkDeviceWaitIdle(modelViewerDevice->device());
+		modelViewerDevice->waitIdle();
 
 		if (modelViewerSwapChain == nullptr)
 		{
-			modelViewerSwapChain = std::make_shared<ModelViewerSwapChain>(*modelViewerDevice, extent);
+			modelViewerSwapChain = std::make_shared<ModelViewerSwapChain>(*modelViewerDevice, extent, framePacing);
 		}
 		else
 		{
 			std::shared_ptr<ModelViewerSwapChain> oldSwapChain = std::move(modelViewerSwapChain);
-			modelViewerSwapChain = std::make_shared<ModelViewerSwapChain>(*modelViewerDevice, extent, oldSwapChain);
+			modelViewerSwapChain = std::make_shared<ModelViewerSwapChain>(*modelViewerDevice, extent, framePacing, oldSwapChain);
 
 			if (!oldSwapChain->compareSwapFormats(*modelViewerSwapChain))
 			{
 				throw std::runtime_error("Swap chain image or depth format has changed!");
 			}
 		}
+
+		// The device is idle, so the new swap chain's frame slots start over with ours.
+		currentFrameIndex = 0;
 	}
 
 	void ModelViewerRenderer::createCommandBuffers()
@@ -68,6 +73,12 @@ namespace ModelViewer
 		commandBuffers.clear();
 	}
 
+	void ModelViewerRenderer::waitForFramePacing()
+	{
+		modelViewerSwapChain->waitForPresent();
+		inputTime = std::chrono::steady_clock::now();
+	}
+
 	VkCommandBuffer ModelViewerRenderer::beginFrame()
 	{
 		assert(!isFrameStarted && "Can't call begin frame while already in progress!");
@@ -87,6 +98,20 @@ namespace ModelViewer
 			
 		isFrameStarted = true;
 
+		// acquireNextImage waited on this slot's fence, so every frame submitted at least
+		// framesInFlight frames ago has completed.
+		const uint32_t framesInFlight = modelViewerSwapChain->framesInFlight();
+		if (frameNumber > framesInFlight)
+		{
+			modelViewerDevice->getDeletionQueue().retire(frameNumber - framesInFlight);
+		}
+		// The slot's transient ranges from its last use are idle too.
+		modelViewerDevice->getAllocator().resetTransient(currentFrameIndex);
+
+		// The fence waited on by acquireNextImage guarantees this slot's secondaries are idle.
+		commandRecorder->beginFrame(currentFrameIndex, modelViewerSwapChain->getRenderPass(),
+			modelViewerSwapChain->getFrameBuffer(currentImageIndex), modelViewerSwapChain->getSwapChainExtent());
+
 		auto commandBuffer = getCurrentCommandBuffer();
 
 		VkCommandBufferBeginInfo beginInfo{};
@@ -111,9 +136,17 @@ namespace ModelViewer
 			throw std::runtime_error("Failed to record command buffer!");
 		}
 
-		auto result = modelViewerSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+		// Pending mesh uploads go first so their barrier orders them before this frame.
+		modelViewerDevice->flushUploads();
+
+		auto result = modelViewerSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex, inputTime);
 
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || modelViewerWindow->wasWindowResized())
+		isFrameStarted = false;
+		currentFrameIndex = (currentFrameIndex + 1) % modelViewerSwapChain->framesInFlight();
+		modelViewerDevice->getDeletionQueue().setRecordingFrame(++frameNumber);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || modelViewerWindow->wasWindowResized()
+			|| modelViewerSwapChain->getFramePacing() != framePacing)
 		{
 			modelViewerWindow->resetWindowResizedFlag();
 			recreateSwapChain();
@@ -123,9 +156,6 @@ namespace ModelViewer
 		{
 			throw std::runtime_error("Failed to present swap chain image!");
 		}
-
-		isFrameStarted = false;
-		currentFrameIndex = (currentFrameIndex + 1) % ModelViewerSwapChain::MAX_FRAMES_IN_FLIGHT;
 	}
 
 	void ModelViewerRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
@@ -147,21 +177,8 @@ namespace ModelViewer
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(modelViewerSwapChain->getSwapChainExtent().width);
-		viewport.height = static_cast<float>(modelViewerSwapChain->getSwapChainExtent().height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		VkRect2D scissor{ {0,0}, modelViewerSwapChain->getSwapChainExtent() };
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-
-
+		// Viewport and scissor are set by each secondary command buffer instead.
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 	}
 
 	void ModelViewerRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer)
@@ -2,8 +2,10 @@
 
 #include "ModelViewerWindow.h"
 #include "ModelViewerSwapChain.h"
+#include "ModelViewerCommandRecorder.h"
 #include "glm/glm.hpp"
 
+#include <chrono>
 #include <memory>
 #include <cassert>
 
@@ -12,15 +14,24 @@ namespace ModelViewer
 	class ModelViewerRenderer
 	{
 	public:
-		ModelViewerRenderer(std::shared_ptr<ModelViewerWindow> window, std::shared_ptr<ModelViewerDevice> device);
+		ModelViewerRenderer(std::shared_ptr<ModelViewerWindow> window, std::shared_ptr<ModelViewerDevice> device, FramePacing framePacing = FramePacing::Throughput);
 		~ModelViewerRenderer();
 
 		ModelViewerRenderer(const ModelViewerRenderer&) = delete;
 		ModelViewerRenderer& operator=(const ModelViewerRenderer&) = delete;
 
+		// Paces the loop according to the frame pacing; call right before polling input,
+		// which the next frame's latency is measured from.
+		void waitForFramePacing();
 		VkCommandBuffer beginFrame();
 		void endFrame();
 
+		// Takes effect after the current frame, by recreating the swap chain.
+		void setFramePacing(FramePacing pacing) { framePacing = pacing; }
+		FramePacing getFramePacing() const { return framePacing; }
+
+		// The render pass takes its contents from secondary command buffers recorded through
+		// getCommandRecorder(), so nothing but vkCmdExecuteCommands may go into it directly.
 		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
@@ -39,6 +50,8 @@ namespace ModelViewer
 			return currentFrameIndex;
 		}
 
+		ModelViewerCommandRecorder& getCommandRecorder() { return *commandRecorder; }
+
 		VkRenderPass getSwapChainRenderPass() const { return modelViewerSwapChain->getRenderPass(); }
 		float getAspectRatio() const { return modelViewerSwapChain->extentAspectRatio(); }
 
@@ -51,9 +64,14 @@ namespace ModelViewer
 		std::shared_ptr<ModelViewerDevice> modelViewerDevice;
 		std::shared_ptr<ModelViewerSwapChain> modelViewerSwapChain;
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::unique_ptr<ModelViewerCommandRecorder> commandRecorder;
 
 		uint32_t currentImageIndex;
+		// Numbered from 1; the frame being recorded, or the next one between frames.
+		uint64_t frameNumber{ 1 };
 		int currentFrameIndex{ 0 };
 		bool isFrameStarted{ false };
+		FramePacing framePacing;
+		std::chrono::steady_clock::time_point inputTime = std::chrono::steady_clock::now();
 	};
 } // namespace ModelViewer
\ No newline at end of file
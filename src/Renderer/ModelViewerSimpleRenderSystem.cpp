@@ -1,18 +1,25 @@
 #include "ModelViewerSimpleRenderSystem.h"
+#include "ModelViewerCommandRecorder.h"
+#include "Core/ModelViewerJobSystem.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
-#include <glm/gtx/euler_angles.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <array>
 
 namespace ModelViewer
 {
+	namespace
+	{
+		// Fewer draws than this are not worth a secondary command buffer of their own.
+		constexpr size_t kDrawsPerChunk = 1024;
+	}
+
 	ModelViewerSimpleRenderSystem::ModelViewerSimpleRenderSystem(std::shared_ptr<ModelViewerDevice> device, VkRenderPass renderPass) : modelViewerDevice { device }
 	{
 		createPipelineLayout();
@@ -49,40 +56,179 @@ namespace ModelViewer
 	{
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-		PipelineConfigInfo pipelineConfig{};
-		ModelViewerPipeline::defaultPipelineConfigInfo(pipelineConfig);
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-
-		modelViewerPipeline = std::make_unique<ModelViewerPipeline>(*modelViewerDevice,
-			"..\\src\\shaders\\simple_shader.vert.spv",
-			"..\\src\\shaders\\simple_shader.frag.spv",
-			pipelineConfig);
+		pipelineManager = std::make_unique<ModelViewerPipelineManager>(*modelViewerDevice,
+			"simple_shader.vert",
+			"simple_shader.frag",
+			pipelineLayout,
+			renderPass);
 
+		// The default render mode is compiled up front; other modes compile when selected.
+		pipelineManager->prepare({ RenderMode{}, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST });
+		pipelineManager->prepare({ RenderMode{}, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP });
 	}
 
-	void ModelViewerSimpleRenderSystem::renderModelObjects(VkCommandBuffer commandBuffer, std::vector<ModelViewerObject>& modelObjects, const ModelViewerCamera& camera)
+	void ModelViewerSimpleRenderSystem::renderModelObjects(FrameInfo& frameInfo, std::vector<ModelViewerObject>& modelObjects, const ModelViewerTransformSystem& transforms)
 	{
-		modelViewerPipeline->bind(commandBuffer);
-		float width = (float)modelViewerDevice->getWindow().getWidth();
-		float height = (float)modelViewerDevice->getWindow().getHeight();
+		if (modelObjects.empty())
+		{
+			return;
+		}
 
-		auto projectionView = camera.getProjection() * camera.getView();
+		// Counting sort of the objects by model and LOD: count the group sizes, turn them into
+		// offsets, then scatter each world matrix into its group's slice of the buffer.
+		groupLookup.clear();
+		instanceGroups.clear();
+		objectInstances.clear();
+		lodSelector.beginFrame(frameInfo.frameTime, frameInfo.lodCrossFade);
 
-		for (auto& object : modelObjects)
+		auto addInstance = [&](uint32_t object, uint32_t lod, float lodFade)
+		{
+			ModelViewerModel* model = modelObjects[object].model.get();
+			uint32_t group = kNoGroup;
+			if (lodFade == 0.0f)
+			{
+				auto [it, inserted] = groupLookup.try_emplace(model);
+				if (inserted)
+				{
+					it->second.fill(kNoGroup);
+				}
+				if (it->second[lod] == kNoGroup)
+				{
+					it->second[lod] = static_cast<uint32_t>(instanceGroups.size());
+					instanceGroups.push_back({ model, lod, 0.0f, 0, 0 });
+				}
+				group = it->second[lod];
+			}
+			else
+			{
+				group = static_cast<uint32_t>(instanceGroups.size());
+				instanceGroups.push_back({ model, lod, lodFade, 0, 0 });
+			}
+			instanceGroups[group].instanceCount++;
+			objectInstances.push_back({ object, group });
+		};
+
+		for (uint32_t i = 0; i < modelObjects.size(); i++)
 		{
-			glm::mat4 cameraTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10));
+			const ModelViewerModel& model = *modelObjects[i].model;
+			if (frameInfo.lodErrorScale <= 0.0f || model.getLods().size() < 2)
+			{
+				addInstance(i, 0, 0.0f);
+				continue;
+			}
+
+			const float pixelsPerError = ModelViewerLodSelector::pixelsPerError(frameInfo.lodErrorScale, frameInfo.cameraPosition,
+				transforms.getWorldMatrix(modelObjects[i].transform), model.getBoundingSphere());
+			const ModelViewerLodSelector::Selection selection = lodSelector.update(modelObjects[i].transform, model.getLods(), pixelsPerError);
+			if (selection.isFading())
+			{
+				// The two LODs dither with complementary patterns, so every pixel shows one.
+				addInstance(i, selection.previousLod, -selection.fade);
+				addInstance(i, selection.lod, selection.fade);
+			}
+			else
+			{
+				addInstance(i, selection.lod, 0.0f);
+			}
+		}
 
-			SimplePushConstantData push{};
-			push.viewProjection = glm::perspectiveFov(glm::radians(45.f), width, height, 0.1f, 100.0f)
-				* glm::inverse(cameraTransform);
+		// Order the groups by geometry page so each page is bound once, and by topology
+		// within a page to keep pipeline switches down.
+		groupOrder.resize(instanceGroups.size());
+		for (uint32_t i = 0; i < groupOrder.size(); i++)
+		{
+			groupOrder[i] = i;
+		}
+		std::sort(groupOrder.begin(), groupOrder.end(), [&](uint32_t a, uint32_t b)
+		{
+			const ModelViewerModel& modelA = *instanceGroups[a].model;
+			const ModelViewerModel& modelB = *instanceGroups[b].model;
+			if (modelA.getGeometry().page != modelB.getGeometry().page)
+			{
+				return modelA.getGeometry().page < modelB.getGeometry().page;
+			}
+			return modelA.getTopology() < modelB.getTopology();
+		});
+
+		uint32_t instanceCount = 0;
+		for (uint32_t group : groupOrder)
+		{
+			instanceGroups[group].firstInstance = instanceCount;
+			instanceCount += instanceGroups[group].instanceCount;
+			instanceGroups[group].instanceCount = 0;
+		}
 
+		const ModelViewerAllocation instanceAllocation = modelViewerDevice->getAllocator().allocateTransient(
+			sizeof(ModelViewerModel::Instance) * std::max(instanceCount, 1u),
+			alignof(ModelViewerModel::Instance),
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-			push.transform = glm::translate(glm::mat4(1.0f), object.transform.translation) * glm::eulerAngleYXZ(glm::radians(object.transform.rotation.y), glm::radians(object.transform.rotation.x), glm::radians(object.transform.rotation.z));
+		auto* instances = static_cast<ModelViewerModel::Instance*>(instanceAllocation.mapped);
+		for (const ObjectInstance& objectInstance : objectInstances)
+		{
+			InstanceGroup& group = instanceGroups[objectInstance.group];
+			instances[group.firstInstance + group.instanceCount++].transform = transforms.getWorldMatrix(modelObjects[objectInstance.object].transform) * group.model->getDequantization();
+		}
+
+		trianglePipeline = &pipelineManager->get({ frameInfo.renderMode, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST });
+		stripPipeline = &pipelineManager->get({ frameInfo.renderMode, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP });
+
+		// Each chunk of draws goes to its own recording pool. Secondaries carry a fixed cost,
+		// so small scenes are kept in as few chunks as possible.
+		ModelViewerCommandRecorder& commandRecorder = *frameInfo.commandRecorder;
+		const size_t drawCount = groupOrder.size();
+		const size_t chunkCount = std::clamp<size_t>((drawCount + kDrawsPerChunk - 1) / kDrawsPerChunk, 1, commandRecorder.getPoolCount());
+		secondaryBuffers.resize(chunkCount);
+
+		parallelFor(chunkCount, [&](size_t chunk)
+		{
+			VkCommandBuffer commandBuffer = commandRecorder.beginSecondary(static_cast<uint32_t>(chunk));
+			recordDraws(commandBuffer, frameInfo, instanceAllocation, drawCount * chunk / chunkCount, drawCount * (chunk + 1) / chunkCount);
+			commandRecorder.endSecondary(commandBuffer);
+			secondaryBuffers[chunk] = commandBuffer;
+		});
+
+		vkCmdExecuteCommands(frameInfo.commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+	}
 
-			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
-			object.model->bind(commandBuffer);
-			object.model->draw(commandBuffer);
+	void ModelViewerSimpleRenderSystem::recordDraws(VkCommandBuffer commandBuffer, const FrameInfo& frameInfo, const ModelViewerAllocation& instances, size_t first, size_t end)
+	{
+		trianglePipeline->bind(commandBuffer);
+
+		SimplePushConstantData push{};
+		push.viewProjection = frameInfo.viewProjection;
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+
+		VkBuffer buffers[] = { instances.buffer };
+		VkDeviceSize offsets[] = { instances.offset };
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, buffers, offsets);
+
+		ModelViewerGeometryPool& geometryPool = modelViewerDevice->getGeometryPool();
+		uint32_t boundPage = ModelViewerGeometryPool::INVALID_PAGE;
+		bool stripsBound = false;
+
+		for (size_t i = first; i < end; i++)
+		{
+			const InstanceGroup& instanceGroup = instanceGroups[groupOrder[i]];
+			const bool strips = instanceGroup.model->getTopology() == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+			if (strips != stripsBound)
+			{
+				(strips ? stripPipeline : trianglePipeline)->bind(commandBuffer);
+				stripsBound = strips;
+			}
+
+			const uint32_t page = instanceGroup.model->getGeometry().page;
+			if (page != boundPage)
+			{
+				geometryPool.bind(commandBuffer, page);
+				boundPage = page;
+			}
+			if (instanceGroup.lodFade != push.lodFade)
+			{
+				push.lodFade = instanceGroup.lodFade;
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+			}
+			instanceGroup.model->draw(commandBuffer, instanceGroup.instanceCount, instanceGroup.firstInstance, instanceGroup.lod);
 		}
 	}
 } // namespace ModelViewer
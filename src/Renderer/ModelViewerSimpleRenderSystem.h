@@ -2,10 +2,15 @@
 
 #include "Camera/ModelViewerCamera.h"
 #include "ModelViewerDevice.h"
-#include "ModelViewerPipeline.h"
+#include "ModelViewerFrameInfo.h"
+#include "ModelViewerLodSelector.h"
+#include "ModelViewerPipelineManager.h"
 #include "ModelViewerObject.h"
+#include "ModelViewerSwapChain.h"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace ModelViewer
@@ -13,7 +18,9 @@ namespace ModelViewer
 	struct SimplePushConstantData
 	{
 		glm::mat4 viewProjection{ 1.f };
-		glm::mat4 transform{ 1.f };
+		// Dithered LOD cross-fade: above 0 the fragment survives where the dither threshold is
+		// below it, below 0 where the threshold is at or above its magnitude, 0 is opaque.
+		float lodFade = 0.0f;
 	};
 
 	class ModelViewerSimpleRenderSystem
@@ -25,14 +32,50 @@ namespace ModelViewer
 		ModelViewerSimpleRenderSystem(const ModelViewerSimpleRenderSystem&) = delete;
 		ModelViewerSimpleRenderSystem& operator=(const ModelViewerSimpleRenderSystem&) = delete;
 
-		void renderModelObjects(VkCommandBuffer commandBuffer, std::vector<ModelViewerObject>& modelObjects, const ModelViewerCamera& camera);
+		// Objects sharing a model and LOD are drawn with a single instanced draw; their world
+		// matrices are copied into this frame's instance buffer. Objects cross-fading between
+		// LODs get draws of their own. Large draw lists are split across worker threads, each
+		// recording its own secondary command buffer.
+		void renderModelObjects(FrameInfo& frameInfo, std::vector<ModelViewerObject>& modelObjects, const ModelViewerTransformSystem& transforms);
+
+		uint32_t getCompilingPipelineCount() const { return pipelineManager->getCompilingCount(); }
+		uint32_t getFailedPipelineCount() const { return pipelineManager->getFailedCount(); }
 	private:
-;
+		struct InstanceGroup
+		{
+			ModelViewerModel* model;
+			uint32_t lod;
+			float lodFade;
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+		};
+
+		struct ObjectInstance
+		{
+			uint32_t object;
+			uint32_t group;
+		};
+
+		static constexpr uint32_t kNoGroup = ~0u;
+
 		void createPipelineLayout();
 		void createPipeline(VkRenderPass renderPass);
+		// Records the instance groups groupOrder[first, end) into commandBuffer.
+		void recordDraws(VkCommandBuffer commandBuffer, const FrameInfo& frameInfo, const ModelViewerAllocation& instances, size_t first, size_t end);
 
 		std::shared_ptr<ModelViewerDevice> modelViewerDevice;
-		std::unique_ptr<ModelViewerPipeline> modelViewerPipeline;
+		std::unique_ptr<ModelViewerPipelineManager> pipelineManager;
+		// This frame's variants, picked before recording starts on the workers.
+		ModelViewerPipeline* trianglePipeline = nullptr;
+		ModelViewerPipeline* stripPipeline = nullptr;
 		VkPipelineLayout pipelineLayout;
+
+		ModelViewerLodSelector lodSelector;
+		// Opaque group of each LOD of a model.
+		std::unordered_map<ModelViewerModel*, std::array<uint32_t, ModelViewerModel::kMaxLods>> groupLookup;
+		std::vector<InstanceGroup> instanceGroups;
+		std::vector<ObjectInstance> objectInstances;
+		std::vector<uint32_t> groupOrder;
+		std::vector<VkCommandBuffer> secondaryBuffers;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,539 @@
+#include "ModelViewerTransformSystem.h"
+#include "Core/ModelViewerJobSystem.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MODELVIEWER_TRANSFORM_SSE
+#include <emmintrin.h>
+#endif
+
+namespace ModelViewer
+{
+	namespace
+	{
+		// Below this many dirty transforms the update is not worth spreading across threads.
+		constexpr size_t kParallelThreshold = 16384;
+
+		struct ScalarLanes
+		{
+			using Vector = float;
+			static constexpr uint32_t Width = 1;
+
+			static Vector zero() { return 0.0f; }
+			static Vector load(const float* source) { return *source; }
+			static void store(float* destination, Vector value) { *destination = value; }
+			static Vector add(Vector a, Vector b) { return a + b; }
+			static Vector sub(Vector a, Vector b) { return a - b; }
+			static Vector mul(Vector a, Vector b) { return a * b; }
+		};
+
+#if defined(__AVX2__)
+		struct BatchLanes
+		{
+			using Vector = __m256;
+			static constexpr uint32_t Width = 8;
+
+			static Vector zero() { return _mm256_setzero_ps(); }
+			static Vector load(const float* source) { return _mm256_loadu_ps(source); }
+			static void store(float* destination, Vector value) { _mm256_storeu_ps(destination, value); }
+			static Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+			static Vector sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+			static Vector mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+		};
+#elif defined(MODELVIEWER_TRANSFORM_SSE)
+		struct BatchLanes
+		{
+			using Vector = __m128;
+			static constexpr uint32_t Width = 4;
+
+			static Vector zero() { return _mm_setzero_ps(); }
+			static Vector load(const float* source) { return _mm_loadu_ps(source); }
+			static void store(float* destination, Vector value) { _mm_storeu_ps(destination, value); }
+			static Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+			static Vector sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+			static Vector mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+		};
+#else
+		using BatchLanes = ScalarLanes;
+#endif
+	}
+
+	glm::mat4 TransformComponent::mat4() const
+	{
+		const float ch = glm::cos(rotation.y);
+		const float sh = glm::sin(rotation.y);
+		const float cp = glm::cos(rotation.x);
+		const float sp = glm::sin(rotation.x);
+		const float cb = glm::cos(rotation.z);
+		const float sb = glm::sin(rotation.z);
+		return glm::mat4{
+			{
+				scale.x * (ch * cb + sh * sp * sb),
+				scale.x * (sb * cp),
+				scale.x * (ch * sp * sb - sh * cb),
+				0.0f,
+			},
+			{
+				scale.y * (sh * sp * cb - ch * sb),
+				scale.y * (cb * cp),
+				scale.y * (sb * sh + ch * sp * cb),
+				0.0f,
+			},
+			{
+				scale.z * (sh * cp),
+				scale.z * (-sp),
+				scale.z * (ch * cp),
+				0.0f,
+			},
+			{translation.x, translation.y, translation.z, 1.0f}
+		};
+	}
+
+	template<typename Function>
+	void ModelViewerTransformSystem::forEachDenseArray(Function&& function)
+	{
+		for (auto& column : columns)
+		{
+			function(column);
+		}
+		function(localMatrices);
+		function(worldMatrices);
+		function(parents);
+		function(subtreeSizes);
+		function(denseHandles);
+	}
+
+	void ModelViewerTransformSystem::reindex(uint32_t first, uint32_t end)
+	{
+		for (uint32_t index = first; index < end; index++)
+		{
+			sparse[denseHandles[index]] = index;
+		}
+	}
+
+	void ModelViewerTransformSystem::adjustSubtreeSizes(Handle ancestor, int32_t delta)
+	{
+		for (; ancestor != INVALID_HANDLE; ancestor = parents[sparse[ancestor]])
+		{
+			subtreeSizes[sparse[ancestor]] += delta;
+		}
+	}
+
+	ModelViewerTransformSystem::Handle ModelViewerTransformSystem::create(const TransformComponent& transform, Handle parent)
+	{
+		assert((parent == INVALID_HANDLE || isValid(parent)) && "Creating a transform under an invalid parent!");
+
+		Handle handle;
+		if (!freeHandles.empty())
+		{
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		else
+		{
+			handle = static_cast<Handle>(sparse.size());
+			sparse.push_back(INVALID_HANDLE);
+		}
+
+		// A new child goes at the end of its parent's subtree to keep the preorder.
+		const uint32_t count = static_cast<uint32_t>(denseHandles.size());
+		uint32_t index = count;
+		if (parent != INVALID_HANDLE)
+		{
+			index = sparse[parent] + subtreeSizes[sparse[parent]];
+		}
+
+		auto insert = [index](auto& array, auto value) { array.insert(array.begin() + index, value); };
+		for (auto& column : columns)
+		{
+			insert(column, 0.0f);
+		}
+		insert(localMatrices, glm::mat4{ 1.0f });
+		insert(worldMatrices, glm::mat4{ 1.0f });
+		insert(parents, parent);
+		insert(subtreeSizes, 1u);
+		insert(denseHandles, handle);
+		if (dirtyBits.size() * 64 < denseHandles.size())
+		{
+			dirtyBits.push_back(0);
+		}
+
+		adjustSubtreeSizes(parent, 1);
+		reindex(index, count + 1);
+
+		writeTranslation(index, transform.translation);
+		writeRotation(index, transform.rotation);
+		writeScale(index, transform.scale);
+		if (index != count)
+		{
+			// The dirty bits of everything behind the insertion point no longer line up.
+			markAllDirty();
+		}
+		markDirty(index);
+		return handle;
+	}
+
+	void ModelViewerTransformSystem::destroy(Handle handle)
+	{
+		assert(isValid(handle) && "Destroying an invalid transform handle!");
+
+		const uint32_t index = sparse[handle];
+		const uint32_t subtreeEnd = index + subtreeSizes[index];
+		const Handle parent = parents[index];
+		for (uint32_t child = index + 1; child < subtreeEnd; child += subtreeSizes[child])
+		{
+			parents[child] = parent;
+		}
+		adjustSubtreeSizes(parent, -1);
+
+		forEachDenseArray([index](auto& array) { array.erase(array.begin() + index); });
+		const uint32_t count = static_cast<uint32_t>(denseHandles.size());
+		reindex(index, count);
+		sparse[handle] = INVALID_HANDLE;
+		freeHandles.push_back(handle);
+
+		// Removing the last transform leaves at most its own stale bit behind; anything else
+		// shifts the dirty bits and reparents children, so it all has to be rebuilt.
+		uint64_t& word = dirtyBits[count / 64];
+		const uint64_t bit = 1ull << (count % 64);
+		if (word & bit)
+		{
+			word &= ~bit;
+			dirtyCount--;
+		}
+		if (index != count)
+		{
+			markAllDirty();
+		}
+	}
+
+	void ModelViewerTransformSystem::setParent(Handle handle, Handle parent)
+	{
+		assert(isValid(handle) && "Reparenting an invalid transform handle!");
+		assert((parent == INVALID_HANDLE || isValid(parent)) && "Reparenting under an invalid parent!");
+
+		const uint32_t index = sparse[handle];
+		const uint32_t size = subtreeSizes[index];
+		if (parent != INVALID_HANDLE && sparse[parent] >= index && sparse[parent] < index + size)
+		{
+			throw std::runtime_error("Cannot parent a transform to itself or one of its descendants!");
+		}
+
+		const Handle oldParent = parents[index];
+		if (oldParent == parent)
+		{
+			return;
+		}
+
+		// The subtree moves as one block to the end of the new parent's subtree.
+		const uint32_t count = static_cast<uint32_t>(denseHandles.size());
+		const uint32_t destination = parent != INVALID_HANDLE ? sparse[parent] + subtreeSizes[sparse[parent]] : count;
+
+		adjustSubtreeSizes(oldParent, -static_cast<int32_t>(size));
+		adjustSubtreeSizes(parent, static_cast<int32_t>(size));
+		parents[index] = parent;
+
+		uint32_t first, middle, end;
+		if (destination > index)
+		{
+			first = index;
+			middle = index + size;
+			end = destination;
+		}
+		else
+		{
+			first = destination;
+			middle = index;
+			end = index + size;
+		}
+		forEachDenseArray([&](auto& array) { std::rotate(array.begin() + first, array.begin() + middle, array.begin() + end); });
+		reindex(first, end);
+		markAllDirty();
+	}
+
+	TransformComponent ModelViewerTransformSystem::get(Handle handle) const
+	{
+		const uint32_t index = sparse[handle];
+
+		TransformComponent transform{};
+		transform.translation = { columns[TranslationX][index], columns[TranslationY][index], columns[TranslationZ][index] };
+		transform.rotation = { columns[RotationX][index], columns[RotationY][index], columns[RotationZ][index] };
+		transform.scale = { columns[ScaleX][index], columns[ScaleY][index], columns[ScaleZ][index] };
+		return transform;
+	}
+
+	void ModelViewerTransformSystem::set(Handle handle, const TransformComponent& transform)
+	{
+		const uint32_t index = sparse[handle];
+		writeTranslation(index, transform.translation);
+		writeRotation(index, transform.rotation);
+		writeScale(index, transform.scale);
+		markDirty(index);
+	}
+
+	void ModelViewerTransformSystem::setTranslation(Handle handle, const glm::vec3& translation)
+	{
+		const uint32_t index = sparse[handle];
+		writeTranslation(index, translation);
+		markDirty(index);
+	}
+
+	void ModelViewerTransformSystem::setRotation(Handle handle, const glm::vec3& rotation)
+	{
+		const uint32_t index = sparse[handle];
+		writeRotation(index, rotation);
+		markDirty(index);
+	}
+
+	void ModelViewerTransformSystem::setScale(Handle handle, const glm::vec3& scale)
+	{
+		const uint32_t index = sparse[handle];
+		writeScale(index, scale);
+		markDirty(index);
+	}
+
+	void ModelViewerTransformSystem::writeTranslation(uint32_t index, const glm::vec3& translation)
+	{
+		columns[TranslationX][index] = translation.x;
+		columns[TranslationY][index] = translation.y;
+		columns[TranslationZ][index] = translation.z;
+	}
+
+	void ModelViewerTransformSystem::writeRotation(uint32_t index, const glm::vec3& rotation)
+	{
+		columns[RotationX][index] = rotation.x;
+		columns[RotationY][index] = rotation.y;
+		columns[RotationZ][index] = rotation.z;
+
+		// The trigonometry is paid once per edit rather than on every matrix rebuild.
+		columns[CosYaw][index] = std::cos(rotation.y);
+		columns[SinYaw][index] = std::sin(rotation.y);
+		columns[CosPitch][index] = std::cos(rotation.x);
+		columns[SinPitch][index] = std::sin(rotation.x);
+		columns[CosRoll][index] = std::cos(rotation.z);
+		columns[SinRoll][index] = std::sin(rotation.z);
+	}
+
+	void ModelViewerTransformSystem::writeScale(uint32_t index, const glm::vec3& scale)
+	{
+		columns[ScaleX][index] = scale.x;
+		columns[ScaleY][index] = scale.y;
+		columns[ScaleZ][index] = scale.z;
+	}
+
+	void ModelViewerTransformSystem::markDirty(uint32_t index)
+	{
+		uint64_t& word = dirtyBits[index / 64];
+		const uint64_t bit = 1ull << (index % 64);
+		if (!(word & bit))
+		{
+			word |= bit;
+			dirtyCount++;
+		}
+	}
+
+	void ModelViewerTransformSystem::markAllDirty()
+	{
+		const size_t count = denseHandles.size();
+		std::fill(dirtyBits.begin(), dirtyBits.end(), 0);
+		std::fill(dirtyBits.begin(), dirtyBits.begin() + count / 64, ~0ull);
+		if (count % 64 != 0)
+		{
+			dirtyBits[count / 64] = (1ull << (count % 64)) - 1;
+		}
+		dirtyCount = count;
+	}
+
+	// local = translate * eulerAngleYXZ(yaw, pitch, roll) * scale
+	template<typename Lanes>
+	void ModelViewerTransformSystem::computeLocalMatrices(size_t first)
+	{
+		using V = typename Lanes::Vector;
+		auto load = [&](Column column) { return Lanes::load(columns[column].data() + first); };
+
+		const V tx = load(TranslationX), ty = load(TranslationY), tz = load(TranslationZ);
+		const V sx = load(ScaleX), sy = load(ScaleY), sz = load(ScaleZ);
+		const V ch = load(CosYaw), sh = load(SinYaw), cp = load(CosPitch), sp = load(SinPitch), cb = load(CosRoll), sb = load(SinRoll);
+
+		const V shsp = Lanes::mul(sh, sp);
+		const V chsp = Lanes::mul(ch, sp);
+
+		V elements[12];
+		elements[0] = Lanes::mul(sx, Lanes::add(Lanes::mul(ch, cb), Lanes::mul(shsp, sb)));
+		elements[1] = Lanes::mul(sx, Lanes::mul(sb, cp));
+		elements[2] = Lanes::mul(sx, Lanes::sub(Lanes::mul(chsp, sb), Lanes::mul(sh, cb)));
+		elements[3] = Lanes::mul(sy, Lanes::sub(Lanes::mul(shsp, cb), Lanes::mul(ch, sb)));
+		elements[4] = Lanes::mul(sy, Lanes::mul(cb, cp));
+		elements[5] = Lanes::mul(sy, Lanes::add(Lanes::mul(sb, sh), Lanes::mul(chsp, cb)));
+		elements[6] = Lanes::mul(sz, Lanes::mul(sh, cp));
+		elements[7] = Lanes::mul(sz, Lanes::sub(Lanes::zero(), sp));
+		elements[8] = Lanes::mul(sz, Lanes::mul(ch, cp));
+		elements[9] = tx;
+		elements[10] = ty;
+		elements[11] = tz;
+
+		alignas(32) float lanes[12][Lanes::Width];
+		for (int i = 0; i < 12; i++)
+		{
+			Lanes::store(lanes[i], elements[i]);
+		}
+
+		for (uint32_t lane = 0; lane < Lanes::Width; lane++)
+		{
+			glm::mat4& local = localMatrices[first + lane];
+			local[0] = glm::vec4(lanes[0][lane], lanes[1][lane], lanes[2][lane], 0.0f);
+			local[1] = glm::vec4(lanes[3][lane], lanes[4][lane], lanes[5][lane], 0.0f);
+			local[2] = glm::vec4(lanes[6][lane], lanes[7][lane], lanes[8][lane], 0.0f);
+			local[3] = glm::vec4(lanes[9][lane], lanes[10][lane], lanes[11][lane], 1.0f);
+		}
+	}
+
+	void ModelViewerTransformSystem::updateWord(size_t word)
+	{
+		constexpr uint32_t width = BatchLanes::Width;
+		constexpr uint64_t batchMask = (1ull << width) - 1;
+
+		uint64_t bits = dirtyBits[word];
+		while (bits != 0)
+		{
+			const uint32_t bit = static_cast<uint32_t>(std::countr_zero(bits));
+			const uint32_t batchBit = bit & ~(width - 1);
+			const size_t batchFirst = word * 64 + batchBit;
+
+			// A whole batch is rebuilt even if only some of it is dirty; the clean lanes
+			// just reproduce their current matrix.
+			if (batchFirst + width <= denseHandles.size())
+			{
+				computeLocalMatrices<BatchLanes>(batchFirst);
+				bits &= ~(batchMask << batchBit);
+			}
+			else
+			{
+				computeLocalMatrices<ScalarLanes>(word * 64 + bit);
+				bits &= bits - 1;
+			}
+		}
+		dirtyBits[word] = 0;
+	}
+
+	void ModelViewerTransformSystem::computeWorldMatrix(uint32_t index)
+	{
+		const Handle parent = parents[index];
+		worldMatrices[index] = parent == INVALID_HANDLE
+			? localMatrices[index]
+			: worldMatrices[sparse[parent]] * localMatrices[index];
+	}
+
+	void ModelViewerTransformSystem::propagateWorldMatrices()
+	{
+		size_t total = 0;
+		for (const DirtyRange& range : dirtyRanges)
+		{
+			total += range.end - range.first;
+		}
+
+		auto propagate = [this](const DirtyRange& range)
+		{
+			for (uint32_t index = range.first; index < range.end; index++)
+			{
+				computeWorldMatrix(index);
+			}
+		};
+
+		if (total < kParallelThreshold)
+		{
+			for (const DirtyRange& range : dirtyRanges)
+			{
+				propagate(range);
+			}
+			return;
+		}
+
+		// One large dirty subtree would leave the other threads idle, so big ranges are split:
+		// the root is resolved here and each child subtree becomes a range of its own.
+		const size_t targetRanges = static_cast<size_t>(jobThreadCount()) * 4;
+		const uint32_t grain = static_cast<uint32_t>(std::max<size_t>(total / targetRanges, 64));
+		bool split = true;
+		while (split && dirtyRanges.size() < targetRanges)
+		{
+			split = false;
+			splitRanges.clear();
+			for (const DirtyRange& range : dirtyRanges)
+			{
+				if (range.end - range.first <= grain)
+				{
+					splitRanges.push_back(range);
+					continue;
+				}
+
+				computeWorldMatrix(range.first);
+				for (uint32_t child = range.first + 1; child < range.end; child += subtreeSizes[child])
+				{
+					splitRanges.push_back({ child, child + subtreeSizes[child] });
+				}
+				split = true;
+			}
+			std::swap(dirtyRanges, splitRanges);
+		}
+
+		parallelFor(dirtyRanges.size(), [&](size_t i) { propagate(dirtyRanges[i]); });
+	}
+
+	void ModelViewerTransformSystem::update()
+	{
+		changedHandles.clear();
+		if (dirtyCount == 0)
+		{
+			return;
+		}
+
+		// A dirty transform invalidates the world matrix of its whole subtree. Subtrees are
+		// contiguous in preorder, so the dirty transforms collapse into disjoint ranges, and
+		// nothing in one range depends on another.
+		dirtyRanges.clear();
+		uint32_t coveredEnd = 0;
+		for (size_t word = 0; word < dirtyBits.size(); word++)
+		{
+			for (uint64_t bits = dirtyBits[word]; bits != 0; bits &= bits - 1)
+			{
+				const uint32_t index = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+				if (index >= coveredEnd)
+				{
+					coveredEnd = index + subtreeSizes[index];
+					dirtyRanges.push_back({ index, coveredEnd });
+				}
+			}
+		}
+
+		for (const DirtyRange& range : dirtyRanges)
+		{
+			changedHandles.insert(changedHandles.end(), denseHandles.begin() + range.first, denseHandles.begin() + range.end);
+		}
+
+		// Words cover disjoint ranges of transforms, so they can be rebuilt independently.
+		if (dirtyCount >= kParallelThreshold)
+		{
+			parallelFor(dirtyBits.size(), [&](size_t word) { updateWord(word); });
+		}
+		else
+		{
+			for (size_t word = 0; word < dirtyBits.size(); word++)
+			{
+				if (dirtyBits[word] != 0)
+				{
+					updateWord(word);
+				}
+			}
+		}
+		dirtyCount = 0;
+
+		propagateWorldMatrices();
+	}
+} // namespace ModelViewer
@@ -0,0 +1,125 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ModelViewer
+{
+	// Value type used to read and write a transform. Rotation is in radians and applied
+	// in Y, X, Z order.
+	struct TransformComponent
+	{
+		glm::vec3 translation{};
+		glm::vec3 scale{ 1.0f, 1.0f, 1.0f };
+		glm::vec3 rotation{};
+
+		glm::mat4 mat4() const;
+	};
+
+	// Structure-of-arrays storage for every object transform, arranged as a scene graph.
+	// Setters only store the new values, cache the rotation's sines and cosines and flag the
+	// transform dirty; update() then rebuilds the local matrices of dirty transforms eight
+	// (AVX2) or four (SSE) at a time and propagates world matrices down their subtrees.
+	//
+	// The arrays are kept in depth-first preorder, so every subtree is one contiguous range
+	// that starts at its root and parents always come before their children. Handles stay
+	// stable while the dense order changes underneath them.
+	class ModelViewerTransformSystem
+	{
+	public:
+		using Handle = uint32_t;
+		static constexpr Handle INVALID_HANDLE = std::numeric_limits<Handle>::max();
+
+		ModelViewerTransformSystem() = default;
+
+		ModelViewerTransformSystem(const ModelViewerTransformSystem&) = delete;
+		ModelViewerTransformSystem& operator=(const ModelViewerTransformSystem&) = delete;
+
+		// Creating transforms in depth-first order only ever appends; inserting into the middle
+		// of an existing subtree shifts the arrays and rebuilds every matrix on the next update.
+		Handle create(const TransformComponent& transform = {}, Handle parent = INVALID_HANDLE);
+		// Children of a destroyed transform are handed to its parent.
+		void destroy(Handle handle);
+		// Moves a transform and its subtree under a new parent. Rebuilds every matrix on the
+		// next update, so this is meant for editing the hierarchy, not for animation.
+		void setParent(Handle handle, Handle parent);
+		Handle getParent(Handle handle) const { return parents[sparse[handle]]; }
+		bool isValid(Handle handle) const { return handle < sparse.size() && sparse[handle] != INVALID_HANDLE; }
+
+		TransformComponent get(Handle handle) const;
+		void set(Handle handle, const TransformComponent& transform);
+		void setTranslation(Handle handle, const glm::vec3& translation);
+		void setRotation(Handle handle, const glm::vec3& rotation);
+		void setScale(Handle handle, const glm::vec3& scale);
+
+		// Recomputes the world matrices of every transform changed since the last update and
+		// of everything below them. Independent dirty subtrees are processed in parallel.
+		void update();
+
+		// Transforms whose world matrix was rebuilt by the last update(), descendants included.
+		const std::vector<Handle>& getChangedHandles() const { return changedHandles; }
+
+		const glm::mat4& getWorldMatrix(Handle handle) const { return worldMatrices[sparse[handle]]; }
+		size_t size() const { return denseHandles.size(); }
+
+	private:
+		enum Column
+		{
+			TranslationX, TranslationY, TranslationZ,
+			ScaleX, ScaleY, ScaleZ,
+			RotationX, RotationY, RotationZ,
+			CosYaw, SinYaw, CosPitch, SinPitch, CosRoll, SinRoll,
+			ColumnCount
+		};
+
+		// Half-open range of dense indices covering one dirty subtree.
+		struct DirtyRange
+		{
+			uint32_t first;
+			uint32_t end;
+		};
+
+		template<typename Function>
+		void forEachDenseArray(Function&& function);
+		void reindex(uint32_t first, uint32_t end);
+		void adjustSubtreeSizes(Handle ancestor, int32_t delta);
+
+		void writeTranslation(uint32_t index, const glm::vec3& translation);
+		void writeRotation(uint32_t index, const glm::vec3& rotation);
+		void writeScale(uint32_t index, const glm::vec3& scale);
+		void markDirty(uint32_t index);
+		void markAllDirty();
+		void updateWord(size_t word);
+		void propagateWorldMatrices();
+		void computeWorldMatrix(uint32_t index);
+
+		// Rebuilds Lanes::Width consecutive local matrices starting at dense index first.
+		template<typename Lanes>
+		void computeLocalMatrices(size_t first);
+
+		std::array<std::vector<float>, ColumnCount> columns;
+		std::vector<glm::mat4> localMatrices;
+		std::vector<glm::mat4> worldMatrices;
+		// Parent handle and number of transforms in the subtree, itself included.
+		std::vector<Handle> parents;
+		std::vector<uint32_t> subtreeSizes;
+
+		// Handle to dense index, INVALID_HANDLE for destroyed handles.
+		std::vector<uint32_t> sparse;
+		std::vector<Handle> denseHandles;
+		std::vector<Handle> freeHandles;
+
+		// One bit per dense index.
+		std::vector<uint64_t> dirtyBits;
+		size_t dirtyCount = 0;
+		std::vector<DirtyRange> dirtyRanges;
+		std::vector<DirtyRange> splitRanges;
+		std::vector<Handle> changedHandles;
+	};
+} // namespace ModelViewer
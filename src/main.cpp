@@ -3,8 +3,10 @@
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
-int main()
+int main(int argc, char** argv)
 {
 	if (!glfwInit())
 	{
@@ -12,10 +14,49 @@ int main()
 		return EXIT_FAILURE;
 	}
 
-	ModelViewer::ModelViewer modelViewer{};
+	std::vector<std::string> modelPaths;
+	ModelViewer::ModelImportOptions importOptions{};
+	ModelViewer::FramePacing framePacing = ModelViewer::FramePacing::Throughput;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--no-optimize")
+		{
+			importOptions.optimize = false;
+		}
+		else if (argument == "--strips")
+		{
+			importOptions.stripify = true;
+		}
+		else if (argument == "--no-meshlets")
+		{
+			importOptions.buildMeshlets = false;
+		}
+		else if (argument == "--no-lods")
+		{
+			importOptions.generateLods = false;
+		}
+		else if (argument == "--stream")
+		{
+			importOptions.streamClusters = true;
+		}
+		else if (argument == "--low-latency")
+		{
+			framePacing = ModelViewer::FramePacing::LowLatency;
+		}
+		else if (argument == "--uncapped")
+		{
+			framePacing = ModelViewer::FramePacing::Uncapped;
+		}
+		else
+		{
+			modelPaths.push_back(argument);
+		}
+	}
 
 	try
 	{
+		ModelViewer::ModelViewer modelViewer{ modelPaths, importOptions, framePacing };
 		modelViewer.run();
 	}
 	catch (const std::exception& e)
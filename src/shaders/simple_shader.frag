@@ -5,11 +5,29 @@ layout (location = 0) out vec4 outColor;
 
 layout (push_constant) uniform Push
 {
-	mat4 transform;
-	vec3 color;
+	mat4 viewProjection;
+	// See SimplePushConstantData::lodFade.
+	float lodFade;
 } push;
 
+// 4x4 Bayer matrix, so complementary fades cover every pixel exactly once.
+const float DITHER[16] = float[](
+	0.0, 8.0, 2.0, 10.0,
+	12.0, 4.0, 14.0, 6.0,
+	3.0, 11.0, 1.0, 9.0,
+	15.0, 7.0, 13.0, 5.0);
+
 void main()
 {
+	if (push.lodFade != 0.0)
+	{
+		ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+		float threshold = (DITHER[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+		if (push.lodFade > 0.0 ? threshold >= push.lodFade : threshold < -push.lodFade)
+		{
+			discard;
+		}
+	}
+
 	outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+}
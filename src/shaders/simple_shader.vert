@@ -1,24 +1,54 @@
 #version 450
 
+// Packed vertex, see ModelViewerModel::PackedVertex. Position is unorm16 inside the mesh's
+// quantization cube; the instance transform maps it back to object space and on to world.
 layout(location = 0) in vec3 position;
+layout(location = 1) in mat4 instanceTransform;
+layout(location = 5) in vec2 octahedralNormal;
+layout(location = 6) in vec2 uv;
+layout(location = 7) in vec4 color;
 
 layout(location = 0) out vec3 fragColor;
 
-vec3 triangle_colors[4] = vec3[](
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0),
-	vec3(1.0, 0.0, 1.0)
-);
-
 layout (push_constant) uniform Push
 {
 	mat4 viewProjection;
-	mat4 transform;
 } push;
 
+// RenderMode::LightingModel: 0 lit, 1 unlit vertex colors, 2 world space normals.
+layout(constant_id = 0) const uint LIGHTING_MODEL = 0;
+
+const vec3 LIGHT_DIRECTION = normalize(vec3(1.0, -3.0, -1.0));
+const float AMBIENT = 0.2;
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
 void main()
 {
-	gl_Position = push.viewProjection *  push.transform * vec4(position, 1.0);
-	fragColor = triangle_colors[gl_VertexIndex % 4];
-}
\ No newline at end of file
+	gl_Position = push.viewProjection * instanceTransform * vec4(position, 1.0);
+
+	// The dequantization is a uniform scale, so the instance's upper 3x3 is enough as long
+	// as the world transform does not scale non-uniformly.
+	vec3 normal = normalize(mat3(instanceTransform) * decodeOctahedral(octahedralNormal));
+	if (LIGHTING_MODEL == 1)
+	{
+		fragColor = color.rgb;
+	}
+	else if (LIGHTING_MODEL == 2)
+	{
+		fragColor = normal * 0.5 + 0.5;
+	}
+	else
+	{
+		float diffuse = max(dot(normal, -LIGHT_DIRECTION), 0.0);
+		fragColor = color.rgb * (AMBIENT + (1.0 - AMBIENT) * diffuse);
+	}
+}